@@ -0,0 +1,99 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Host stand-in for the subset of libnx used by the core sources. Only the
+// declarations the core actually calls are provided; see switch_shim.cpp.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef u32 Result;
+
+#define R_SUCCEEDED(res) ((res) == 0)
+#define R_FAILED(res) ((res) != 0)
+
+#ifndef CONSOLE_ESC
+#define CONSOLE_ESC(x) "\x1b[" #x
+#endif
+
+typedef enum {
+    SetLanguage_JA = 0,
+    SetLanguage_ENUS = 1,
+    SetLanguage_FR = 2,
+    SetLanguage_DE = 3,
+    SetLanguage_IT = 4,
+    SetLanguage_ES = 5,
+    SetLanguage_ZHCN = 6,
+    SetLanguage_KO = 7,
+    SetLanguage_NL = 8,
+    SetLanguage_PT = 9,
+    SetLanguage_RU = 10,
+    SetLanguage_ZHTW = 11,
+    SetLanguage_ENGB = 12,
+    SetLanguage_FRCA = 13,
+    SetLanguage_ES419 = 14,
+    SetLanguage_ZHHANS = 15,
+    SetLanguage_ZHHANT = 16,
+    SetLanguage_PTBR = 17,
+    SetLanguage_Total
+} SetLanguage;
+
+typedef enum {
+    SplConfigItem_ExosphereApiVersion = 65000
+} SplConfigItem;
+
+typedef struct {
+    FILE *stream;
+} PrintConsole;
+
+Result setInitialize(void);
+void setExit(void);
+Result setGetSystemLanguage(u64 *language_code);
+Result setMakeLanguage(u64 language_code, SetLanguage *language);
+
+Result splInitialize(void);
+void splExit(void);
+Result splGetConfig(SplConfigItem config_item, u64 *out_config);
+
+u64 armGetSystemTick(void);
+u64 armGetSystemTickFreq(void);
+u64 armTicksToNs(u64 tick);
+
+PrintConsole *consoleInit(PrintConsole *console);
+void consoleUpdate(PrintConsole *console);
+void consoleExit(PrintConsole *console);
+
+void svcSleepThread(s64 nano);
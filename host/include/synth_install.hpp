@@ -0,0 +1,70 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define SYNTH_DEFAULT_SEED 0x5EED
+
+struct SynthConfig {
+    size_t mod_count;
+    uint32_t seed;
+    // Skyrim language code used to name the language INI, e.g. "en"
+    const char *lang;
+    // share of plugin mods listed in the Plugins file, and of mods enabled
+    unsigned listed_percent;
+    unsigned enabled_percent;
+};
+
+struct SynthStats {
+    size_t data_files;
+    size_t plugin_mods;
+    size_t plugins_lines;
+    size_t archive_list_bytes;
+    // MAST entries across every plugin header, and plugins whose header outgrows
+    // the first read
+    size_t master_refs;
+    size_t long_headers;
+    // mod archives, the distinct assets across them, and archives whose
+    // directory outgrows the first read
+    size_t archives;
+    size_t archive_assets;
+    size_t long_directories;
+};
+
+// Writes a modded romfs tree (Data directory, Plugins file, Skyrim.ini and the
+// language INI) under romfs_dir, replacing anything already there. Plugins start
+// with a TES4 header declaring their masters, which are vanilla masters and
+// plugins generated before them, so the masters always form an acyclic graph.
+// Mod archives hold a directory of assets, some of which other mods' archives
+// provide too. Other data files are empty since only their names matter to the
+// scanner.
+int generateInstall(const char *romfs_dir, SynthConfig const &config, SynthStats *stats);
+
+// Steps the generator's pseudo-random sequence (splitmix64), so other synthetic
+// workloads can be derived from the same seed.
+uint64_t nextRandom(uint64_t &state);
@@ -0,0 +1,86 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "console_renderer.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A stand-in for the terminal the renderer writes to. It applies the subset of
+// VT escapes the renderer emits (CUP, CUF, SGR, DECSTBM, SU and SD) to a cell
+// grid, so the escape stream can be checked against the frame it should draw.
+// Cursor addressing uses the configured origin like the renderer; scroll
+// regions are always 1-based, as on a VT.
+class VirtualTerminal {
+    private:
+        size_t rows;
+        size_t cols;
+        unsigned cursor_origin;
+        ConsoleStyle default_style;
+
+        std::vector<ConsoleCell> grid;
+        size_t cursor_row;
+        size_t cursor_col;
+        // set after writing the last column, the next character wraps first
+        bool wrap_pending;
+        ConsoleStyle style;
+        size_t region_top;
+        size_t region_bottom;
+
+        // partial escape sequence carried over between writes
+        std::string pending;
+        // set when the stream contained something this terminal doesn't understand
+        bool bad_sequence;
+
+        void putChar(char ch);
+
+        void scrollRegion(int delta);
+
+        void applySequence(std::string const &params, char final_ch);
+
+    public:
+        VirtualTerminal(size_t rows, size_t cols, unsigned cursor_origin, ConsoleStyle default_style);
+
+        // Blanks the screen with the default style and resets the cursor,
+        // style and scroll region.
+        void reset(void);
+
+        void write(const char *data, size_t len);
+
+        inline ConsoleCell const &getCell(size_t row, size_t col) const {
+            return grid[row * cols + col];
+        }
+
+        inline bool sawBadSequence(void) const {
+            return bad_sequence;
+        }
+
+        // Returns whether the screen shows exactly what the renderer's back
+        // buffer holds. If not, the first differing cell is stored in row/col.
+        bool matches(ConsoleRenderer const &renderer, size_t *row, size_t *col) const;
+};
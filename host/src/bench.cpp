@@ -0,0 +1,1062 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Benchmarks the load and save paths of the core against synthetic installs of
+// several sizes and writes the results as JSON, so runs from different commits
+// can be compared directly.
+
+#include "asset_index.hpp"
+#include "console_helper.hpp"
+#include "console_renderer.hpp"
+#include "data_scanner.hpp"
+#include "file_helper.hpp"
+#include "gui.hpp"
+#include "ini_helper.hpp"
+#include "load_order.hpp"
+#include "load_order_lint.hpp"
+#include "master_graph.hpp"
+#include "mod.hpp"
+#include "mod_journal.hpp"
+#include "mod_manager.hpp"
+#include "path_helper.hpp"
+#include "phase_timer.hpp"
+#include "plugins_helper.hpp"
+#include "scan_cache.hpp"
+#include "string_helper.hpp"
+#include "synth_install.hpp"
+#include "virtual_terminal.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <unistd.h>
+
+#define BENCH_DEFAULT_SCALES "100,1000,10000"
+#define BENCH_DEFAULT_REPS 5
+#define BENCH_DEFAULT_WORKDIR "/tmp/skymm-bench"
+#define BENCH_SCHEMA_VERSION 1
+
+#define CLASSIFY_NAME_COUNT 1000000
+#define MOVE_TO_END_COUNT 100
+#define SAVE_BURST_COUNT 16
+#define JOURNAL_SESSION_EDITS 20000
+// share of journal session edits which are toggles rather than moves
+#define JOURNAL_TOGGLE_PERCENT 70
+#define GUI_HEADER_HEIGHT 3
+#define GUI_FOOTER_HEIGHT 5
+
+struct BenchOptions {
+    std::vector<size_t> scales;
+    unsigned reps;
+    uint32_t seed;
+    std::string workdir;
+    std::string label;
+    bool micro;
+};
+
+struct BenchResult {
+    std::string name;
+    std::vector<uint64_t> samples_ns;
+    uint64_t allocs;
+    std::vector<std::pair<std::string, uint64_t>> counters;
+};
+
+struct ScaleResults {
+    size_t mod_count;
+    SynthStats stats;
+    std::vector<BenchResult> results;
+};
+
+static uint64_t nowNs(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void die(const char *what) {
+    fprintf(stderr, "\nBenchmark failed: %s\n", what);
+    exit(1);
+}
+
+// Runs setup (untimed) and body (timed) reps times. The body returns non-zero
+// on failure, which aborts the whole run since later numbers would be garbage.
+// Counters added to the returned result see the state left by the last rep.
+template<typename Setup, typename Body>
+static BenchResult &runBench(std::vector<BenchResult> &results, const char *name, unsigned reps,
+        Setup setup, Body body) {
+    fprintf(stderr, "  %-28s", name);
+
+    BenchResult result = { name, {}, 0, {} };
+    uint64_t allocs = 0;
+    for (unsigned i = 0; i < reps; i++) {
+        setup();
+
+        uint64_t allocs_before = getAllocationCount();
+        uint64_t start = nowNs();
+        int rc = body();
+        uint64_t elapsed = nowNs() - start;
+        allocs += getAllocationCount() - allocs_before;
+        if (rc != 0) {
+            die(name);
+        }
+        result.samples_ns.push_back(elapsed);
+    }
+    result.allocs = allocs / reps;
+
+    std::vector<uint64_t> sorted = result.samples_ns;
+    std::sort(sorted.begin(), sorted.end());
+    fprintf(stderr, " %10.3f ms\n", sorted[sorted.size() / 2] / 1e6);
+
+    results.push_back(std::move(result));
+    return results.back();
+}
+
+static uint64_t medianNs(BenchResult const &result) {
+    std::vector<uint64_t> sorted = result.samples_ns;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[sorted.size() / 2];
+}
+
+static void noSetup(void) {
+}
+
+// Loads the global mod list from scratch, stopping after the given number of stages.
+static int loadThrough(int stages) {
+    resetModList();
+    if (stages >= 1 && discoverMods() != 0) {
+        return -1;
+    }
+    if (stages >= 2 && processPluginsFile() != 0) {
+        return -1;
+    }
+    if (stages >= 3 && processInis() != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// The Plugins parser as it was before it moved to string_view, kept as a
+// reference point for parsePlugins().
+static void parsePluginsGetline(std::string const &data, ModRegistry &final_mod_list,
+        ModRegistry &temp_mod_list, std::string &header) {
+    std::istringstream plugins_stream(data);
+    bool in_header = true;
+    std::stringstream header_stream;
+    std::string line;
+    while (std::getline(plugins_stream, line)) {
+        if (line.length() == 0 || line.at(0) == '#') {
+            if (in_header) {
+                header_stream << line << '\n';
+            }
+            continue;
+        }
+
+        if (in_header) {
+            header = header_stream.str();
+            in_header = false;
+        }
+
+        bool enable = line.at(0) == '*';
+
+        std::string file_name = enable ? line.substr(1) : line;
+        ModFile file_def = ModFile::fromFileName(file_name);
+        if (file_def.type != ModFileType::ESP && file_def.type != ModFileType::ESM) {
+            continue;
+        }
+
+        SkyrimMod mod = final_mod_list.find(file_def.base_name);
+        if (!mod) {
+            mod = temp_mod_list.find(file_def.base_name);
+            if (mod) {
+                final_mod_list.append(mod);
+            } else {
+                continue;
+            }
+        }
+
+        mod.setEspEnabled(enable);
+    }
+}
+
+// Hashes everything a toggle or move can change, to check that stepping through a
+// journal lands back on the same state.
+static uint64_t hashModListState(ModRegistry const &mod_list) {
+    uint64_t hash = hashBytes(serializePlugins("", mod_list));
+    for (SkyrimMod mod : mod_list) {
+        BsaState const &bsas = mod.getBsaState();
+        char state[2] = { (char) bsas.enabled, (char) bsas.animations };
+        hash = hashBytes(std::string_view(state, sizeof(state)), hash);
+    }
+    return hash;
+}
+
+// Counts the masters listed after a plugin which depends on them.
+static size_t countMasterViolations(ModRegistry const &mod_list, MasterGraph const &graph) {
+    size_t violations = 0;
+    for (size_t pos = 0; pos < mod_list.size(); pos++) {
+        SkyrimMod mod = mod_list.at(pos);
+        PluginHeader const *header = mod.hasEsp() ? graph.find(mod.getPluginFileName()) : NULL;
+        if (header == NULL) {
+            continue;
+        }
+        for (std::string const &master : header->masters) {
+            ssize_t master_pos = mod_list.indexOf(ModFileView::classify(master).base_name);
+            violations += master_pos > (ssize_t) pos;
+        }
+    }
+    return violations;
+}
+
+// Makes a seeded run of edits through the journal the way the UI would: toggles
+// of random mods, and moves which are either a step or all the way to one end.
+// Given a linter, each edited mod is relinted after its edit as the UI does.
+static void recordJournalSession(ModJournal &journal, uint64_t seed, LoadOrderLinter *linter = NULL) {
+    ModRegistry &mod_list = getGlobalModList();
+    uint64_t rng = seed;
+    for (size_t i = 0; i < JOURNAL_SESSION_EDITS; i++) {
+        size_t pos = nextRandom(rng) % mod_list.size();
+        if (nextRandom(rng) % 100 < JOURNAL_TOGGLE_PERCENT) {
+            SkyrimMod mod = mod_list.at(pos);
+            if (!mod.isMissing()) {
+                journal.toggle(mod);
+                if (linter != NULL) {
+                    linter->relint(mod.getId());
+                }
+            }
+            continue;
+        }
+
+        size_t target;
+        switch (nextRandom(rng) % 4) {
+            case 0:
+                target = 0;
+                break;
+            case 1:
+                target = mod_list.size() - 1;
+                break;
+            case 2:
+                target = pos > 0 ? pos - 1 : pos + 1;
+                break;
+            default:
+                target = pos + 1 < mod_list.size() ? pos + 1 : pos - 1;
+                break;
+        }
+        mod_list.move(pos, target);
+        journal.recordMove(pos, target);
+        if (linter != NULL) {
+            linter->relint(mod_list.at(target).getId());
+        }
+    }
+}
+
+static size_t g_render_bytes = 0;
+// when set, the emitted escapes are also applied to this terminal
+static VirtualTerminal *g_render_terminal = NULL;
+
+static void countBytes(const char *data, size_t len) {
+    g_render_bytes += len;
+    if (g_render_terminal != NULL) {
+        g_render_terminal->write(data, len);
+    }
+}
+
+// Scrolls the selection from the top of the load order to the bottom, one
+// frame per step, and reports what the renderer emitted.
+static int benchScroll(bool scroll_regions, bool full_repaint, size_t *frames) {
+    ConsoleRenderer renderer(CONSOLE_ROWS, CONSOLE_COLUMNS,
+            ConsoleStyle { CONSOLE_COLOR_FG_WHITE, CONSOLE_COLOR_BG_BLACK, CONSOLE_ATTR_BOLD },
+            0, scroll_regions, countBytes);
+    ModGui gui(getGlobalModList(), renderer, GUI_HEADER_HEIGHT,
+            CONSOLE_LINES - GUI_HEADER_HEIGHT - GUI_FOOTER_HEIGHT);
+
+    renderer.invalidate(true);
+    gui.redraw();
+    renderer.present();
+    *frames = 1;
+
+    for (size_t i = 1; i < getGlobalModList().size(); i++) {
+        gui.scrollSelection(1);
+        if (full_repaint) {
+            renderer.invalidate(false);
+        }
+        renderer.present();
+        (*frames)++;
+    }
+    return 0;
+}
+
+// Scrolls the selection through the load order in steps of several sizes, both
+// ways, and checks after every frame that applying the emitted escapes to a
+// terminal reproduces the renderer's back buffer.
+static int checkScroll(bool scroll_regions) {
+    ConsoleStyle clear_style = { CONSOLE_COLOR_FG_WHITE, CONSOLE_COLOR_BG_BLACK, CONSOLE_ATTR_BOLD };
+    // a VT addresses from 1, the libnx console (which has no scroll regions) from 0
+    unsigned cursor_origin = scroll_regions ? 1 : 0;
+    VirtualTerminal term(CONSOLE_ROWS, CONSOLE_COLUMNS, cursor_origin, clear_style);
+    ConsoleRenderer renderer(CONSOLE_ROWS, CONSOLE_COLUMNS, clear_style, cursor_origin, scroll_regions,
+            countBytes);
+    size_t display_rows = CONSOLE_LINES - GUI_HEADER_HEIGHT - GUI_FOOTER_HEIGHT;
+    ModGui gui(getGlobalModList(), renderer, GUI_HEADER_HEIGHT, display_rows);
+
+    g_render_terminal = &term;
+    renderer.invalidate(true);
+    gui.redraw();
+    renderer.present();
+
+    const int steps[] = { 1, 2, 3, (int) display_rows / 2, (int) display_rows - 1, (int) display_rows + 3 };
+    int rc = 0;
+    for (int step : steps) {
+        for (int dir : { 1, -1 }) {
+            // far enough to hit the end of the list from wherever the last pass stopped
+            size_t frames = getGlobalModList().size() / step + 2;
+            for (size_t i = 0; i < frames && rc == 0; i++) {
+                gui.scrollSelection(step * dir);
+                renderer.present();
+
+                size_t row;
+                size_t col;
+                if (term.sawBadSequence()) {
+                    fprintf(stderr, "\n  unexpected escape scrolling by %d", step * dir);
+                    rc = -1;
+                } else if (!term.matches(renderer, &row, &col)) {
+                    fprintf(stderr, "\n  cell %zu,%zu differs scrolling by %d", row, col, step * dir);
+                    rc = -1;
+                }
+            }
+        }
+    }
+
+    g_render_terminal = NULL;
+    return rc;
+}
+
+static void runScale(BenchOptions const &opts, ScaleResults &scale) {
+    std::vector<BenchResult> &results = scale.results;
+    unsigned reps = opts.reps;
+
+    std::string root = opts.workdir + "/mods-" + std::to_string(scale.mod_count);
+    std::string romfs = root + "/romfs";
+    std::string cache_path = root + "/" + SCAN_CACHE_FILE;
+    setBaseRomfsPath(romfs.c_str());
+
+    fprintf(stderr, "%lu mods\n", scale.mod_count);
+
+    // the shim reports en-US unless told otherwise, which Skyrim calls "en"
+    SynthConfig config = { scale.mod_count, opts.seed, "en", 90, 60 };
+    runBench(results, "generate_install", 1, noSetup, [&]() {
+        return generateInstall(romfs.c_str(), config, &scale.stats);
+    });
+    invalidateScanCache(cache_path.c_str());
+
+    std::string data_dir = getRomfsPath(SKYRIM_DATA_DIR);
+
+    // individual load stages, each from a clean slate
+    runBench(results, "discover_mods", reps, []() { resetModList(); }, []() {
+        return discoverMods();
+    });
+    for (size_t workers = 1; workers <= SCAN_MAX_WORKERS; workers++) {
+        std::string name = "scan_data_dir_" + std::to_string(workers) + "_workers";
+        size_t file_count = 0;
+        ModStore scan_store;
+        ModRegistry scanned(scan_store);
+        runBench(results, name.c_str(), reps, [&]() {
+            scanned.clear();
+            scan_store.clear();
+        }, [&]() {
+            return scanDataDir(data_dir.c_str(), scanned, &file_count, workers);
+        }).counters.push_back({ "files", file_count });
+    }
+    runBench(results, "process_plugins_file", reps, []() {
+        if (loadThrough(1) != 0) {
+            die("discover_mods");
+        }
+    }, []() {
+        return processPluginsFile();
+    });
+    runBench(results, "parse_inis", reps, []() {
+        if (loadThrough(2) != 0) {
+            die("process_plugins_file");
+        }
+    }, []() {
+        return processInis();
+    });
+    runBench(results, "merge_pending_mods", reps, []() {
+        if (loadThrough(3) != 0) {
+            die("parse_inis");
+        }
+    }, []() {
+        mergePendingMods();
+        return 0;
+    });
+
+    // the same stages with their reads issued one after another and all at once
+    BenchResult &sequential = runBench(results, "load_sources_sequential", reps, []() { resetModList(); }, []() {
+        return loadSourcesSequential();
+    });
+    uint64_t sequential_ns = medianNs(sequential);
+    BenchResult &parallel = runBench(results, "load_sources_parallel", reps, []() { resetModList(); }, []() {
+        return loadSourcesParallel();
+    });
+    uint64_t parallel_ns = std::max<uint64_t>(medianNs(parallel), 1);
+    parallel.counters.push_back({ "speedup_pct", sequential_ns * 100 / parallel_ns });
+
+    // whole startup, with and without a usable snapshot cache
+    runBench(results, "load_cold", reps, [&]() {
+        resetModList();
+        invalidateScanCache(cache_path.c_str());
+    }, []() {
+        return loadModList();
+    }).counters.push_back({ "mods", getGlobalModList().size() });
+    runBench(results, "load_cached", reps, []() { resetModList(); }, []() {
+        return loadModList();
+    }).counters.push_back({ "mods", getGlobalModList().size() });
+
+    // plugin headers read cold on one thread and on the pool, then from their cache
+    std::vector<std::string> plugin_files;
+    for (SkyrimMod mod : getGlobalModList()) {
+        if (mod.hasEsp()) {
+            plugin_files.push_back(mod.getPluginFileName());
+        }
+    }
+    std::string plugins_cache_path = root + "/" + PLUGIN_CACHE_FILE;
+    MasterGraph graph;
+    MasterGraphStats graph_stats;
+    auto drop_header_cache = [&]() {
+        graph.clear();
+        remove(plugins_cache_path.c_str());
+    };
+    BenchResult &headers_sequential = runBench(results, "master_graph_cold_1_worker", reps, drop_header_cache,
+            [&]() {
+        return graph.load(data_dir, plugin_files, plugins_cache_path, 1, &graph_stats);
+    });
+    uint64_t headers_sequential_ns = medianNs(headers_sequential);
+    headers_sequential.counters.push_back({ "bytes_read", graph_stats.bytes_read });
+    BenchResult &headers_parallel = runBench(results, "master_graph_cold", reps, drop_header_cache, [&]() {
+        return graph.load(data_dir, plugin_files, plugins_cache_path, LOAD_WORKERS, &graph_stats);
+    });
+    uint64_t headers_parallel_ns = std::max<uint64_t>(medianNs(headers_parallel), 1);
+    headers_parallel.counters = {
+        { "plugins", graph_stats.plugins },
+        { "bytes_read", graph_stats.bytes_read },
+        { "long_headers", scale.stats.long_headers },
+        { "speedup_pct", headers_sequential_ns * 100 / headers_parallel_ns }
+    };
+
+    size_t master_refs = 0;
+    for (size_t i = 0; i < graph.size(); i++) {
+        PluginHeader const *plugin_header = graph.getHeader(i);
+        if (plugin_header == NULL) {
+            die("master_graph_cold: unreadable plugin header");
+        }
+        master_refs += plugin_header->masters.size();
+    }
+    // every plugin is in the load order, so the graph should hold every master the generator wrote
+    if (master_refs != scale.stats.master_refs) {
+        die("master_graph_cold: masters don't match the generated headers");
+    }
+
+    BenchResult &headers_cached = runBench(results, "master_graph_cached", reps, [&]() { graph.clear(); }, [&]() {
+        return graph.load(data_dir, plugin_files, plugins_cache_path, LOAD_WORKERS, &graph_stats);
+    });
+    headers_cached.counters = { { "cached", graph_stats.cached }, { "master_refs", master_refs } };
+
+    // what building the graph behind the UI adds to a cached startup on the main thread
+    runBench(results, "load_cached_queue_masters", reps, []() {
+        waitForMasterGraph();
+        resetModList();
+    }, []() {
+        int rc = loadModList();
+        queueMasterGraphLoad();
+        return rc;
+    });
+    waitForMasterGraph();
+
+    // auto-sort of the shuffled load order, then of the sorted one, which should
+    // leave it be; the generator makes no cycles, so nothing may be out of order
+    std::vector<ModId> sorted_order;
+    LoadOrderSortResult sort_result;
+    BenchResult &sort_bench = runBench(results, "sort_load_order", reps, noSetup, [&]() {
+        sortLoadOrder(getGlobalModList(), graph, sorted_order, &sort_result);
+        return 0;
+    });
+    sort_bench.counters = {
+        { "plugins", sort_result.plugins },
+        { "dependencies", sort_result.dependencies },
+        { "violations_before", countMasterViolations(getGlobalModList(), graph) },
+        { "moved", sort_result.moved },
+        { "cycles", sort_result.cycle_count }
+    };
+
+    uint64_t unsorted_state = hashModListState(getGlobalModList());
+    ModJournal sort_journal(getGlobalModList());
+    std::vector<ModId> unsorted_order = getGlobalModList().getIds();
+    getGlobalModList().reorder(sorted_order);
+    sort_journal.recordReorder(unsorted_order);
+    uint64_t sorted_state = hashModListState(getGlobalModList());
+    if (sort_result.cycle_count != 0 || countMasterViolations(getGlobalModList(), graph) != 0) {
+        die("sort_load_order: masters left out of order");
+    }
+
+    runBench(results, "sort_load_order_sorted", reps, noSetup, [&]() {
+        sortLoadOrder(getGlobalModList(), graph, sorted_order, &sort_result);
+        return 0;
+    }).counters.push_back({ "moved", sort_result.moved });
+    if (sort_result.moved != 0 || sorted_order != getGlobalModList().getIds()) {
+        die("sort_load_order_sorted: sorting a sorted list changed it");
+    }
+
+    if (sort_journal.undo() == NULL || hashModListState(getGlobalModList()) != unsorted_state
+            || sort_journal.redo() == NULL || hashModListState(getGlobalModList()) != sorted_state) {
+        die("sort_load_order: undo doesn't restore the order");
+    }
+
+    // archive directories read cold, then from their cache, then carried over
+    // from the last load as a rescan does; the generator writes no bad archives
+    std::vector<std::string> archive_files;
+    for (SkyrimMod mod : getGlobalModList()) {
+        mod.getArchiveFileNames(archive_files);
+    }
+    std::string assets_cache_path = root + "/" + ASSET_CACHE_FILE;
+    AssetIndex asset_index;
+    AssetIndexStats asset_stats;
+    BenchResult &assets_cold = runBench(results, "asset_index_cold", reps, [&]() {
+        asset_index.clear();
+        remove(assets_cache_path.c_str());
+    }, [&]() {
+        return asset_index.load(data_dir, archive_files, assets_cache_path, LOAD_WORKERS, &asset_stats);
+    });
+    assets_cold.counters = {
+        { "archives", asset_stats.archives },
+        { "assets", asset_stats.assets },
+        { "shared_assets", asset_stats.shared_assets },
+        { "bytes_read", asset_stats.bytes_read },
+        { "long_directories", scale.stats.long_directories }
+    };
+    if (asset_stats.failed != 0 || asset_stats.archives != scale.stats.archives
+            || asset_stats.assets != scale.stats.archive_assets) {
+        die("asset_index_cold: assets don't match the generated archives");
+    }
+
+    BenchResult &assets_cached = runBench(results, "asset_index_cached", reps, [&]() { asset_index.clear(); },
+            [&]() {
+        return asset_index.load(data_dir, archive_files, assets_cache_path, LOAD_WORKERS, &asset_stats);
+    });
+    assets_cached.counters = { { "cached", asset_stats.cached }, { "bytes_read", asset_stats.bytes_read } };
+
+    BenchResult &assets_rescan = runBench(results, "asset_index_rescan", reps, noSetup, [&]() {
+        return asset_index.load(data_dir, archive_files, assets_cache_path, LOAD_WORKERS, &asset_stats);
+    });
+    assets_rescan.counters = { { "cached", asset_stats.cached }, { "bytes_written", asset_stats.bytes_written } };
+    if (asset_stats.read != 0 || asset_stats.assets != scale.stats.archive_assets) {
+        die("asset_index_rescan: unchanged archives were read again");
+    }
+
+    std::vector<AssetConflict> conflicts;
+    AssetConflictStats conflict_stats;
+    BenchResult &conflicts_bench = runBench(results, "find_asset_conflicts", reps, noSetup, [&]() {
+        findAssetConflicts(getGlobalModList(), asset_index, conflicts, &conflict_stats);
+        return 0;
+    });
+    conflicts_bench.counters = {
+        { "conflicts", conflicts.size() },
+        { "contested_assets", conflict_stats.contested_assets },
+        { "enabled_archives", conflict_stats.enabled_archives }
+    };
+    for (AssetConflict const &conflict : conflicts) {
+        if (getGlobalModList().indexOf(getGlobalModStore().getBaseName(conflict.winner))
+                <= getGlobalModList().indexOf(getGlobalModStore().getBaseName(conflict.loser))) {
+            die("find_asset_conflicts: a mod overrides one which loads after it");
+        }
+    }
+    if (conflicts.empty()) {
+        die("find_asset_conflicts: no conflicts between archives sharing assets");
+    }
+
+    // linting the whole list, as after loading, rescanning or sorting it
+    LoadOrderLinter linter(getGlobalModList());
+    BenchResult &lint_bench = runBench(results, "lint_all", reps, noSetup, [&]() {
+        linter.relintAll(&graph);
+        return 0;
+    });
+    LintCounts lint_counts = linter.getCounts();
+    lint_bench.counters = {
+        { "flagged", lint_counts.flagged },
+        { "master_disabled", lint_counts.issues[0] },
+        { "master_missing", lint_counts.issues[1] },
+        { "master_later", lint_counts.issues[2] },
+        { "orphaned_archives", lint_counts.issues[3] }
+    };
+
+    // an edit session relinting after every edit, which must leave each mod with
+    // the same issues as linting the edited list afresh
+    ModJournal lint_journal(getGlobalModList());
+    runBench(results, "lint_edit_session", reps, [&]() {
+        while (lint_journal.undo()) {
+        }
+        lint_journal.clear();
+        linter.relintAll(&graph);
+    }, [&]() {
+        recordJournalSession(lint_journal, opts.seed, &linter);
+        return 0;
+    }).counters.push_back({ "edits", JOURNAL_SESSION_EDITS });
+
+    LoadOrderLinter fresh_linter(getGlobalModList());
+    fresh_linter.relintAll(&graph);
+    for (ModId id = 0; id < getGlobalModStore().size(); id++) {
+        if (linter.getIssues(id) != fresh_linter.getIssues(id)) {
+            die("lint_edit_session: relinted issues differ from linting afresh");
+        }
+    }
+    LintCounts const &relinted = linter.getCounts();
+    LintCounts const &fresh = fresh_linter.getCounts();
+    if (relinted.flagged != fresh.flagged
+            || !std::equal(relinted.issues, relinted.issues + LINT_ISSUE_COUNT, fresh.issues)) {
+        die("lint_edit_session: issue counts drifted from the issues");
+    }
+    while (lint_journal.undo()) {
+    }
+
+    // heap held once the list is loaded; a cached load leaves little else behind
+    size_t heap_before = 0;
+    BenchResult &heap_result = runBench(results, "mod_list_heap", 1, [&]() {
+        resetModList();
+        heap_before = mallinfo2().uordblks;
+    }, []() {
+        return loadModList();
+    });
+    size_t heap_bytes = mallinfo2().uordblks - heap_before;
+    heap_result.counters = { { "heap_bytes", heap_bytes }, { "bytes_per_mod", heap_bytes / getGlobalModList().size() } };
+
+    size_t enabled_mods = 0;
+    runBench(results, "get_status_all", reps, [&]() { enabled_mods = 0; }, [&]() {
+        for (SkyrimMod mod : getGlobalModList()) {
+            enabled_mods += mod.getStatus() == ModStatus::ENABLED;
+        }
+        return 0;
+    }).counters.push_back({ "enabled", enabled_mods });
+    runBench(results, "status_counts_after_toggle", reps, []() {
+        // what the header does after (A): one mod changed since the counts were last read
+        getGlobalModList().at(0).enable();
+    }, []() {
+        return getGlobalModStore().getStatusCounts().enabled > 0 ? 0 : -1;
+    });
+
+    // Plugins parsing on its own, against the previous getline-based parser
+    std::string plugins_data;
+    if (readFile(getRomfsPath(SKYRIM_PLUGINS_FILE).c_str(), plugins_data) != 0) {
+        die("read Plugins");
+    }
+    ModStore pending_store;
+    ModRegistry pending(pending_store);
+    size_t file_count;
+    if (scanDataDir(data_dir.c_str(), pending, &file_count) != 0) {
+        die("scan_data_dir");
+    }
+    ModRegistry parsed(pending_store);
+    std::string header;
+    auto clear_parsed = [&]() {
+        parsed.clear();
+        header.clear();
+    };
+    runBench(results, "plugins_parse", reps, clear_parsed, [&]() {
+        parsePlugins(plugins_data, parsed, pending, header);
+        return 0;
+    }).counters.push_back({ "lines", scale.stats.plugins_lines });
+    runBench(results, "plugins_parse_getline", reps, clear_parsed, [&]() {
+        parsePluginsGetline(plugins_data, parsed, pending, header);
+        return 0;
+    }).counters.push_back({ "lines", scale.stats.plugins_lines });
+
+    // registry operations backing the load order editor
+    std::vector<std::string> names;
+    for (SkyrimMod mod : getGlobalModList()) {
+        names.push_back(std::string(mod.getBaseName()));
+    }
+    size_t misses = 0;
+    runBench(results, "registry_find_all", reps, [&]() { misses = 0; }, [&]() {
+        for (std::string const &name : names) {
+            misses += !getGlobalModList().find(name);
+        }
+        return misses != 0 ? -1 : 0;
+    });
+    runBench(results, "registry_drag_to_end", reps, noSetup, []() {
+        // what holding Down in edit mode does, one place at a time
+        ModRegistry &mod_list = getGlobalModList();
+        for (size_t i = 0; i + 1 < mod_list.size(); i++) {
+            mod_list.move(i, i + 1);
+        }
+        return 0;
+    }).counters.push_back({ "steps", getGlobalModList().size() - 1 });
+    runBench(results, "registry_move_to_end", reps, noSetup, []() {
+        ModRegistry &mod_list = getGlobalModList();
+        for (size_t i = 0; i < MOVE_TO_END_COUNT; i++) {
+            mod_list.move(0, mod_list.size() - 1);
+        }
+        return 0;
+    }).counters.push_back({ "moves", MOVE_TO_END_COUNT });
+
+    // bytes sent to the console while scrolling through the whole list
+    struct {
+        const char *name;
+        bool scroll_regions;
+        bool full_repaint;
+    } scroll_variants[] = {
+        { "render_scroll", false, false },
+        { "render_scroll_regions", true, false },
+        { "render_scroll_full_repaint", false, true },
+    };
+    for (auto const &variant : scroll_variants) {
+        size_t frames = 0;
+        BenchResult &result = runBench(results, variant.name, reps, []() { g_render_bytes = 0; }, [&]() {
+            return benchScroll(variant.scroll_regions, variant.full_repaint, &frames);
+        });
+        result.counters = { { "frames", frames }, { "bytes", g_render_bytes } };
+    }
+    if (checkScroll(false) != 0) {
+        die("render_scroll: the emitted escapes don't reproduce the frame");
+    }
+    if (checkScroll(true) != 0) {
+        die("render_scroll_regions: the emitted escapes don't reproduce the frame");
+    }
+
+    // what pressing (A) does, over every mod; this leaves them all disabled
+    runBench(results, "toggle_all", reps, noSetup, []() {
+        for (SkyrimMod mod : getGlobalModList()) {
+            mod.enable();
+            mod.disable();
+        }
+        return 0;
+    }).counters.push_back({ "toggles", getGlobalModList().size() * 2 });
+
+    // a long edit session, then stepping all the way back through it and replaying it
+    ModJournal journal(getGlobalModList());
+    uint64_t start_state = hashModListState(getGlobalModList());
+    BenchResult &record_result = runBench(results, "journal_record", 1, noSetup, [&]() {
+        recordJournalSession(journal, opts.seed);
+        return 0;
+    });
+    record_result.counters = { { "entries", journal.size() }, { "bytes", journal.getByteSize() } };
+    uint64_t end_state = hashModListState(getGlobalModList());
+    runBench(results, "journal_undo_all", reps, [&]() {
+        while (journal.redo()) {
+        }
+    }, [&]() {
+        while (journal.undo()) {
+        }
+        return 0;
+    }).counters.push_back({ "entries", journal.size() });
+    if (hashModListState(getGlobalModList()) != start_state) {
+        die("journal_undo_all didn't restore the starting state");
+    }
+    runBench(results, "journal_replay", reps, [&]() {
+        while (journal.undo()) {
+        }
+    }, [&]() {
+        while (journal.redo()) {
+        }
+        return 0;
+    }).counters.push_back({ "entries", journal.size() });
+    if (hashModListState(getGlobalModList()) != end_state) {
+        die("journal_replay didn't reproduce the recorded session");
+    }
+
+    // saving, both when something changed and when nothing did
+    if (loadThrough(0) != 0 || loadModList() != 0) {
+        die("load_cold");
+    }
+    std::vector<SkyrimMod> plugin_mods;
+    std::vector<SkyrimMod> archive_mods;
+    for (SkyrimMod mod : getGlobalModList()) {
+        if (mod.hasEsp()) {
+            plugin_mods.push_back(mod);
+        }
+        if (mod.hasBsas()) {
+            archive_mods.push_back(mod);
+        }
+    }
+    if (plugin_mods.empty() || archive_mods.empty()) {
+        die("no mods to toggle");
+    }
+
+    size_t toggles = 0;
+    size_t bytes_written = 0;
+    bool plugins_written = false;
+    runBench(results, "write_plugins_changed", reps, [&]() {
+        SkyrimMod mod = plugin_mods[toggles++ % plugin_mods.size()];
+        mod.setEspEnabled(!mod.isEspEnabled());
+    }, [&]() {
+        return writePluginsFile(&bytes_written, &plugins_written) != 0 || !plugins_written ? -1 : 0;
+    }).counters.push_back({ "bytes", bytes_written });
+    runBench(results, "write_plugins_unchanged", reps, noSetup, [&]() {
+        return writePluginsFile(&bytes_written, &plugins_written) != 0 || plugins_written ? -1 : 0;
+    });
+
+    int inis_written = 0;
+    runBench(results, "write_inis_changed", reps, [&]() {
+        SkyrimMod mod = archive_mods[toggles++ % archive_mods.size()];
+        if (!mod.hasEnabledBsas()) {
+            mod.enable();
+        } else {
+            mod.disable();
+        }
+    }, [&]() {
+        return writeIniChanges(&bytes_written, &inis_written) != 0 || inis_written == 0 ? -1 : 0;
+    }).counters.push_back({ "bytes", bytes_written });
+    runBench(results, "write_inis_unchanged", reps, noSetup, [&]() {
+        return writeIniChanges(&bytes_written, &inis_written) != 0 || inis_written != 0 ? -1 : 0;
+    });
+
+    // what (-) costs the UI thread now that the files are written on the save worker
+    auto toggle_next_plugin = [&]() {
+        SkyrimMod mod = plugin_mods[toggles++ % plugin_mods.size()];
+        mod.setEspEnabled(!mod.isEspEnabled());
+    };
+    SaveResult save_result;
+    runBench(results, "queue_save", reps, toggle_next_plugin, []() {
+        return queueSave();
+    });
+    waitForSaves();
+    while (pollSave(&save_result)) {
+        if (save_result.rc != 0) {
+            die("queue_save");
+        }
+    }
+
+    // a burst of saves queued faster than they're written, which should only write the last state
+    size_t saves_written = 0;
+    BenchResult &burst_result = runBench(results, "save_burst", reps, [&]() { saves_written = 0; }, [&]() {
+        for (size_t i = 0; i < SAVE_BURST_COUNT; i++) {
+            toggle_next_plugin();
+            if (queueSave() != 0) {
+                return -1;
+            }
+        }
+        waitForSaves();
+        while (pollSave(&save_result)) {
+            if (save_result.rc != 0) {
+                return -1;
+            }
+            saves_written++;
+        }
+        return 0;
+    });
+    burst_result.counters = { { "queued", SAVE_BURST_COUNT }, { "written", saves_written } };
+    if (writePluginsFile(&bytes_written, &plugins_written) != 0 || plugins_written) {
+        die("save_burst left the Plugins file behind the mod list");
+    }
+}
+
+static void runMicro(BenchOptions const &opts, std::vector<BenchResult> &results) {
+    static const char *suffixes[] = {
+        ".esp", ".esm", ".bsa", " - Textures.bsa", " - Animations.bsa", " - Meshes.bsa", ".ini", " - Readme.txt",
+    };
+
+    fprintf(stderr, "micro\n");
+
+    // names long enough that owned copies can't use the small string buffer
+    std::vector<std::string> names;
+    names.reserve(CLASSIFY_NAME_COUNT);
+    for (size_t i = 0; i < CLASSIFY_NAME_COUNT; i++) {
+        char name[80];
+        snprintf(name, sizeof(name), "Synthetic Classification Mod %07lu%s", i,
+                suffixes[i % (sizeof(suffixes) / sizeof(suffixes[0]))]);
+        names.push_back(name);
+    }
+
+    size_t mod_files = 0;
+    runBench(results, "classify_view", opts.reps, [&]() { mod_files = 0; }, [&]() {
+        for (std::string const &name : names) {
+            mod_files += ModFileView::classify(name).type != ModFileType::UNKNOWN;
+        }
+        return 0;
+    }).counters.push_back({ "mod_files", mod_files });
+    runBench(results, "classify_owned", opts.reps, [&]() { mod_files = 0; }, [&]() {
+        for (std::string const &name : names) {
+            mod_files += ModFile::fromFileName(name).type != ModFileType::UNKNOWN;
+        }
+        return 0;
+    }).counters.push_back({ "mod_files", mod_files });
+}
+
+static void writeJsonString(FILE *out, std::string const &str) {
+    fputc('"', out);
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if ((unsigned char) c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void writeJsonResults(FILE *out, std::vector<BenchResult> const &results, const char *indent) {
+    fprintf(out, "[\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        BenchResult const &result = results[i];
+        std::vector<uint64_t> sorted = result.samples_ns;
+        std::sort(sorted.begin(), sorted.end());
+        uint64_t total = 0;
+        for (uint64_t sample : sorted) {
+            total += sample;
+        }
+
+        fprintf(out, "%s  {\"name\": ", indent);
+        writeJsonString(out, result.name);
+        fprintf(out, ", \"samples\": %lu, \"min_ns\": %lu, \"median_ns\": %lu, \"mean_ns\": %lu, \"max_ns\": %lu"
+                ", \"allocs\": %lu, \"counters\": {",
+                sorted.size(), sorted.front(), sorted[sorted.size() / 2], total / sorted.size(), sorted.back(),
+                result.allocs);
+        for (size_t j = 0; j < result.counters.size(); j++) {
+            fprintf(out, "%s", j != 0 ? ", " : "");
+            writeJsonString(out, result.counters[j].first);
+            fprintf(out, ": %lu", result.counters[j].second);
+        }
+        fprintf(out, "}}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "%s]", indent);
+}
+
+static void writeJson(FILE *out, BenchOptions const &opts, std::vector<ScaleResults> const &scales,
+        std::vector<BenchResult> const &micro) {
+    fprintf(out, "{\n  \"suite\": \"skymm-bench\",\n  \"schema\": %d,\n  \"label\": ", BENCH_SCHEMA_VERSION);
+    writeJsonString(out, opts.label);
+    fprintf(out, ",\n  \"reps\": %u,\n  \"seed\": %u,\n  \"scales\": [\n", opts.reps, opts.seed);
+    for (size_t i = 0; i < scales.size(); i++) {
+        ScaleResults const &scale = scales[i];
+        fprintf(out, "    {\n      \"mods\": %lu,\n      \"data_files\": %lu,\n      \"plugin_mods\": %lu,\n"
+                "      \"plugins_lines\": %lu,\n      \"archive_list_bytes\": %lu,\n      \"results\": ",
+                scale.mod_count, scale.stats.data_files, scale.stats.plugin_mods, scale.stats.plugins_lines,
+                scale.stats.archive_list_bytes);
+        writeJsonResults(out, scale.results, "      ");
+        fprintf(out, "\n    }%s\n", i + 1 < scales.size() ? "," : "");
+    }
+    fprintf(out, "  ],\n  \"micro\": ");
+    writeJsonResults(out, micro, "  ");
+    fprintf(out, "\n}\n");
+}
+
+static void printUsage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "\n"
+            "Options:\n"
+            "  --scales N,N,...  mod counts to generate installs for (default: " BENCH_DEFAULT_SCALES ")\n"
+            "  --reps N          timed repetitions per benchmark (default: %d)\n"
+            "  --seed N          generator seed (default: %d)\n"
+            "  --workdir DIR     where synthetic installs are written (default: " BENCH_DEFAULT_WORKDIR ")\n"
+            "  --label STR       free-form label recorded in the output, e.g. a commit hash\n"
+            "  --output FILE     write JSON here instead of stdout\n"
+            "  --no-micro        skip the scale-independent microbenchmarks\n"
+            "  --verbose         let the core print its progress to stdout\n",
+            argv0, BENCH_DEFAULT_REPS, SYNTH_DEFAULT_SEED);
+}
+
+static bool parseScales(const char *arg, std::vector<size_t> &scales) {
+    scales.clear();
+    for (std::string const &part : split(arg, ",")) {
+        char *end;
+        unsigned long count = strtoul(part.c_str(), &end, 10);
+        if (part.empty() || *end != '\0' || count == 0) {
+            return false;
+        }
+        scales.push_back(count);
+    }
+    return !scales.empty();
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opts;
+    parseScales(BENCH_DEFAULT_SCALES, opts.scales);
+    opts.reps = BENCH_DEFAULT_REPS;
+    opts.seed = SYNTH_DEFAULT_SEED;
+    opts.workdir = BENCH_DEFAULT_WORKDIR;
+    opts.micro = true;
+    const char *output = NULL;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--scales") == 0 && has_value) {
+            if (!parseScales(argv[++i], opts.scales)) {
+                printUsage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--reps") == 0 && has_value) {
+            opts.reps = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            opts.seed = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--workdir") == 0 && has_value) {
+            opts.workdir = argv[++i];
+        } else if (strcmp(argv[i], "--label") == 0 && has_value) {
+            opts.label = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && has_value) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--no-micro") == 0) {
+            opts.micro = false;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    // the core reports progress on stdout, so keep the JSON on its own stream
+    FILE *json_out = output != NULL ? fopen(output, "w") : fdopen(dup(STDOUT_FILENO), "w");
+    if (json_out == NULL) {
+        fprintf(stderr, "Failed to open %s\n", output != NULL ? output : "stdout");
+        return 1;
+    }
+    if (!verbose && freopen("/dev/null", "w", stdout) == NULL) {
+        fprintf(stderr, "Failed to silence stdout\n");
+        return 1;
+    }
+
+    std::vector<ScaleResults> scales;
+    for (size_t mod_count : opts.scales) {
+        scales.push_back({ mod_count, {}, {} });
+        runScale(opts, scales.back());
+    }
+
+    std::vector<BenchResult> micro;
+    if (opts.micro) {
+        runMicro(opts, micro);
+    }
+
+    writeJson(json_out, opts, scales, micro);
+    fclose(json_out);
+    return 0;
+}
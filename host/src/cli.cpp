@@ -0,0 +1,337 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Command-line front end for the host build. It drives the same load and save
+// paths as the Switch app against a romfs directory on the local filesystem.
+
+#include "asset_index.hpp"
+#include "error_defs.hpp"
+#include "ini_helper.hpp"
+#include "load_order.hpp"
+#include "load_order_lint.hpp"
+#include "mod.hpp"
+#include "mod_manager.hpp"
+#include "path_helper.hpp"
+#include "phase_timer.hpp"
+#include "switch_shim.hpp"
+
+#include <switch.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void printUsage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [options] <command> [args]\n"
+            "\n"
+            "Options:\n"
+            "  --romfs DIR     romfs directory containing Data, Plugins and the INIs\n"
+            "                  (default: $SKYMM_ROMFS)\n"
+            "  --lang CODE     system language code, e.g. en-US or fr (default: $SKYMM_LANG or "
+            SHIM_DEFAULT_LANGUAGE ")\n"
+            "  --timings       print how long each load and save phase took to stderr\n"
+            "\n"
+            "Commands:\n"
+            "  list            print the load order and the status of each mod\n"
+            "  masters         print the masters each plugin declares in its header\n"
+            "  sort            sort the load order so plugins follow their masters and save\n"
+            "  conflicts       print which enabled mods' archives override each other\n"
+            "  lint            print problems the game would have loading each mod\n"
+            "  enable NAME     enable a mod and save\n"
+            "  disable NAME    disable a mod and save\n"
+            "  move NAME POS   move a mod to the given load order position and save\n"
+            "  save            write any outputs which differ from what was loaded\n",
+            argv0);
+}
+
+static const char *getStatusString(ModStatus status) {
+    switch (status) {
+        case ModStatus::ENABLED:
+            return "Enabled";
+        case ModStatus::DISABLED:
+            return "Disabled";
+        case ModStatus::PARTIAL:
+            return "Partial";
+        default:
+            return "Unknown";
+    }
+}
+
+static void listMods(void) {
+    size_t i = 0;
+    for (SkyrimMod mod : getGlobalModList()) {
+        std::string_view name = mod.getBaseName();
+        printf("%4lu  %-9s %.*s%s\n", i++, getStatusString(mod.getStatus()), (int) name.size(), name.data(),
+                mod.isMissing() ? " (missing)" : "");
+    }
+
+    ModStatusCounts const &counts = getGlobalModStore().getStatusCounts();
+    printf("\n%lu enabled, %lu partial, %lu disabled, %lu missing\n",
+            counts.enabled, counts.partial, counts.disabled, counts.missing);
+}
+
+static void listMasters(void) {
+    queueMasterGraphLoad();
+    MasterGraph const &graph = waitForMasterGraph();
+
+    for (size_t i = 0; i < graph.size(); i++) {
+        printf("%-48s", graph.getFileName(i).c_str());
+        PluginHeader const *header = graph.getHeader(i);
+        if (header == NULL) {
+            printf(" (%s)\n", graph.getStatus(i) == PluginHeaderStatus::MISSING ? "missing" : "malformed");
+            continue;
+        }
+
+        printf(" %s", header->isMasterFlagged() ? "[ESM]" : "[ESP]");
+        for (size_t j = 0; j < header->masters.size(); j++) {
+            printf("%s%s", j == 0 ? " <- " : ", ", header->masters[j].c_str());
+        }
+        printf("\n");
+    }
+}
+
+static void listConflicts(void) {
+    queueAssetIndexLoad();
+    AssetIndex const &index = waitForAssetIndex();
+
+    for (size_t i = 0; i < index.size(); i++) {
+        if (index.getStatus(i) != ArchiveStatus::OK) {
+            printf("%s (%s)\n", index.getFileName(i).c_str(),
+                    index.getStatus(i) == ArchiveStatus::MISSING ? "missing" : "malformed");
+        }
+    }
+
+    std::vector<AssetConflict> conflicts;
+    AssetConflictStats stats;
+    findAssetConflicts(getGlobalModList(), index, conflicts, &stats);
+
+    for (AssetConflict const &conflict : conflicts) {
+        std::string_view winner = getGlobalModStore().getBaseName(conflict.winner);
+        std::string_view loser = getGlobalModStore().getBaseName(conflict.loser);
+        printf("%.*s overrides %.*s (%lu assets)\n", (int) winner.size(), winner.data(), (int) loser.size(),
+                loser.data(), conflict.assets);
+    }
+    printf("\n%lu conflicts over %lu assets between %lu enabled archives\n",
+            conflicts.size(), stats.contested_assets, stats.enabled_archives);
+}
+
+static void listLintIssues(void) {
+    queueMasterGraphLoad();
+    LoadOrderLinter linter(getGlobalModList());
+    linter.relintAll(&waitForMasterGraph());
+
+    for (SkyrimMod mod : getGlobalModList()) {
+        if (linter.getIssues(mod.getId()) != 0) {
+            std::string_view name = mod.getBaseName();
+            printf("%.*s: %s\n", (int) name.size(), name.data(), linter.describe(mod.getId()).c_str());
+        }
+    }
+
+    LintCounts const &counts = linter.getCounts();
+    printf("\n%lu mods with warnings: %lu with disabled masters, %lu with missing masters, "
+            "%lu with masters loading later, %lu with orphaned archives, %lu with half-registered animations\n",
+            counts.flagged, counts.issues[0], counts.issues[1], counts.issues[2], counts.issues[3], counts.issues[4]);
+}
+
+static bool sortMods(void) {
+    queueMasterGraphLoad();
+    MasterGraph const &graph = waitForMasterGraph();
+
+    LoadOrderSortResult result;
+    std::vector<ModId> order;
+    sortLoadOrder(getGlobalModList(), graph, order, &result);
+    getGlobalModList().reorder(order);
+
+    printf("Sorted %lu plugins with %lu masters between them: %lu moved, %lu masters missing, "
+            "%lu masters not flagged as such\n",
+            result.plugins, result.dependencies, result.moved, result.missing_masters, result.flag_conflicts);
+    for (std::vector<ModId> const &cycle : result.cycles) {
+        printf("Master cycle:");
+        for (size_t i = 0; i < cycle.size(); i++) {
+            std::string_view name = getGlobalModStore().getBaseName(cycle[i]);
+            printf("%s %.*s", i == 0 ? "" : ",", (int) name.size(), name.data());
+        }
+        printf("\n");
+    }
+    if (result.cycle_count > result.cycles.size()) {
+        printf("... and %lu more cycles\n", result.cycle_count - result.cycles.size());
+    }
+
+    return result.moved > 0;
+}
+
+static int saveChanges(void) {
+    u64 save_start = armGetSystemTick();
+    size_t bytes_written;
+    bool wrote_plugins;
+    int wrote_inis;
+    if (RC_FAILURE(writeChanges(&bytes_written, &wrote_plugins, &wrote_inis))) {
+        fprintf(stderr, "\nFailed to write changes\n");
+        return -1;
+    }
+    u64 save_time = armTicksToNs(armGetSystemTick() - save_start);
+
+    printf("Wrote %lu bytes (Plugins: %s, %s: %s, language INI: %s) in %lu us\n", bytes_written,
+            wrote_plugins ? "yes" : "no",
+            SKYRIM_INI_FILE, (wrote_inis & INI_WROTE_SKYRIM) ? "yes" : "no",
+            (wrote_inis & INI_WROTE_SKYRIM_LANG) ? "yes" : "no",
+            save_time / 1000);
+    return 0;
+}
+
+static void printTimings(void) {
+    char row[PHASE_ROW_LEN + 1];
+    formatPhaseRecord(NULL, row, sizeof(row));
+    fprintf(stderr, "\n%s\n", row);
+    for (PhaseRecord const &record : getPhaseRecords()) {
+        formatPhaseRecord(&record, row, sizeof(row));
+        fprintf(stderr, "%s\n", row);
+    }
+}
+
+static SkyrimMod findMod(const char *name) {
+    SkyrimMod mod = getGlobalModList().find(name);
+    if (!mod) {
+        fprintf(stderr, "No mod named %s\n", name);
+    }
+    return mod;
+}
+
+int main(int argc, char **argv) {
+    const char *romfs = getenv("SKYMM_ROMFS");
+    const char *lang = getenv("SKYMM_LANG");
+    bool timings = false;
+
+    int argi = 1;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        if (strcmp(argv[argi], "--romfs") == 0 && argi + 1 < argc) {
+            romfs = argv[++argi];
+        } else if (strcmp(argv[argi], "--lang") == 0 && argi + 1 < argc) {
+            lang = argv[++argi];
+        } else if (strcmp(argv[argi], "--timings") == 0) {
+            timings = true;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (argi >= argc) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    std::string command = argv[argi++];
+    int expected_args;
+    if (command == "list" || command == "masters" || command == "sort" || command == "conflicts"
+            || command == "lint" || command == "save") {
+        expected_args = 0;
+    } else if (command == "enable" || command == "disable") {
+        expected_args = 1;
+    } else if (command == "move") {
+        expected_args = 2;
+    } else {
+        expected_args = -1;
+    }
+
+    if (argc - argi != expected_args) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    if (romfs == NULL) {
+        fprintf(stderr, "No romfs directory given (use --romfs or set SKYMM_ROMFS)\n");
+        return 2;
+    }
+    setBaseRomfsPath(romfs);
+
+    if (lang != NULL && RC_FAILURE(shimSetLanguage(lang))) {
+        fprintf(stderr, "Unrecognized language code %s\n", lang);
+        return 2;
+    }
+
+    consoleInit(NULL);
+
+    u64 load_start = armGetSystemTick();
+    if (RC_FAILURE(loadModList())) {
+        consoleExit(NULL);
+        fprintf(stderr, "\nFailed to load the mod list\n");
+        return 1;
+    }
+    u64 load_time = armTicksToNs(armGetSystemTick() - load_start);
+    printf("Loaded %lu mods in %lu us\n", getGlobalModList().size(), load_time / 1000);
+
+    int rc = 0;
+    if (command == "list") {
+        listMods();
+    } else if (command == "masters") {
+        listMasters();
+    } else if (command == "sort") {
+        rc = sortMods() ? saveChanges() : 0;
+    } else if (command == "conflicts") {
+        listConflicts();
+    } else if (command == "lint") {
+        listLintIssues();
+    } else if (command == "save") {
+        rc = saveChanges();
+    } else {
+        SkyrimMod mod = findMod(argv[argi]);
+        if (!mod) {
+            rc = 1;
+        } else if (command == "move") {
+            char *end;
+            unsigned long pos = strtoul(argv[argi + 1], &end, 10);
+            if (*end != '\0' || pos >= getGlobalModList().size()) {
+                fprintf(stderr, "Position must be between 0 and %lu\n", getGlobalModList().size() - 1);
+                rc = 2;
+            } else {
+                getGlobalModList().move(getGlobalModList().indexOf(mod.getBaseName()), pos);
+                rc = saveChanges();
+            }
+        } else if (mod.isMissing()) {
+            fprintf(stderr, "%s is no longer present in the Data directory\n", argv[argi]);
+            rc = 1;
+        } else {
+            if (command == "enable") {
+                mod.enable();
+            } else {
+                mod.disable();
+            }
+            rc = saveChanges();
+        }
+    }
+
+    if (timings) {
+        printTimings();
+    }
+
+    consoleExit(NULL);
+    return rc < 0 ? 1 : rc;
+}
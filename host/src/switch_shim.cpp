@@ -0,0 +1,134 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "switch_shim.hpp"
+
+#include <switch.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include <cstring>
+
+static const char *g_language_codes[SetLanguage_Total] = {
+    "ja", "en-US", "fr", "de", "it", "es", "zh-CN", "ko", "nl",
+    "pt", "ru", "zh-TW", "en-GB", "fr-CA", "es-419", "zh-Hans", "zh-Hant", "pt-BR"
+};
+
+static u64 g_language_code = 0;
+static u64 g_exo_version = SHIM_DEFAULT_EXO_VERSION;
+
+// libnx packs language codes into a u64 as a NUL-padded string
+static u64 packLanguageCode(const char *code) {
+    u64 packed = 0;
+    memcpy(&packed, code, std::min(strlen(code), sizeof(packed)));
+    return packed;
+}
+
+int shimSetLanguage(const char *code) {
+    for (const char *known : g_language_codes) {
+        if (strcmp(known, code) == 0) {
+            g_language_code = packLanguageCode(code);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void shimSetExoVersion(uint32_t major, uint32_t minor, uint32_t micro) {
+    g_exo_version = ((u64) (major & 0xFF) << 56) | ((u64) (minor & 0xFF) << 48) | ((u64) (micro & 0xFF) << 40);
+}
+
+Result setInitialize(void) {
+    return 0;
+}
+
+void setExit(void) {
+}
+
+Result setGetSystemLanguage(u64 *language_code) {
+    if (g_language_code == 0) {
+        g_language_code = packLanguageCode(SHIM_DEFAULT_LANGUAGE);
+    }
+    *language_code = g_language_code;
+    return 0;
+}
+
+Result setMakeLanguage(u64 language_code, SetLanguage *language) {
+    for (int i = 0; i < SetLanguage_Total; i++) {
+        if (packLanguageCode(g_language_codes[i]) == language_code) {
+            *language = (SetLanguage) i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+Result splInitialize(void) {
+    return 0;
+}
+
+void splExit(void) {
+}
+
+Result splGetConfig(SplConfigItem config_item, u64 *out_config) {
+    if (config_item != SplConfigItem_ExosphereApiVersion) {
+        return 1;
+    }
+    *out_config = g_exo_version;
+    return 0;
+}
+
+// ticks are reported in nanoseconds so conversions are the identity
+u64 armGetSystemTick(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+u64 armGetSystemTickFreq(void) {
+    return 1000000000;
+}
+
+u64 armTicksToNs(u64 tick) {
+    return tick;
+}
+
+PrintConsole *consoleInit(PrintConsole *console) {
+    static PrintConsole s_console = { stdout };
+    return console != NULL ? console : &s_console;
+}
+
+void consoleUpdate(PrintConsole *console) {
+    fflush(console != NULL ? console->stream : stdout);
+}
+
+void consoleExit(PrintConsole *console) {
+    consoleUpdate(console);
+}
+
+void svcSleepThread(s64 nano) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(nano));
+}
@@ -0,0 +1,587 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "synth_install.hpp"
+
+#include "bsa_archive.hpp"
+#include "file_helper.hpp"
+#include "ini_helper.hpp"
+#include "mod.hpp"
+#include "path_helper.hpp"
+#include "plugin_header.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <cstdio>
+#include <cstring>
+
+struct SynthSuffix {
+    const char *suffix;
+    unsigned percent;
+    // which archive list the game expects the BSA in, 1 or 2
+    int list;
+    bool load_in_memory;
+    // folder the archive's assets go under, and their extension
+    const char *asset_root;
+    const char *asset_ext;
+};
+
+// Rough shape of Nexus mods: most ship textures and meshes, fewer ship sounds,
+// voices or animations.
+static const SynthSuffix g_synth_suffixes[] = {
+    { "", 30, 1, false, "scripts", ".pex" },
+    { "Textures", 70, 2, false, "textures", ".dds" },
+    { "Textures1", 35, 2, false, "textures", ".dds" },
+    { "Meshes", 60, 1, false, "meshes", ".nif" },
+    { "Animations", 25, 1, true, "meshes\\actors\\character\\animations", ".hkx" },
+    { "Sounds", 30, 1, false, "sound\\fx", ".wav" },
+    { "Voices_en0", 15, 2, false, "sound\\voice", ".fuz" },
+};
+
+static const char *g_synth_words_1[] = {
+    "Immersive", "Enhanced", "Better", "Realistic", "Static", "Unofficial", "Legacy of the",
+    "Cutting Room", "Lore Friendly", "Ordinary", "Alternate", "Ultimate", "Simple", "Dynamic",
+};
+
+static const char *g_synth_words_2[] = {
+    "Armors", "Weapons", "Lighting", "Water", "Dragons", "Followers", "Cities", "Mesh Improvement",
+    "Patch", "Landscapes", "Interiors", "Horses", "Animations", "Sounds", "Dungeons", "Quests",
+};
+
+static const char *g_vanilla_masters[] = {
+    "Skyrim", "Update", "Dawnguard", "HearthFires", "Dragonborn",
+};
+
+static const char *g_vanilla_list_1[] = {
+    "Skyrim - Misc.bsa", "Skyrim - Shaders.bsa", "Skyrim - Interface.bsa", "Skyrim - Animations.bsa",
+    "Skyrim - Meshes0.bsa", "Skyrim - Meshes1.bsa", "Skyrim - Sounds.bsa",
+};
+
+static const char *g_vanilla_list_2[] = {
+    "Skyrim - Voices_en0.bsa", "Skyrim - Textures0.bsa", "Skyrim - Textures1.bsa", "Skyrim - Textures2.bsa",
+    "Skyrim - Textures3.bsa", "Skyrim - Textures4.bsa", "Skyrim - Textures5.bsa", "Skyrim - Textures6.bsa",
+    "Skyrim - Textures7.bsa", "Skyrim - Textures8.bsa",
+};
+
+#define SYNTH_ARRAY_LEN(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+// splitmix64, so a given seed produces the same tree on every platform
+uint64_t nextRandom(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static bool rollPercent(uint64_t &state, unsigned percent) {
+    return nextRandom(state) % 100 < percent;
+}
+
+// separates the stream deciding plugin masters from the one shaping the tree, so
+// adding headers didn't change the names or load order generated for a seed
+#define SYNTH_MASTER_SEED_SALT 0x4D415354 // "MAST"
+// and likewise for the stream filling archives
+#define SYNTH_ARCHIVE_SEED_SALT 0x42534120 // "BSA "
+
+// assets under each root which many mods replace, giving archives something to
+// conflict over
+#define SYNTH_SHARED_ASSETS 2000
+#define SYNTH_SHARED_FOLDERS 40
+
+// A data file which isn't left empty: the content to write, followed by padding
+// bytes standing in for whatever else the file would hold.
+struct SynthContent {
+    size_t file_index;
+    std::string content;
+    size_t padding;
+};
+
+static int writeDataFile(std::string const &path, SynthContent const *content) {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    bool failed = false;
+    if (content != NULL) {
+        static const char zeroes[1024] = {};
+        failed = fwrite(content->content.data(), 1, content->content.size(), file) != content->content.size();
+        for (size_t left = content->padding; left > 0 && !failed; ) {
+            size_t chunk = std::min(left, sizeof(zeroes));
+            failed = fwrite(zeroes, 1, chunk, file) != chunk;
+            left -= chunk;
+        }
+    }
+
+    fclose(file);
+    return failed ? -1 : 0;
+}
+
+template<typename T>
+static void appendField(std::string &out, T val) {
+    out.append((const char *) &val, sizeof(T));
+}
+
+static void appendSubrecord(std::string &out, const char *type, std::string_view data) {
+    out.append(type, 4);
+    appendField<uint16_t>(out, data.size());
+    out.append(data.data(), data.size());
+}
+
+// Builds the TES4 record at the start of a plugin, declaring masters.
+static std::string buildPluginHeader(bool master_flag, std::vector<std::string> const &masters,
+        std::string const &description) {
+    std::string subrecords;
+    std::string hedr;
+    appendField<float>(hedr, 1.71f);
+    appendField<uint32_t>(hedr, 0);
+    appendField<uint32_t>(hedr, 0x800);
+    appendSubrecord(subrecords, "HEDR", hedr);
+    appendSubrecord(subrecords, "CNAM", std::string_view("SkyMM-NX\0", 9));
+    if (!description.empty()) {
+        appendSubrecord(subrecords, "SNAM", std::string_view(description.c_str(), description.size() + 1));
+    }
+    for (std::string const &master : masters) {
+        appendSubrecord(subrecords, "MAST", std::string_view(master.c_str(), master.size() + 1));
+        appendSubrecord(subrecords, "DATA", std::string(8, '\0'));
+    }
+
+    std::string plugin = "TES4";
+    appendField<uint32_t>(plugin, subrecords.size());
+    appendField<uint32_t>(plugin, master_flag ? TES4_FLAG_MASTER : 0);
+    appendField<uint32_t>(plugin, 0);
+    appendField<uint32_t>(plugin, 0);
+    appendField<uint16_t>(plugin, 44);
+    appendField<uint16_t>(plugin, 0);
+    plugin += subrecords;
+    return plugin;
+}
+
+// Returns the path of one of the assets under suffix's root which vanilla
+// archives provide and mods replace.
+static std::string getSharedAssetPath(SynthSuffix const &suffix, size_t shared) {
+    char path[160];
+    snprintf(path, sizeof(path), "%s\\common%02lu\\asset%04lu%s", suffix.asset_root, shared % SYNTH_SHARED_FOLDERS,
+            shared, suffix.asset_ext);
+    return path;
+}
+
+// Returns the mod archive kind a vanilla archive matches by suffix, e.g. Textures
+// for "Skyrim - Textures3.bsa", or null for kinds mods don't ship.
+static SynthSuffix const *findVanillaSuffix(std::string_view archive) {
+    std::string_view suffix = archive.substr(archive.find(" - ") + 3);
+    for (SynthSuffix const &candidate : g_synth_suffixes) {
+        if (*candidate.suffix != '\0' && suffix.substr(0, strlen(candidate.suffix)) == candidate.suffix) {
+            return &candidate;
+        }
+    }
+    return NULL;
+}
+
+// Builds an archive directory holding the given assets (full paths), grouped
+// into folders and sorted by hash the way archiving tools lay them out. File
+// names follow the records, and the file data is left to the caller to pad out.
+static std::string buildArchiveDirectory(uint32_t version, std::vector<std::string> const &paths) {
+    struct SynthFile {
+        uint64_t hash;
+        std::string name;
+    };
+    struct SynthFolder {
+        uint64_t hash;
+        std::string name;
+        std::vector<SynthFile> files;
+    };
+
+    std::vector<SynthFolder> folders;
+    for (std::string const &path : paths) {
+        size_t slash = path.rfind('\\');
+        std::string folder_name = path.substr(0, slash);
+        uint64_t folder_hash = hashBsaFolder(folder_name);
+        auto it = std::find_if(folders.begin(), folders.end(), [&](SynthFolder const &folder) {
+            return folder.hash == folder_hash;
+        });
+        if (it == folders.end()) {
+            it = folders.insert(folders.end(), { folder_hash, folder_name, {} });
+        }
+        it->files.push_back({ hashBsaFile(path.substr(slash + 1)), path.substr(slash + 1) });
+    }
+
+    uint32_t folder_names_length = 0;
+    uint32_t file_names_length = 0;
+    std::sort(folders.begin(), folders.end(), [](SynthFolder const &a, SynthFolder const &b) {
+        return a.hash < b.hash;
+    });
+    for (SynthFolder &folder : folders) {
+        std::sort(folder.files.begin(), folder.files.end(), [](SynthFile const &a, SynthFile const &b) {
+            return a.hash < b.hash;
+        });
+        folder_names_length += folder.name.size() + 1;
+        for (SynthFile const &file : folder.files) {
+            file_names_length += file.name.size() + 1;
+        }
+    }
+
+    BsaHeader header = { version, BSA_FLAG_FOLDER_NAMES | BSA_FLAG_FILE_NAMES, (uint32_t) folders.size(),
+            (uint32_t) paths.size(), folder_names_length };
+    size_t dir_size = header.getDirectorySize();
+
+    std::string out("BSA\0", 4);
+    appendField<uint32_t>(out, version);
+    appendField<uint32_t>(out, BSA_HEADER_SIZE);
+    appendField<uint32_t>(out, header.flags);
+    appendField<uint32_t>(out, header.folder_count);
+    appendField<uint32_t>(out, header.file_count);
+    appendField<uint32_t>(out, folder_names_length);
+    appendField<uint32_t>(out, file_names_length);
+    appendField<uint32_t>(out, 0);
+
+    // folder offsets point at the folder's name, oddly counting the file names too
+    size_t block_off = dir_size - paths.size() * BSA_FILE_RECORD_SIZE - folders.size() - folder_names_length;
+    for (SynthFolder const &folder : folders) {
+        appendField<uint64_t>(out, folder.hash);
+        appendField<uint32_t>(out, folder.files.size());
+        if (version == BSA_VERSION_SKYRIM_SE) {
+            appendField<uint32_t>(out, 0);
+            appendField<uint64_t>(out, block_off + file_names_length);
+        } else {
+            appendField<uint32_t>(out, block_off + file_names_length);
+        }
+        block_off += 1 + folder.name.size() + 1 + folder.files.size() * BSA_FILE_RECORD_SIZE;
+    }
+
+    size_t data_off = dir_size + file_names_length;
+    for (SynthFolder const &folder : folders) {
+        appendField<uint8_t>(out, folder.name.size() + 1);
+        out.append(folder.name.c_str(), folder.name.size() + 1);
+        for (SynthFile const &file : folder.files) {
+            appendField<uint64_t>(out, file.hash);
+            appendField<uint32_t>(out, 64);
+            appendField<uint32_t>(out, data_off);
+            data_off += 64;
+        }
+    }
+
+    for (SynthFolder const &folder : folders) {
+        for (SynthFile const &file : folder.files) {
+            out.append(file.name.c_str(), file.name.size() + 1);
+        }
+    }
+    return out;
+}
+
+static void appendListEntry(std::string &list, std::string const &entry) {
+    if (!list.empty()) {
+        list += ", ";
+    }
+    list += entry;
+}
+
+int generateInstall(const char *romfs_dir, SynthConfig const &config, SynthStats *stats) {
+    *stats = {};
+
+    std::error_code ec;
+    std::filesystem::remove_all(romfs_dir, ec);
+    std::string data_dir = std::string(romfs_dir) + "/" + SKYRIM_DATA_DIR;
+    if (!std::filesystem::create_directories(data_dir, ec)) {
+        fprintf(stderr, "Failed to create %s\n", data_dir.c_str());
+        return -1;
+    }
+    // loose asset directories sit alongside the archives in real installs
+    for (const char *loose_dir : { "meshes", "textures", "scripts", "interface" }) {
+        std::filesystem::create_directory(data_dir + "/" + loose_dir, ec);
+    }
+
+    uint64_t rng = config.seed;
+
+    std::string list_1;
+    std::string list_2;
+    std::string list_3 = "Skyrim - Animations.bsa";
+    for (const char *archive : g_vanilla_list_1) {
+        appendListEntry(list_1, archive);
+    }
+    for (const char *archive : g_vanilla_list_2) {
+        appendListEntry(list_2, archive);
+    }
+
+    uint64_t master_rng = config.seed ^ SYNTH_MASTER_SEED_SALT;
+    uint64_t archive_rng = config.seed ^ SYNTH_ARCHIVE_SEED_SALT;
+    std::vector<std::string> data_files;
+    // the files which aren't left empty, in data_files order
+    std::vector<SynthContent> data_contents;
+
+    std::vector<std::string> vanilla_masters;
+    for (const char *master : g_vanilla_masters) {
+        std::string file_name = std::string(master) + "." EXT_ESM;
+        // Update.esm and the DLCs build on Skyrim.esm, and the DLCs on Update.esm too
+        std::vector<std::string> masters(vanilla_masters.begin(),
+                vanilla_masters.begin() + std::min(vanilla_masters.size(), (size_t) 2));
+        stats->master_refs += masters.size();
+        data_contents.push_back({ data_files.size(), buildPluginHeader(true, masters, ""), 0 });
+        data_files.push_back(file_name);
+        vanilla_masters.push_back(file_name);
+    }
+    // synthetic plugins generated so far, which later ones may depend on
+    std::vector<std::string> earlier_esms;
+    std::vector<std::string> earlier_esps;
+
+    // the vanilla archives hold the shared assets, split between those of the same
+    // kind the way the textures are split over Skyrim - Textures0.bsa and on
+    std::vector<std::pair<const char *, SynthSuffix const *>> vanilla_archives;
+    for (const char *archive : g_vanilla_list_1) {
+        vanilla_archives.emplace_back(archive, findVanillaSuffix(archive));
+    }
+    for (const char *archive : g_vanilla_list_2) {
+        vanilla_archives.emplace_back(archive, findVanillaSuffix(archive));
+    }
+    for (size_t i = 0; i < vanilla_archives.size(); i++) {
+        SynthSuffix const *suffix = vanilla_archives[i].second;
+        size_t shard = 0;
+        size_t shard_count = 0;
+        for (size_t j = 0; j < vanilla_archives.size(); j++) {
+            if (vanilla_archives[j].second == suffix) {
+                shard += j < i;
+                shard_count++;
+            }
+        }
+
+        std::vector<std::string> paths;
+        for (size_t shared = shard; suffix != NULL && shared < SYNTH_SHARED_ASSETS; shared += shard_count) {
+            paths.push_back(getSharedAssetPath(*suffix, shared));
+        }
+        // the archives of no mod kind still list a few files of their own
+        for (size_t j = 0; suffix == NULL && j < 16; j++) {
+            paths.push_back("interface\\vanilla" + std::to_string(i) + "\\file" + std::to_string(j) + ".swf");
+        }
+        stats->archives++;
+        stats->archive_assets += paths.size();
+
+        data_contents.push_back({ data_files.size(), buildArchiveDirectory(BSA_VERSION_SKYRIM_SE, paths),
+                paths.size() * 64 });
+        data_files.push_back(vanilla_archives[i].first);
+    }
+
+    // (plugin file name, enabled) in Plugins file order
+    std::vector<std::pair<std::string, bool>> plugins;
+
+    for (size_t i = 0; i < config.mod_count; i++) {
+        char name_buf[96];
+        snprintf(name_buf, sizeof(name_buf), "%s %s %05lu",
+                g_synth_words_1[nextRandom(rng) % SYNTH_ARRAY_LEN(g_synth_words_1)],
+                g_synth_words_2[nextRandom(rng) % SYNTH_ARRAY_LEN(g_synth_words_2)],
+                i);
+        std::string name = name_buf;
+
+        // 80% ESP, 5% ESM, the rest pure replacers with no plugin
+        unsigned kind = nextRandom(rng) % 100;
+        const char *plugin_ext = kind < 80 ? "." EXT_ESP : kind < 85 ? "." EXT_ESM : NULL;
+        bool enabled = rollPercent(rng, config.enabled_percent);
+
+        if (plugin_ext != NULL) {
+            stats->plugin_mods++;
+            bool is_esm = kind >= 80;
+
+            // everything needs Skyrim.esm, most things Update.esm, some a DLC,
+            // and many build on other mods' masters or, as patches, their plugins
+            std::vector<std::string> masters = { vanilla_masters[0] };
+            if (rollPercent(master_rng, 60)) {
+                masters.push_back(vanilla_masters[1]);
+            }
+            if (rollPercent(master_rng, 20)) {
+                masters.push_back(vanilla_masters[2 + nextRandom(master_rng) % (vanilla_masters.size() - 2)]);
+            }
+            size_t mod_masters = nextRandom(master_rng) % 4;
+            for (size_t j = 0; j < mod_masters; j++) {
+                bool from_esps = !is_esm && !earlier_esps.empty() && (earlier_esms.empty() || rollPercent(master_rng, 30));
+                std::vector<std::string> const &pool = from_esps ? earlier_esps : earlier_esms;
+                if (pool.empty()) {
+                    break;
+                }
+                std::string const &master = pool[nextRandom(master_rng) % pool.size()];
+                if (std::find(masters.begin(), masters.end(), master) == masters.end()) {
+                    masters.push_back(master);
+                }
+            }
+            // the odd plugin whose master was never installed
+            if (rollPercent(master_rng, 1)) {
+                masters.push_back("Missing Dependency " + std::to_string(nextRandom(master_rng) % 100000) + "." EXT_ESM);
+            }
+
+            // and the odd one with a description long enough to spill past the first read
+            std::string description;
+            if (nextRandom(master_rng) % 200 == 0) {
+                description.assign(PLUGIN_HEADER_READ_SIZE + nextRandom(master_rng) % 2048, 'x');
+                stats->long_headers++;
+            }
+            stats->master_refs += masters.size();
+
+            // the records after the header, which the reader should never get to
+            size_t padding = 1024 + nextRandom(master_rng) % 8192;
+            data_contents.push_back({ data_files.size(), buildPluginHeader(is_esm, masters, description), padding });
+            (is_esm ? earlier_esms : earlier_esps).push_back(name + plugin_ext);
+
+            data_files.push_back(name + plugin_ext);
+            if (rollPercent(rng, config.listed_percent)) {
+                plugins.emplace_back(name + plugin_ext, enabled);
+            } else {
+                enabled = false;
+            }
+        }
+
+        auto add_archive = [&](SynthSuffix const &suffix) {
+            std::string archive = name;
+            if (*suffix.suffix != '\0') {
+                archive += " - ";
+                archive += suffix.suffix;
+            }
+            archive += "." EXT_BSA;
+
+            // mostly assets of the mod's own, plus some shared ones, and the odd
+            // archive too big for its directory to fit the first read
+            size_t asset_count = 4 + nextRandom(archive_rng) % 40;
+            if (nextRandom(archive_rng) % 150 == 0) {
+                asset_count = 600 + nextRandom(archive_rng) % 900;
+                stats->long_directories++;
+            }
+            std::vector<std::string> paths;
+            for (size_t j = 0; j < asset_count; j++) {
+                std::string path;
+                if (rollPercent(archive_rng, 25)) {
+                    path = getSharedAssetPath(suffix, nextRandom(archive_rng) % SYNTH_SHARED_ASSETS);
+                } else {
+                    char path_buf[160];
+                    snprintf(path_buf, sizeof(path_buf), "%s\\mod%05lu\\%s\\file%04lu%s", suffix.asset_root, i,
+                            *suffix.suffix != '\0' ? suffix.suffix : "main", j, suffix.asset_ext);
+                    path = path_buf;
+                }
+                if (std::find(paths.begin(), paths.end(), path) == paths.end()) {
+                    paths.push_back(path);
+                }
+            }
+            stats->archives++;
+            stats->archive_assets += paths.size();
+
+            uint32_t version = rollPercent(archive_rng, 80) ? BSA_VERSION_SKYRIM_SE : BSA_VERSION_SKYRIM;
+            // the file data after the directory, which the reader should never get to
+            size_t padding = paths.size() * 64;
+            data_contents.push_back({ data_files.size(), buildArchiveDirectory(version, paths), padding });
+            data_files.push_back(archive);
+
+            if (enabled) {
+                appendListEntry(suffix.list == 2 ? list_2 : list_1, archive);
+                if (suffix.load_in_memory) {
+                    appendListEntry(list_3, archive);
+                }
+            }
+        };
+
+        size_t bsa_count = 0;
+        for (SynthSuffix const &suffix : g_synth_suffixes) {
+            if (rollPercent(rng, suffix.percent)) {
+                add_archive(suffix);
+                bsa_count++;
+            }
+        }
+        // a replacer needs at least one archive to be a mod at all
+        if (plugin_ext == NULL && bsa_count == 0) {
+            add_archive(g_synth_suffixes[1]);
+        }
+
+        // SKSE-style configs and readmes, which the scanner has to look at and skip
+        if (rollPercent(rng, 40)) {
+            data_files.push_back(name + ".ini");
+        }
+        if (rollPercent(rng, 30)) {
+            data_files.push_back(name + " - Readme.txt");
+        }
+    }
+
+    size_t next_content = 0;
+    for (size_t i = 0; i < data_files.size(); i++) {
+        SynthContent const *content = NULL;
+        if (next_content < data_contents.size() && data_contents[next_content].file_index == i) {
+            content = &data_contents[next_content++];
+        }
+        if (writeDataFile(data_dir + "/" + data_files[i], content) != 0) {
+            fprintf(stderr, "Failed to create %s\n", data_files[i].c_str());
+            return -1;
+        }
+    }
+    stats->data_files = data_files.size();
+
+    // Fisher-Yates so the load order doesn't follow discovery order
+    for (size_t i = plugins.size(); i > 1; i--) {
+        std::swap(plugins[i - 1], plugins[nextRandom(rng) % i]);
+    }
+
+    std::string plugins_data = "# This file is used by Skyrim to keep track of your downloaded content.\n"
+            "# Please do not modify this file.\n";
+    for (std::pair<std::string, bool> const &plugin : plugins) {
+        plugins_data += plugin.second ? "*" : "";
+        plugins_data += plugin.first;
+        plugins_data += '\n';
+        // the odd entry for a plugin that has since been deleted
+        if (rollPercent(rng, 2)) {
+            plugins_data += "*Uninstalled Mod " + std::to_string(nextRandom(rng) % 100000) + "." EXT_ESP "\n";
+        }
+    }
+    stats->plugins_lines = std::count(plugins_data.begin(), plugins_data.end(), '\n');
+
+    std::string skyrim_ini = "[General]\n"
+            "sLanguage=ENGLISH\n"
+            "uExterior Cell Buffer=36\n"
+            "\n"
+            "[Display]\n"
+            "fShadowLODMaxStartFade=1000.0\n"
+            "fSpecularLODMaxStartFade=2000.0\n"
+            "\n"
+            "[" INI_SECTION_ARCHIVE "]\n"
+            "bInvalidateOlderFiles=1\n"
+            INI_ARCHIVE_LIST_1 "=" + list_1 + "\n"
+            INI_ARCHIVE_LIST_3 "=" + list_3 + "\n";
+
+    std::string lang_ini = "[General]\n"
+            "sLanguage=ENGLISH\n"
+            "\n"
+            "[" INI_SECTION_ARCHIVE "]\n"
+            INI_ARCHIVE_LIST_2 "=" + list_2 + "\n";
+
+    std::string lang_ini_name = std::string(SKYRIM_INI_LANG_FILE_PREFIX) + config.lang + ".ini";
+    std::string romfs = romfs_dir;
+    if (writeFileAtomic((romfs + "/" + SKYRIM_PLUGINS_FILE).c_str(), plugins_data) != 0
+            || writeFileAtomic((romfs + "/" + SKYRIM_INI_FILE).c_str(), skyrim_ini) != 0
+            || writeFileAtomic((romfs + "/" + lang_ini_name).c_str(), lang_ini) != 0) {
+        fprintf(stderr, "Failed to write the Plugins file or INIs under %s\n", romfs_dir);
+        return -1;
+    }
+    stats->archive_list_bytes = list_1.size() + list_2.size() + list_3.size();
+
+    return 0;
+}
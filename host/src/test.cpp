@@ -0,0 +1,329 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Unit tests for the platform-neutral parts of the core. The input scheduler
+// is driven by scripted button states against a fake clock, and INI edits are
+// checked byte for byte.
+
+#include "error_defs.hpp"
+#include "ini_file.hpp"
+#include "input_scheduler.hpp"
+#include "mod_manager.hpp"
+#include "path_helper.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstdio>
+
+#define CHECK(cond) if (!(cond)) { \
+                        fprintf(stderr, "  %s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+                        g_failures++; \
+                    }
+
+#define BUTTON_A (1ull << 0)
+#define BUTTON_B (1ull << 1)
+#define BUTTON_UP (1ull << 13)
+#define BUTTON_DOWN (1ull << 15)
+
+#define MS(n) ((uint64_t) (n) * 1000000ull)
+
+static unsigned g_failures = 0;
+
+static const KeyRepeatConfig g_repeat = {
+    BUTTON_UP | BUTTON_DOWN,
+    MS(300),
+    MS(320),
+    MS(40),
+    50
+};
+
+// the button state the pad reports from a given time on
+struct ScriptStep {
+    uint64_t time;
+    uint64_t buttons;
+};
+
+struct TimedEvent {
+    uint64_t time;
+    InputEvent event;
+};
+
+// Feeds each step to the scheduler at its time and collects what it emits.
+static std::vector<TimedEvent> runScript(InputScheduler &input, std::vector<ScriptStep> const &script) {
+    std::vector<TimedEvent> out;
+    std::vector<InputEvent> events;
+    for (ScriptStep const &step : script) {
+        events.clear();
+        input.update(step.buttons, step.time, events);
+        for (InputEvent const &event : events) {
+            out.push_back({ step.time, event });
+        }
+    }
+    return out;
+}
+
+static bool isEvent(TimedEvent const &timed, uint64_t time, InputEventType type, uint64_t button) {
+    return timed.time == time && timed.event.type == type && timed.event.button == button;
+}
+
+static void testPressHoldRelease(void) {
+    InputScheduler input(g_repeat);
+    std::vector<TimedEvent> events = runScript(input, {
+        { MS(0), 0 },
+        { MS(10), BUTTON_A },
+        { MS(500), BUTTON_A },
+        { MS(1000), BUTTON_A | BUTTON_B },
+        { MS(1010), BUTTON_B },
+        { MS(1020), 0 },
+        { MS(1030), BUTTON_A | BUTTON_B },
+    });
+
+    // buttons without repeat only report their edges, however long they're held
+    CHECK(events.size() == 6);
+    if (events.size() == 6) {
+        CHECK(isEvent(events[0], MS(10), InputEventType::PRESS, BUTTON_A));
+        CHECK(isEvent(events[1], MS(1000), InputEventType::PRESS, BUTTON_B));
+        CHECK(isEvent(events[2], MS(1010), InputEventType::RELEASE, BUTTON_A));
+        CHECK(isEvent(events[3], MS(1020), InputEventType::RELEASE, BUTTON_B));
+        CHECK(isEvent(events[4], MS(1030), InputEventType::PRESS, BUTTON_A));
+        CHECK(isEvent(events[5], MS(1030), InputEventType::PRESS, BUTTON_B));
+    }
+    CHECK(input.getHeld() == (BUTTON_A | BUTTON_B));
+}
+
+static void testRepeat(void) {
+    InputScheduler input(g_repeat);
+    std::vector<InputEvent> events;
+
+    input.update(BUTTON_DOWN, MS(0), events);
+    CHECK(events.size() == 1 && events[0].type == InputEventType::PRESS);
+
+    // nothing before the initial delay
+    events.clear();
+    input.update(BUTTON_DOWN, MS(299), events);
+    CHECK(events.empty());
+
+    // step the clock straight to each deadline, as the main loop does when idle
+    const uint64_t expected_gaps[] = { MS(300), MS(320), MS(160), MS(80), MS(40), MS(40), MS(40) };
+    uint64_t last = MS(0);
+    for (uint64_t gap : expected_gaps) {
+        uint64_t deadline = input.nextDeadline();
+        CHECK(deadline == last + gap);
+
+        events.clear();
+        input.update(BUTTON_DOWN, deadline, events);
+        CHECK(events.size() == 1 && events[0].type == InputEventType::REPEAT && events[0].button == BUTTON_DOWN);
+        last = deadline;
+    }
+
+    // a late update repeats once and doesn't queue up the missed repeats
+    uint64_t late = last + MS(1000);
+    events.clear();
+    input.update(BUTTON_DOWN, late, events);
+    CHECK(events.size() == 1);
+    CHECK(input.nextDeadline() == late + MS(40));
+
+    // pressing again starts over from the initial delay and interval
+    events.clear();
+    input.update(0, late + MS(10), events);
+    input.update(BUTTON_DOWN, late + MS(20), events);
+    CHECK(input.nextDeadline() == late + MS(20) + MS(300));
+    input.update(BUTTON_DOWN, late + MS(320), events);
+    CHECK(input.nextDeadline() == late + MS(320) + MS(320));
+}
+
+static void testRepeatHandover(void) {
+    InputScheduler input(g_repeat);
+    std::vector<TimedEvent> events = runScript(input, {
+        { MS(0), BUTTON_DOWN },
+        { MS(300), BUTTON_DOWN },
+        // the most recent repeatable press takes over
+        { MS(350), BUTTON_DOWN | BUTTON_UP },
+        { MS(650), BUTTON_DOWN | BUTTON_UP },
+        // releasing the other button doesn't stop it
+        { MS(700), BUTTON_UP },
+        { MS(750), BUTTON_UP },
+    });
+
+    CHECK(events.size() == 5);
+    if (events.size() == 5) {
+        CHECK(isEvent(events[0], MS(0), InputEventType::PRESS, BUTTON_DOWN));
+        CHECK(isEvent(events[1], MS(300), InputEventType::REPEAT, BUTTON_DOWN));
+        CHECK(isEvent(events[2], MS(350), InputEventType::PRESS, BUTTON_UP));
+        CHECK(isEvent(events[3], MS(650), InputEventType::REPEAT, BUTTON_UP));
+        CHECK(isEvent(events[4], MS(700), InputEventType::RELEASE, BUTTON_DOWN));
+    }
+    CHECK(input.nextDeadline() == MS(650) + MS(320));
+}
+
+static void testDeadline(void) {
+    InputScheduler input(g_repeat);
+    std::vector<InputEvent> events;
+
+    // idle, and while holding a button which doesn't repeat
+    CHECK(input.nextDeadline() == INPUT_NO_DEADLINE);
+    input.update(0, MS(5), events);
+    CHECK(input.nextDeadline() == INPUT_NO_DEADLINE);
+    input.update(BUTTON_A, MS(10), events);
+    CHECK(input.nextDeadline() == INPUT_NO_DEADLINE);
+
+    // holding a repeatable button
+    input.update(BUTTON_A | BUTTON_DOWN, MS(20), events);
+    CHECK(input.nextDeadline() == MS(20) + MS(300));
+    input.update(BUTTON_A | BUTTON_DOWN, MS(100), events);
+    CHECK(input.nextDeadline() == MS(20) + MS(300));
+
+    // releasing it goes back to idle even though another button is still held
+    input.update(BUTTON_A, MS(200), events);
+    CHECK(input.nextDeadline() == INPUT_NO_DEADLINE);
+    input.update(0, MS(210), events);
+    CHECK(input.nextDeadline() == INPUT_NO_DEADLINE);
+}
+
+// Checks that reading the file's bytes back gives the same values as the edited copy.
+static bool reparsesTo(IniFile const &ini, std::string_view section, std::string_view key) {
+    IniFile reparsed;
+    reparsed.parse(std::string(ini.getData()));
+    return reparsed.get(section, key) == ini.get(section, key);
+}
+
+static void testIniSetEmptyValue(void) {
+    IniFile ini;
+    ini.parse("[Archive]\nsResourceArchiveList2=\nsOther=keep\n\n[General]\nsLanguage=en\n");
+
+    ini.set("Archive", "sResourceArchiveList2", "A.bsa, B.bsa");
+    CHECK(ini.get("Archive", "sResourceArchiveList2") == "A.bsa, B.bsa");
+    CHECK(ini.get("Archive", "sOther") == "keep");
+
+    // the second save of a session edits the same, now spliced, value again
+    ini.set("Archive", "sResourceArchiveList2", "C.bsa");
+    CHECK(ini.get("Archive", "sResourceArchiveList2") == "C.bsa");
+    CHECK(ini.get("Archive", "sOther") == "keep");
+    CHECK(ini.getData() == "[Archive]\nsResourceArchiveList2=C.bsa\nsOther=keep\n\n[General]\nsLanguage=en\n");
+
+    // back to empty and out of it again
+    ini.set("Archive", "sResourceArchiveList2", "");
+    ini.set("Archive", "sResourceArchiveList2", "D.bsa");
+    ini.set("Archive", "sOther", "");
+    ini.set("Archive", "sOther", "kept");
+    ini.set("Archive", "sNew", "E.bsa");
+    ini.set("General", "sLanguage", "fr");
+    CHECK(ini.getData() == "[Archive]\nsResourceArchiveList2=D.bsa\nsOther=kept\nsNew=E.bsa\n\n"
+            "[General]\nsLanguage=fr\n");
+    CHECK(reparsesTo(ini, "Archive", "sResourceArchiveList2"));
+    CHECK(reparsesTo(ini, "Archive", "sOther"));
+    CHECK(reparsesTo(ini, "Archive", "sNew"));
+    CHECK(reparsesTo(ini, "General", "sLanguage"));
+}
+
+static void testIniSetEmptyValueAtEnd(void) {
+    // an empty value on the last line, without a newline after it
+    IniFile ini;
+    ini.parse("[Archive]\r\nsResourceArchiveList=");
+
+    ini.set("Archive", "sResourceArchiveList", "A.bsa");
+    ini.set("Archive", "sResourceArchiveList", "B.bsa");
+    ini.set("Archive", "sResourceArchiveList2", "C.bsa");
+    CHECK(ini.get("Archive", "sResourceArchiveList") == "B.bsa");
+    CHECK(ini.get("Archive", "sResourceArchiveList2") == "C.bsa");
+    CHECK(ini.getData() == "[Archive]\r\nsResourceArchiveList=B.bsa\r\nsResourceArchiveList2=C.bsa\r\n");
+}
+
+static void testIniInsertAfterEmptyValueAtEnd(void) {
+    // what a save does with an empty first archive list on the file's unterminated last line
+    IniFile ini;
+    ini.parse("[Archive]\nsResourceArchiveList=");
+
+    ini.set("Archive", "sResourceArchiveList", "");
+    ini.set("Archive", "sArchiveToLoadInMemoryList", "A.bsa");
+    CHECK(ini.getData() == "[Archive]\nsResourceArchiveList=\nsArchiveToLoadInMemoryList=A.bsa\n");
+
+    ini.set("Archive", "sResourceArchiveList", "B.bsa");
+    CHECK(ini.getData() == "[Archive]\nsResourceArchiveList=B.bsa\nsArchiveToLoadInMemoryList=A.bsa\n");
+    CHECK(reparsesTo(ini, "Archive", "sResourceArchiveList"));
+    CHECK(reparsesTo(ini, "Archive", "sArchiveToLoadInMemoryList"));
+}
+
+// A FATAL raised in another file has to stop the main loop in main.cpp.
+static void testFatalShared(void) {
+    g_fatal_occurred = false;
+    setBaseRomfsPath("/nonexistent/skymm-test");
+    CHECK(RC_FAILURE(discoverMods()));
+    CHECK(fatal_occurred());
+    g_fatal_occurred = false;
+}
+
+// A save failing on the worker has to reach the main loop once it's polled.
+static void testSaveFailureFatal(void) {
+    g_fatal_occurred = false;
+    setBaseRomfsPath("/nonexistent/skymm-test");
+    CHECK(RC_SUCCESS(queueSave()));
+    waitForSaves();
+    CHECK(!fatal_occurred());
+
+    SaveResult result;
+    CHECK(pollSave(&result));
+    CHECK(RC_FAILURE(result.rc));
+    CHECK(fatal_occurred());
+    g_fatal_occurred = false;
+}
+
+int main(void) {
+    struct {
+        const char *name;
+        void (*run)(void);
+    } tests[] = {
+        { "input_press_hold_release", testPressHoldRelease },
+        { "input_repeat", testRepeat },
+        { "input_repeat_handover", testRepeatHandover },
+        { "input_deadline", testDeadline },
+        { "ini_set_empty_value", testIniSetEmptyValue },
+        { "ini_set_empty_value_at_end", testIniSetEmptyValueAtEnd },
+        { "ini_insert_after_empty_value_at_end", testIniInsertAfterEmptyValueAtEnd },
+        { "fatal_shared", testFatalShared },
+        { "save_failure_fatal", testSaveFailureFatal },
+    };
+
+    // the core reports progress and errors to stdout, results go to stderr
+    if (freopen("/dev/null", "w", stdout) == NULL) {
+        return 1;
+    }
+
+    for (auto const &test : tests) {
+        unsigned failures_before = g_failures;
+        test.run();
+        fprintf(stderr, "%-36s %s\n", test.name, g_failures == failures_before ? "ok" : "FAILED");
+    }
+
+    if (g_failures != 0) {
+        fprintf(stderr, "%u check(s) failed\n", g_failures);
+        return 1;
+    }
+    return 0;
+}
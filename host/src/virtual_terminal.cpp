@@ -0,0 +1,226 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "virtual_terminal.hpp"
+
+#include <algorithm>
+#include <string>
+
+#include <cstdlib>
+
+VirtualTerminal::VirtualTerminal(size_t rows, size_t cols, unsigned cursor_origin, ConsoleStyle default_style):
+        rows(rows),
+        cols(cols),
+        cursor_origin(cursor_origin),
+        default_style(default_style),
+        grid(rows * cols, {' ', default_style}),
+        cursor_row(0),
+        cursor_col(0),
+        wrap_pending(false),
+        style(default_style),
+        region_top(0),
+        region_bottom(rows - 1),
+        pending(),
+        bad_sequence(false) {
+}
+
+void VirtualTerminal::reset(void) {
+    std::fill(grid.begin(), grid.end(), ConsoleCell {' ', default_style});
+    cursor_row = 0;
+    cursor_col = 0;
+    wrap_pending = false;
+    style = default_style;
+    region_top = 0;
+    region_bottom = rows - 1;
+    pending.clear();
+    bad_sequence = false;
+}
+
+void VirtualTerminal::putChar(char ch) {
+    if (wrap_pending) {
+        wrap_pending = false;
+        cursor_col = 0;
+        if (cursor_row == region_bottom) {
+            scrollRegion(1);
+        } else if (cursor_row + 1 < rows) {
+            cursor_row++;
+        }
+    }
+
+    grid[cursor_row * cols + cursor_col] = {ch, style};
+    if (cursor_col + 1 < cols) {
+        cursor_col++;
+    } else {
+        wrap_pending = true;
+    }
+}
+
+void VirtualTerminal::scrollRegion(int delta) {
+    size_t height = region_bottom - region_top + 1;
+    size_t dist = std::min((size_t) std::abs(delta), height);
+
+    auto region_begin = grid.begin() + region_top * cols;
+    auto region_end = grid.begin() + (region_bottom + 1) * cols;
+    // exposed lines are erased with the current background
+    ConsoleCell blank = {' ', {default_style.fg, style.bg, default_style.attr}};
+    if (delta > 0) {
+        std::copy(region_begin + dist * cols, region_end, region_begin);
+        std::fill(region_end - dist * cols, region_end, blank);
+    } else {
+        std::copy_backward(region_begin, region_end - dist * cols, region_end);
+        std::fill(region_begin, region_begin + dist * cols, blank);
+    }
+}
+
+void VirtualTerminal::applySequence(std::string const &params, char final_ch) {
+    unsigned args[2] = { 0, 0 };
+    size_t arg_count = 0;
+    if (!params.empty()) {
+        arg_count = 1;
+        for (char ch : params) {
+            if (ch == ';' && arg_count < 2) {
+                arg_count++;
+            } else if (ch >= '0' && ch <= '9') {
+                args[arg_count - 1] = args[arg_count - 1] * 10 + (ch - '0');
+            } else {
+                bad_sequence = true;
+                return;
+            }
+        }
+    }
+
+    switch (final_ch) {
+        case 'H': {
+            if (arg_count != 2 || args[0] < cursor_origin || args[1] < cursor_origin
+                    || args[0] - cursor_origin >= rows || args[1] - cursor_origin >= cols) {
+                bad_sequence = true;
+                return;
+            }
+            cursor_row = args[0] - cursor_origin;
+            cursor_col = args[1] - cursor_origin;
+            wrap_pending = false;
+            break;
+        }
+        case 'C': {
+            size_t dist = arg_count > 0 && args[0] > 0 ? args[0] : 1;
+            cursor_col = std::min(cursor_col + dist, cols - 1);
+            wrap_pending = false;
+            break;
+        }
+        case 'm': {
+            if (arg_count != 1) {
+                bad_sequence = true;
+            } else if (args[0] == 0) {
+                style = default_style;
+                style.attr = 0;
+            } else if (args[0] < 30) {
+                style.attr = args[0];
+            } else if (args[0] < 40) {
+                style.fg = args[0];
+            } else if (args[0] < 50) {
+                style.bg = args[0];
+            } else {
+                bad_sequence = true;
+            }
+            break;
+        }
+        case 'r': {
+            if (arg_count == 0) {
+                region_top = 0;
+                region_bottom = rows - 1;
+            } else if (arg_count == 2 && args[0] >= 1 && args[0] < args[1] && args[1] <= rows) {
+                region_top = args[0] - 1;
+                region_bottom = args[1] - 1;
+            } else {
+                bad_sequence = true;
+                return;
+            }
+            // setting the scroll region homes the cursor
+            cursor_row = 0;
+            cursor_col = 0;
+            wrap_pending = false;
+            break;
+        }
+        case 'S':
+        case 'T': {
+            int dist = arg_count > 0 && args[0] > 0 ? (int) args[0] : 1;
+            scrollRegion(final_ch == 'S' ? dist : -dist);
+            break;
+        }
+        default:
+            bad_sequence = true;
+            break;
+    }
+}
+
+void VirtualTerminal::write(const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        char ch = data[i];
+        if (!pending.empty()) {
+            if (pending.size() == 1) {
+                if (ch != '[') {
+                    bad_sequence = true;
+                    pending.clear();
+                    continue;
+                }
+                pending += ch;
+            } else if ((ch >= '0' && ch <= '9') || ch == ';') {
+                pending += ch;
+            } else {
+                applySequence(pending.substr(2), ch);
+                pending.clear();
+            }
+            continue;
+        }
+
+        if (ch == '\x1b') {
+            pending += ch;
+        } else if ((unsigned char) ch < ' ' || ch == '\x7f') {
+            // the renderer only ever draws printable characters
+            bad_sequence = true;
+        } else {
+            putChar(ch);
+        }
+    }
+}
+
+bool VirtualTerminal::matches(ConsoleRenderer const &renderer, size_t *row, size_t *col) const {
+    if (renderer.getRows() != rows || renderer.getColumns() != cols) {
+        *row = 0;
+        *col = 0;
+        return false;
+    }
+
+    for (size_t r = 0; r < rows; r++) {
+        for (size_t c = 0; c < cols; c++) {
+            if (grid[r * cols + c] != renderer.getCell(r, c)) {
+                *row = r;
+                *col = c;
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,170 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "bsa_archive.hpp"
+#include "file_helper.hpp"
+#include "mod.hpp"
+#include "string_helper.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#define ASSET_CACHE_FILE "SkyMM.assets.cache"
+
+#define ASSET_CACHE_MAGIC 0x414D4B53 // "SKMA"
+#define ASSET_CACHE_VERSION 1
+
+// archives handed to a worker at a time while reading directories
+#define ASSET_INDEX_BATCH 16
+
+enum class ArchiveStatus : uint8_t {
+    OK,
+    // the archive couldn't be opened or read
+    MISSING,
+    // the archive doesn't start with a well-formed header and directory
+    MALFORMED
+};
+
+struct AssetIndexStats {
+    size_t archives;
+    // directories kept from the last load or the cache, and directories read
+    // from their archives
+    size_t cached;
+    size_t read;
+    // archives which are missing or malformed
+    size_t failed;
+    // assets across every archive, and assets provided by more than one archive
+    size_t assets;
+    size_t shared_assets;
+    // bytes read from archives and the cache, and written to the cache
+    size_t bytes_read;
+    size_t bytes_written;
+};
+
+// Which archives provide each asset, as listed in the archives' directories.
+// Archives are kept in the order their file names were passed to load(), and
+// names are matched without regard to case, as the game does.
+class AssetIndex {
+    private:
+        struct Archive {
+            std::string file_name;
+            FileStamp stamp;
+            ArchiveStatus status;
+            std::vector<AssetHash> assets;
+        };
+
+        struct Entry {
+            AssetHash asset;
+            uint32_t archive;
+        };
+
+        std::vector<Archive> archives;
+        // every asset of every archive, sorted by asset and then by archive
+        std::vector<Entry> entries;
+
+        static inline bool entryLess(Entry const &a, Entry const &b) {
+            return a.asset != b.asset ? a.asset < b.asset : a.archive < b.archive;
+        }
+
+        // Reads the cached archives and index entries into cached and
+        // cached_entries, which are left empty if the cache is missing or malformed.
+        static void readCache(std::string const &path, std::vector<Archive> &cached,
+                std::vector<Entry> &cached_entries, size_t *bytes_read);
+
+    public:
+        // Lists the assets of each named archive in data_dir, on a pool of
+        // worker_count threads. Directories from the last load, or failing that
+        // from the cache at cache_path, are reused for archives whose size and
+        // mtime haven't changed, and the cache is rewritten if anything had to be
+        // read. Nothing here touches the console or phase timing, so the whole
+        // load may run on a worker thread.
+        int load(std::string const &data_dir, std::vector<std::string> const &file_names,
+                std::string const &cache_path, size_t worker_count, AssetIndexStats *stats);
+
+        void clear(void);
+
+        size_t size(void) const;
+
+        std::string const &getFileName(size_t i) const;
+
+        ArchiveStatus getStatus(size_t i) const;
+
+        size_t getAssetCount(size_t i) const;
+
+        // Appends the position of every archive which provides the asset, in
+        // ascending order, and returns how many there were.
+        size_t findProviders(AssetHash const &asset, std::vector<size_t> &providers) const;
+
+        // Calls fn(asset, first, count) for each asset provided by more than one
+        // archive, where the count archive positions from first are its
+        // providers in ascending order.
+        template<typename F>
+        void forEachShared(F fn) const {
+            std::vector<uint32_t> providers;
+            for (size_t i = 0; i < entries.size(); ) {
+                size_t end = i + 1;
+                while (end < entries.size() && entries[end].asset == entries[i].asset) {
+                    end++;
+                }
+                if (end - i > 1) {
+                    providers.clear();
+                    for (size_t j = i; j < end; j++) {
+                        providers.insert(providers.end(), entries[j].archive);
+                    }
+                    fn(entries[i].asset, providers.data(), providers.size());
+                }
+                i = end;
+            }
+        }
+};
+
+// Assets of one mod which are overridden by another's.
+struct AssetConflict {
+    // the mod whose archive the game takes the assets from
+    ModId winner;
+    // the mod whose archive provides them too
+    ModId loser;
+    size_t assets;
+};
+
+struct AssetConflictStats {
+    // assets provided by more than one enabled mod
+    size_t contested_assets;
+    // archives of mods in the list which are registered in an archive list
+    size_t enabled_archives;
+};
+
+// Finds every pair of mods in mod_list whose enabled archives provide the same
+// assets. Archives load in the order of their mods, so of the mods providing an
+// asset, the one furthest down the list wins and overrides each of the others.
+// Archives of the same mod never conflict with each other. Conflicts are ordered
+// by the position of the winner and then of the loser.
+void findAssetConflicts(ModRegistry const &mod_list, AssetIndex const &index, std::vector<AssetConflict> &conflicts,
+        AssetConflictStats *stats);
@@ -0,0 +1,113 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#define BSA_HEADER_SIZE 36
+
+// bytes taken by the first read of an archive, which holds the whole directory
+// of all but archives with more than a couple hundred files
+#define BSA_DIRECTORY_READ_SIZE 4096
+// directories larger than this are taken to be corrupt rather than read
+#define BSA_DIRECTORY_MAX_SIZE (64 << 20)
+
+// archive versions of Oblivion, Skyrim and Skyrim Special Edition, which differ
+// only in the size of their folder records
+#define BSA_VERSION_OBLIVION 103
+#define BSA_VERSION_SKYRIM 104
+#define BSA_VERSION_SKYRIM_SE 105
+
+#define BSA_FOLDER_RECORD_SIZE 16
+#define BSA_FOLDER_RECORD_SIZE_SE 24
+#define BSA_FILE_RECORD_SIZE 16
+
+// archive flags saying whether folder names precede each folder's file records,
+// and whether a block of file names follows them
+#define BSA_FLAG_FOLDER_NAMES 0x1
+#define BSA_FLAG_FILE_NAMES 0x2
+
+// An asset as the game looks it up in an archive, by the hashes of its folder
+// path and file name rather than by the names themselves.
+struct AssetHash {
+    uint64_t folder;
+    uint64_t file;
+
+    inline bool operator==(AssetHash const &other) const {
+        return folder == other.folder && file == other.file;
+    }
+
+    inline bool operator!=(AssetHash const &other) const {
+        return !(*this == other);
+    }
+
+    inline bool operator<(AssetHash const &other) const {
+        return folder != other.folder ? folder < other.folder : file < other.file;
+    }
+};
+
+// The fields of an archive header needed to walk its directory.
+struct BsaHeader {
+    uint32_t version;
+    uint32_t flags;
+    uint32_t folder_count;
+    uint32_t file_count;
+    // total length of the folder names, counting their terminators but not their length bytes
+    uint32_t folder_names_length;
+
+    // Returns the size of everything from the start of the archive through the
+    // last file record, i.e. all a reader needs to list the archive's assets.
+    size_t getDirectorySize(void) const;
+};
+
+// Hashes a folder path, e.g. "textures\armor\iron", the way the game does. Case
+// and the direction of slashes don't matter.
+uint64_t hashBsaFolder(std::string_view path);
+
+// Hashes a file name without its folder, e.g. "ironarmor.dds", the way the game does.
+uint64_t hashBsaFile(std::string_view name);
+
+// Hashes a full asset path, e.g. "textures\armor\iron\ironarmor.dds".
+AssetHash hashAssetPath(std::string_view path);
+
+// Parses the header at the start of data. Returns -1 if data doesn't start with
+// the header of an archive of a supported version.
+int parseBsaHeader(std::string_view data, BsaHeader *header);
+
+// Lists the asset of every file record in data, which must hold at least the
+// archive's whole directory. Assets are appended in the order they're stored.
+// Returns -1 if the directory is malformed.
+int parseBsaDirectory(std::string_view data, BsaHeader const &header, std::vector<AssetHash> &assets);
+
+// Reads and lists the assets of the archive at path, replacing the contents of
+// assets. Only the directory is read, with a positioned read of the first
+// BSA_DIRECTORY_READ_SIZE bytes and a second for the rest if it doesn't fit, so
+// nothing is decompressed. This isn't attributed to a phase, so it can be called
+// from worker threads.
+int readBsaAssets(const char *path, std::vector<AssetHash> &assets, size_t *bytes_read);
@@ -27,9 +27,16 @@
 
 #include <cstdio>
 
+#ifdef __SWITCH__
 #include <switch.h>
+#else
+#define CONSOLE_ESC(x) "\x1b[" #x
+#endif
 
 #define CONSOLE_LINES 44
+// physical size of the console; rows are addressed from 0 to CONSOLE_LINES inclusive
+#define CONSOLE_ROWS (CONSOLE_LINES + 1)
+#define CONSOLE_COLUMNS 80
 
 #define _PRINT_ESC(s) printf(CONSOLE_ESC(s))
 #define _EXPAND(a) a
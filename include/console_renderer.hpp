@@ -0,0 +1,138 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ConsoleStyle {
+    uint8_t fg;
+    uint8_t bg;
+    uint8_t attr;
+
+    bool operator==(ConsoleStyle const &other) const {
+        return fg == other.fg && bg == other.bg && attr == other.attr;
+    }
+
+    bool operator!=(ConsoleStyle const &other) const {
+        return !(*this == other);
+    }
+};
+
+struct ConsoleCell {
+    char ch;
+    ConsoleStyle style;
+
+    bool operator==(ConsoleCell const &other) const {
+        return ch == other.ch && style == other.style;
+    }
+
+    bool operator!=(ConsoleCell const &other) const {
+        return !(*this == other);
+    }
+};
+
+typedef void (*ConsoleSink)(const char *data, size_t len);
+
+// Renders frames through a back buffer. Drawing calls only touch the back
+// buffer; present() diffs it against what is known to be on screen and emits
+// the changes as a single batched escape stream with direct cursor addressing.
+class ConsoleRenderer {
+    private:
+        size_t rows;
+        size_t cols;
+        ConsoleStyle clear_style;
+        // value of the first row/column in cursor addressing escapes
+        unsigned cursor_origin;
+        // whether the terminal understands scroll regions (DECSTBM) and SU/SD
+        bool scroll_regions;
+        ConsoleSink sink;
+
+        std::vector<ConsoleCell> front;
+        std::vector<ConsoleCell> back;
+        std::string out;
+
+        // cursor/style state of the terminal as of the last emitted byte
+        bool cursor_known;
+        size_t cursor_row;
+        size_t cursor_col;
+        bool style_known;
+        ConsoleStyle cur_style;
+
+        size_t total_bytes;
+
+        void moveCursor(size_t row, size_t col);
+
+        void setStyle(ConsoleStyle const &style);
+
+        void emitCell(size_t row, size_t col);
+
+    public:
+        ConsoleRenderer(size_t rows, size_t cols, ConsoleStyle clear_style, unsigned cursor_origin,
+                bool scroll_regions, ConsoleSink sink);
+
+        inline size_t getRows(void) const {
+            return rows;
+        }
+
+        inline size_t getColumns(void) const {
+            return cols;
+        }
+
+        inline size_t getTotalBytes(void) const {
+            return total_bytes;
+        }
+
+        // Returns the cell drawn into the back buffer at the given position.
+        inline ConsoleCell const &getCell(size_t row, size_t col) const {
+            return back[row * cols + col];
+        }
+
+        void clearRow(size_t row);
+
+        void clearRow(size_t row, ConsoleStyle const &style);
+
+        // Draws text into the back buffer starting at the given cell, clipped
+        // to the end of the row. Returns the column following the text.
+        size_t putText(size_t row, size_t col, std::string_view text, ConsoleStyle const &style);
+
+        // Informs the renderer that the content of rows [top, bottom] moved up
+        // by delta rows (or down, if negative). Where the terminal supports it
+        // this is done with a region scroll so only the newly exposed rows need
+        // to be drawn. The back buffer is left alone; callers redraw the region.
+        void shiftRows(size_t top, size_t bottom, int delta);
+
+        // Forgets what is on screen, e.g. after it was cleared or written to
+        // directly. If cleared is set the screen is assumed to be blank.
+        void invalidate(bool cleared);
+
+        // Emits the difference between the back buffer and the screen. Returns
+        // the number of bytes emitted.
+        size_t present(void);
+};
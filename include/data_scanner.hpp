@@ -0,0 +1,60 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "mod.hpp"
+
+#include <cstddef>
+
+// number of directory entries handed to a worker at once
+#define SCAN_BATCH_SIZE 64
+// number of batches which may be queued before the directory reader blocks
+#define SCAN_QUEUE_DEPTH 8
+// worker count to use when the core count can't be determined
+#define SCAN_DEFAULT_WORKERS 3
+#define SCAN_MAX_WORKERS 4
+
+// Scans the given directory and classifies every regular file in it as an
+// ESP/ESM/BSA record, merging the results into mod_list. Mods are appended in
+// the order their first file was returned by the directory listing, regardless
+// of how the classification work was split between threads.
+//
+// Returns 0 on success or -1 if the directory could not be opened.
+int scanDataDir(const char *path, ModRegistry &mod_list, size_t *file_count, size_t worker_count = 0);
+
+struct RescanResult {
+    size_t added_mods;
+    size_t changed_mods;
+    size_t missing_mods;
+};
+
+// Re-reads the directory listing and reconciles mod_list with it in place. New
+// mods are appended, mods whose files changed are updated and mods with no
+// files left are marked as missing. Existing ordering and enabled state are
+// kept for everything that is still present.
+//
+// Returns 0 on success or -1 if the directory could not be opened.
+int rescanDataDir(const char *path, ModRegistry &mod_list, RescanResult *result);
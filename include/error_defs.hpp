@@ -50,7 +50,8 @@
                                                 return -1; \
                                             }
 
-static bool g_fatal_occurred = false;
+// one flag for the whole program, so a FATAL in any file stops the main loop
+inline bool g_fatal_occurred = false;
 
 inline bool fatal_occurred(void) {
     return g_fatal_occurred;
@@ -0,0 +1,60 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// A file operation which failed, kept so it can be reported later or from
+// another thread than the one it happened on.
+struct FileError {
+    // "read" or "write"
+    const char *action;
+    std::string path;
+};
+
+struct FileStamp {
+    int64_t mtime;
+    int64_t size;
+};
+
+int statFile(const char *path, FileStamp *stamp);
+
+int readFile(const char *path, std::string &out);
+
+// Same as readFile, but leaves attributing the read to a phase up to the caller,
+// so it can be called from threads other than the main one.
+int readFileUntracked(const char *path, std::string &out);
+
+// Reads up to size bytes of the file starting at offset with a single positioned
+// read, so only the part that's needed comes off the storage. out ends up shorter
+// than size if the file ends first. Not attributed to a phase, like the above.
+int readFileRangeUntracked(const char *path, uint64_t offset, size_t size, std::string &out);
+
+int writeFileAtomic(const char *path, std::string const &data);
+
+// Same as writeFileAtomic, but without attributing the write to a phase.
+int writeFileAtomicUntracked(const char *path, std::string const &data);
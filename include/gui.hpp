@@ -25,6 +25,8 @@
 
 #pragma once
 
+#include "console_renderer.hpp"
+#include "load_order_lint.hpp"
 #include "mod.hpp"
 
 #include <memory>
@@ -33,7 +35,9 @@
 
 class ModGui {
     private:
-        ModList &mod_list;
+        ModRegistry &mod_list;
+        ConsoleRenderer &renderer;
+        LoadOrderLinter const *linter;
         size_t screen_off_y;
         size_t display_rows;
         size_t selected_row;
@@ -64,20 +68,35 @@ class ModGui {
         }
 
     public:
-        ModGui(ModList &mod_list, size_t screen_off_y, size_t display_rows):
+        ModGui(ModRegistry &mod_list, ConsoleRenderer &renderer, size_t screen_off_y, size_t display_rows):
                 mod_list(mod_list),
+                renderer(renderer),
+                linter(NULL),
                 screen_off_y(screen_off_y),
                 display_rows(display_rows),
                 selected_row(0),
                 scroll(0) {
         }
 
-        std::shared_ptr<SkyrimMod> getSelectedMod(void);
+        // Marks the rows of mods the linter flags with an issue.
+        inline void setLinter(LoadOrderLinter const *new_linter) {
+            linter = new_linter;
+        }
+
+        SkyrimMod getSelectedMod(void);
 
         size_t getSelectedIndex(void);
 
         void scrollSelection(int delta);
 
+        bool moveSelection(int delta);
+
+        bool moveSelectionTo(size_t target);
+
+        // Selects the mod at the given place in the load order, scrolling it into
+        // view, and redraws the list.
+        void selectIndex(size_t index);
+
         void redraw(void);
 
         void redrawRow(size_t row);
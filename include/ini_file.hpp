@@ -0,0 +1,92 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// An INI file held as its raw bytes, plus an index of where each section and
+// key lies within them. Values are read as views into the bytes, and setting a
+// value splices it in place of the old one, so comments, ordering and
+// formatting elsewhere in the file survive a round trip untouched.
+//
+// Lines are trimmed, lines starting with ';' or '#' are comments, and when a
+// key appears more than once in a section the first occurrence wins.
+class IniFile {
+    private:
+        struct Section {
+            size_t name_off;
+            size_t name_len;
+            // where a new key for this section goes, just past its last entry
+            size_t insert_off;
+        };
+
+        struct Entry {
+            size_t section;
+            size_t key_off;
+            size_t key_len;
+            size_t value_off;
+            size_t value_len;
+        };
+
+        std::string data;
+        // the first section is the unnamed one holding anything before the first header
+        std::vector<Section> sections;
+        std::vector<Entry> entries;
+        const char *newline;
+
+        void index(void);
+
+        ssize_t findSection(std::string_view name) const;
+
+        ssize_t findEntry(size_t section, std::string_view key) const;
+
+        // Moves every offset at or past pos by delta after bytes were spliced in.
+        void shiftOffsets(size_t pos, ssize_t delta);
+
+    public:
+        IniFile(void);
+
+        int load(const char *path);
+
+        void parse(std::string &&data);
+
+        void clear(void);
+
+        // Returns the value of the key, or an empty view if it isn't present. The
+        // view is only valid until the file is next modified.
+        std::string_view get(std::string_view section, std::string_view key) const;
+
+        // Replaces the value of the key, adding the key (and its section) at the end
+        // of the section (or file) if it isn't present.
+        void set(std::string_view section, std::string_view key, std::string_view value);
+
+        inline std::string const &getData(void) const {
+            return data;
+        }
+};
@@ -25,23 +25,50 @@
 
 #pragma once
 
+#include "file_helper.hpp"
+#include "ini_file.hpp"
 #include "mod.hpp"
+#include "task_pool.hpp"
 
-#include <inipp/inipp.h>
+#include <string>
 
 #define INI_SECTION_ARCHIVE "Archive"
 #define INI_ARCHIVE_LIST_1 "sResourceArchiveList"
 #define INI_ARCHIVE_LIST_2 "sResourceArchiveList2"
 #define INI_ARCHIVE_LIST_3 "sArchiveToLoadInMemoryList"
 
-typedef inipp::Ini<char> StdIni;
+#define INI_WROTE_SKYRIM 1
+#define INI_WROTE_SKYRIM_LANG 2
 
-int readIniFile(std::string &path, StdIni &ini);
+int readIniFile(std::string &path, IniFile &ini);
 
-int readIniFile(const char *path, StdIni &ini);
+int readIniFile(const char *path, IniFile &ini);
 
-int processIniDefs(StdIni &ini, const char *key, const std::vector<std::string> &expected_suffixes);
+int processIniDefs(ModRegistry &final_mod_list, ModRegistry &temp_mod_list, IniFile &ini, const char *key,
+        uint8_t expected_types);
 
-int parseInis(ModList &final_mod_list, ModList &temp_mod_list);
+int getLangIniPath(std::string &path);
 
-int writeIniChanges(void);
+// Queues reads of both INIs on the pool, to be picked up by the next parseInis()
+// once the pool has been waited on. Read failures are reported by parseInis().
+int prefetchInis(TaskPool &pool);
+
+int parseInis(ModRegistry &final_mod_list, ModRegistry &temp_mod_list);
+
+void captureIniBaseline(void);
+
+// Drops the parsed INIs and their baseline so the next parse reads them afresh.
+void resetInis(void);
+
+// Resolves where the INIs live ahead of saveIniChanges(), which can't ask the
+// system for its language itself.
+int prepareIniSave(void);
+
+// Splices the archive lists of mod_list into whichever INIs they changed in and
+// writes those out. This touches neither the console nor phase timing, so it can
+// run on a worker thread as long as nothing else uses the INIs meanwhile. On
+// failure, error describes the file which couldn't be read or written.
+int saveIniChanges(ModRegistry const &mod_list, size_t *bytes_written, int *files_written, FileError *error);
+
+// Same as saveIniChanges() for the global mod list, reporting failures itself.
+int writeIniChanges(size_t *bytes_written, int *files_written);
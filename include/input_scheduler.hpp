@@ -0,0 +1,88 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#define INPUT_NO_DEADLINE UINT64_MAX
+
+enum class InputEventType {
+    PRESS,
+    RELEASE,
+    REPEAT
+};
+
+struct InputEvent {
+    InputEventType type;
+    uint64_t button;
+};
+
+struct KeyRepeatConfig {
+    // buttons which generate REPEAT events while held
+    uint64_t buttons;
+    // delay before the first repeat
+    uint64_t initial_delay;
+    // delay between the first two repeats
+    uint64_t interval;
+    // floor the interval accelerates down to
+    uint64_t min_interval;
+    // percentage the interval shrinks by after each repeat
+    uint32_t accel_percent;
+};
+
+// Turns raw button state into discrete press/release/repeat events. It has no
+// notion of the platform's clock or input API; callers pass in the button
+// bitmask and the current time (in nanoseconds) on every update.
+class InputScheduler {
+    private:
+        KeyRepeatConfig repeat;
+        uint64_t held;
+        uint64_t repeat_button;
+        uint64_t next_repeat;
+        uint64_t cur_interval;
+
+    public:
+        InputScheduler(KeyRepeatConfig const &repeat):
+                repeat(repeat),
+                held(0),
+                repeat_button(0),
+                next_repeat(INPUT_NO_DEADLINE),
+                cur_interval(repeat.interval) {
+        }
+
+        inline uint64_t getHeld(void) const {
+            return held;
+        }
+
+        void update(uint64_t buttons, uint64_t now, std::vector<InputEvent> &events);
+
+        // Returns the time at which the next repeat is due, or
+        // INPUT_NO_DEADLINE if nothing is repeating.
+        inline uint64_t nextDeadline(void) const {
+            return next_repeat;
+        }
+};
@@ -0,0 +1,66 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "master_graph.hpp"
+#include "mod.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// cycles kept for reporting; any beyond these are only counted
+#define SORT_MAX_REPORTED_CYCLES 8
+
+struct LoadOrderSortResult {
+    size_t plugins;
+    // masters resolved to plugins in the list, and masters which aren't in it
+    size_t dependencies;
+    size_t missing_masters;
+    // master-flagged plugins depending on plugins which aren't, which the game
+    // can't honour since it loads every master-flagged plugin first
+    size_t flag_conflicts;
+    // plugins moved ahead of others they used to follow; the rest keep their order
+    size_t moved;
+    size_t cycle_count;
+    // the first cycles found, each as the plugins which depend on one another in
+    // a loop, in list order
+    std::vector<std::vector<ModId>> cycles;
+};
+
+// Computes a load order for mod_list in which every plugin comes after its
+// masters and master-flagged plugins come before the rest, keeping as close to
+// the current order as it can. Plugins are visited in their current order, and
+// a plugin whose masters aren't placed yet pulls them up ahead of itself, so an
+// order which already satisfies every master is left exactly as it is. Only the
+// places held by plugins are permuted; mods without one stay where they are.
+//
+// Plugins which depend on one another in a loop can't all follow their masters,
+// so each such cycle is reported and its plugins are placed together, in the
+// order they already had, which leaves sorting a sorted list a no-op even then.
+// Plugins missing from graph or with unreadable headers are placed by their
+// master flag alone. Runs in time linear in the number of mods and masters.
+void sortLoadOrder(ModRegistry const &mod_list, MasterGraph const &graph, std::vector<ModId> &order,
+        LoadOrderSortResult *result);
@@ -0,0 +1,138 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "master_graph.hpp"
+#include "mod.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// issue bits, kept in one byte per mod
+// a master of the enabled plugin isn't enabled
+#define LINT_MASTER_DISABLED 0x01
+// a master of the enabled plugin isn't in the data directory
+#define LINT_MASTER_MISSING 0x02
+// a master of the enabled plugin loads after it
+#define LINT_MASTER_LATER 0x04
+// the mod's archives are enabled but its plugin isn't
+#define LINT_ORPHANED_BSAS 0x08
+// the mod's Animations archive is registered in fewer archive lists than it must be
+#define LINT_ANIMATIONS_ONCE 0x10
+
+#define LINT_ISSUE_COUNT 5
+
+#define LINT_MASTER_ISSUES (LINT_MASTER_DISABLED | LINT_MASTER_MISSING | LINT_MASTER_LATER)
+
+struct LintCounts {
+    // mods with any issue
+    size_t flagged;
+    // mods with each issue, indexed by bit
+    size_t issues[LINT_ISSUE_COUNT];
+};
+
+struct LintUpdate {
+    // mods besides the edited one whose issues changed
+    size_t changed;
+    // enabled plugins with the edited mod as a master which it now fails
+    size_t broken_dependents;
+};
+
+// Checks each mod in a list for problems the game would run into loading it:
+// plugins whose masters are disabled, missing or load later, and archives which
+// are enabled without their plugin or only half registered. Issues are kept per
+// mod and brought up to date by relint() after each edit, which only re-checks
+// the mods the edit can affect.
+class LoadOrderLinter {
+    private:
+        ModRegistry const &mod_list;
+        std::vector<uint8_t> issues;
+        // plugins the game loads whether or not the plugin list names them
+        std::vector<bool> implicit;
+        // plugins the game loads ahead of the rest, by extension or header flag
+        std::vector<bool> flagged;
+        // masters of mod i in the list are masters[first_master[i]] up to
+        // masters[first_master[i + 1]]; empty until the headers have been read
+        std::vector<uint32_t> first_master;
+        std::vector<ModId> masters;
+        // and the plugins with mod i as a master, likewise
+        std::vector<uint32_t> first_dependent;
+        std::vector<ModId> dependents;
+        // the first master of each plugin which isn't in the list at all
+        std::unordered_map<ModId, std::string> absent_masters;
+        LintCounts counts;
+
+        bool isActive(ModId id) const;
+
+        // Returns the place of the mod in the list, looking it up unless positions
+        // holds it already.
+        ssize_t getPosition(ModId id, std::vector<uint32_t> const *positions) const;
+
+        // Returns the master issue, if any, the given master of an enabled plugin causes.
+        uint8_t checkMaster(ModId plugin, ssize_t plugin_pos, ModId master,
+                std::vector<uint32_t> const *positions) const;
+
+        uint8_t check(ModId id, std::vector<uint32_t> const *positions) const;
+
+        bool setIssues(ModId id, uint8_t found);
+
+    public:
+        LoadOrderLinter(ModRegistry const &mod_list):
+                mod_list(mod_list),
+                issues(),
+                implicit(),
+                flagged(),
+                first_master(),
+                masters(),
+                first_dependent(),
+                dependents(),
+                absent_masters(),
+                counts() {
+        }
+
+        // Checks every mod in the list afresh, resolving each plugin's masters from
+        // graph. Until the headers have been read graph may be null, in which case
+        // only the issues which don't involve masters are checked. This must be
+        // called again whenever mods are added to or dropped from the list.
+        void relintAll(MasterGraph const *graph);
+
+        // Re-checks a mod after it was toggled or moved, along with the plugins
+        // depending on it, which are the only others such an edit can affect.
+        LintUpdate relint(ModId id);
+
+        uint8_t getIssues(ModId id) const;
+
+        LintCounts const &getCounts(void) const;
+
+        // Describes the mod's most serious issue, e.g. "Master Foo.esm is
+        // disabled", or returns an empty string if it has none.
+        std::string describe(ModId id) const;
+
+        void clear(void);
+};
@@ -0,0 +1,107 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "file_helper.hpp"
+#include "plugin_header.hpp"
+#include "string_helper.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#define PLUGIN_CACHE_FILE "SkyMM.plugins.cache"
+
+#define PLUGIN_CACHE_MAGIC 0x504D4B53 // "SKMP"
+#define PLUGIN_CACHE_VERSION 1
+
+// plugins handed to a worker at a time while reading headers
+#define MASTER_GRAPH_BATCH 32
+
+enum class PluginHeaderStatus : uint8_t {
+    OK,
+    // the plugin couldn't be opened or read
+    MISSING,
+    // the plugin doesn't start with a well-formed TES4 record
+    MALFORMED
+};
+
+struct MasterGraphStats {
+    size_t plugins;
+    // headers taken from the cache, and headers read from their plugins
+    size_t cached;
+    size_t read;
+    // plugins which are missing or malformed
+    size_t failed;
+    // bytes read from plugins and the cache, and written to the cache
+    size_t bytes_read;
+    size_t bytes_written;
+};
+
+// The masters each plugin depends on, as declared in the plugins' headers.
+// Entries are kept in the order their file names were passed to load(), and
+// names are matched without regard to case, as the game does.
+class MasterGraph {
+    private:
+        struct Node {
+            std::string file_name;
+            FileStamp stamp;
+            PluginHeaderStatus status;
+            PluginHeader header;
+        };
+
+        std::vector<Node> nodes;
+        std::unordered_map<std::string, size_t, FoldedHash, FoldedEqual> index;
+
+    public:
+        // Reads the header of each named file in data_dir, on a pool of
+        // worker_count threads. Headers in the cache at cache_path are reused for
+        // files whose size and mtime haven't changed, and the cache is rewritten
+        // if anything had to be read. Nothing here touches the console or phase
+        // timing, so the whole load may run on a worker thread.
+        int load(std::string const &data_dir, std::vector<std::string> const &file_names, std::string const &cache_path,
+                size_t worker_count, MasterGraphStats *stats);
+
+        void clear(void);
+
+        size_t size(void) const;
+
+        // Returns the position of the named plugin, or -1 if it wasn't loaded.
+        ptrdiff_t indexOf(std::string_view file_name) const;
+
+        std::string const &getFileName(size_t i) const;
+
+        PluginHeaderStatus getStatus(size_t i) const;
+
+        // Returns the header of the plugin at i, or null unless its status is OK.
+        PluginHeader const *getHeader(size_t i) const;
+
+        // Returns the header of the named plugin, or null if it wasn't loaded or
+        // couldn't be parsed.
+        PluginHeader const *find(std::string_view file_name) const;
+};
@@ -25,21 +25,52 @@
 
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <sys/types.h>
+
 #define EXT_ESP "esp"
 #define EXT_ESM "esm"
 #define EXT_BSA "bsa"
 
+// packs a three-character extension into an integer so it can be matched with a single compare
+#define PACK_EXT(a, b, c) ((uint32_t) (uint8_t) (a) | ((uint32_t) (uint8_t) (b) << 8) | ((uint32_t) (uint8_t) (c) << 16))
+#define PACKED_EXT_ESP PACK_EXT('e', 's', 'p')
+#define PACKED_EXT_ESM PACK_EXT('e', 's', 'm')
+#define PACKED_EXT_BSA PACK_EXT('b', 's', 'a')
+
 enum class ModStatus {
     ENABLED,
     DISABLED,
     PARTIAL
 };
 
+// Suffixes the game's archives are split by, e.g. "Skyrim - Meshes.bsa". These
+// are declared in sorted order, so walking them by value visits archives in the
+// same order as sorting their suffix strings would.
+enum class BsaSuffix : uint8_t {
+    NONE,
+    ANIMATIONS,
+    MESHES,
+    SOUNDS,
+    TEXTURES,
+    VOICES,
+    // anything else, kept as a string on the side
+    OTHER
+};
+
+// number of suffixes with a bit of their own, i.e. all but OTHER
+#define BSA_SUFFIX_COUNT 6
+#define BSA_BIT(suffix) ((uint8_t) (1 << (uint8_t) (suffix)))
+
+// the Animations archive is registered in two archive lists rather than one
+#define BSA_ANIMATIONS_LISTS 2
+
 enum class ModFileType {
     BSA,
     ESP,
@@ -47,6 +78,16 @@ enum class ModFileType {
     UNKNOWN
 };
 
+// Non-owning classification of a file name. The views point into the string
+// passed to classify() and are only valid for as long as it is.
+struct ModFileView {
+    ModFileType type;
+    std::string_view base_name;
+    std::string_view suffix;
+
+    static ModFileView classify(std::string_view file_name);
+};
+
 struct ModFile {
     ModFileType type;
     std::string base_name;
@@ -55,36 +96,430 @@ struct ModFile {
     static ModFile fromFileName(std::string const &file_name);
 };
 
-struct SkyrimMod {
-    const std::string base_name;
-    bool has_esp;
-    bool is_master;
-    bool esp_enabled;
-    std::vector<std::string> bsa_suffixes;
-    std::map<std::string, int> enabled_bsas;
+// Maps a suffix onto its enum value if it's exactly one of the known ones, or
+// onto OTHER if not.
+BsaSuffix parseBsaSuffix(std::string_view suffix);
+
+// Like parseBsaSuffix(), but matches by prefix the way the archive lists are
+// split, so e.g. "Textures1" is taken for a TEXTURES archive.
+BsaSuffix classifyBsaSuffix(std::string_view suffix);
+
+std::string_view getBsaSuffixName(BsaSuffix suffix);
+
+// An archive whose suffix isn't exactly one of the known ones.
+struct ExtraBsa {
+    std::string suffix;
+    // the known suffix this one starts with, or OTHER
+    BsaSuffix kind;
+    bool present;
+    uint8_t enabled_count;
+};
+
+// Archive state of a single mod. Bits are indexed by BsaSuffix.
+struct BsaState {
+    // archives found in the data directory
+    uint8_t present;
+    // archives registered in at least one archive list
+    uint8_t enabled;
+    // number of archive lists the Animations archive is registered in
+    uint8_t animations;
+};
+
+typedef uint32_t ModId;
+
+#define MOD_ID_NONE UINT32_MAX
+
+// per-mod flag bits, kept together in one byte per mod
+#define MOD_HAS_ESP 0x01
+#define MOD_IS_MASTER 0x02
+#define MOD_ESP_ENABLED 0x04
+// set when a rescan found none of the mod's files left in the data directory
+#define MOD_MISSING 0x08
+// set when the mod has an entry in the store's table of archives with unknown suffixes
+#define MOD_EXTRA_BSAS 0x10
+// set when the cached status no longer reflects the mod's state
+#define MOD_STATUS_STALE 0x20
+// set once the mod has been added to the store's status counts, along with
+// whether it was counted as missing
+#define MOD_STATUS_COUNTED 0x40
+#define MOD_COUNTED_MISSING 0x80
+
+// flags which feed into a mod's status
+#define MOD_STATUS_INPUTS (MOD_HAS_ESP | MOD_ESP_ENABLED | MOD_MISSING)
+
+// Totals by status over every mod in a store. Missing mods are counted on their
+// own rather than under the status they'd otherwise have.
+struct ModStatusCounts {
+    size_t enabled;
+    size_t partial;
+    size_t disabled;
+    size_t missing;
+};
+
+class SkyrimMod;
+
+// Contiguous storage for mods, laid out as parallel arrays indexed by ModId
+// rather than as one heap object per mod. Base names are interned into large
+// blocks which never move, so views of them stay valid until the store is
+// cleared. Mods are never removed individually.
+class ModStore {
+    friend class SkyrimMod;
+
+    private:
+        std::vector<std::unique_ptr<char[]>> name_blocks;
+        size_t name_block_used;
+        std::vector<const char *> names;
+        std::vector<uint16_t> name_lengths;
+        // case-folded name hashes, shared by the index of every registry over this store
+        std::vector<uint32_t> name_hashes;
+        std::vector<uint8_t> flags;
+        std::vector<BsaState> bsa_states;
+        // archives with unknown suffixes, sorted by suffix; only mods flagged with
+        // MOD_EXTRA_BSAS have an entry
+        std::map<ModId, std::vector<ExtraBsa>> extra_bsas;
+        std::vector<ModStatus> statuses;
+        // mods which were flagged stale since the counts were last brought up to
+        // date; this may also hold mods which have since been refreshed
+        std::vector<ModId> stale_mods;
+        ModStatusCounts status_counts;
+
+        const char *internName(std::string_view name);
+
+        void markStale(ModId id);
+
+    public:
+        ModStore(void):
+                name_blocks(),
+                name_block_used(0),
+                names(),
+                name_lengths(),
+                name_hashes(),
+                flags(),
+                bsa_states(),
+                extra_bsas(),
+                statuses(),
+                stale_mods(),
+                status_counts({0, 0, 0, 0}) {
+        }
+
+        ModStore(ModStore const &) = delete;
+
+        ModStore &operator=(ModStore const &) = delete;
+
+        ModId add(std::string_view base_name);
+
+        // Makes this store a copy of other as it is now, so the copy can be read
+        // from another thread while other keeps changing. Names aren't copied but
+        // refer to other's name blocks, so other must not be cleared while the copy
+        // is in use.
+        void copyFrom(ModStore const &other);
+
+        void clear(void);
+
+        // Drops every mod added after the store had the given size, e.g. to undo a
+        // load which failed partway through. Their names stay interned.
+        void truncate(size_t size);
+
+        inline size_t size(void) const {
+            return names.size();
+        }
+
+        // Refreshes the status of any stale mods and returns the totals.
+        ModStatusCounts const &getStatusCounts(void);
+
+        inline std::string_view getBaseName(ModId id) const {
+            return std::string_view(names[id], name_lengths[id]);
+        }
+
+        inline uint32_t getNameHash(ModId id) const {
+            return name_hashes[id];
+        }
+};
+
+// Handle to a mod in a ModStore. Handles are cheap to copy and compare; a
+// default-constructed handle refers to no mod and tests false.
+class SkyrimMod {
+    friend class ModStore;
+
+    private:
+        ModStore *store;
+        ModId id;
+
+        inline bool hasFlag(uint8_t flag) const {
+            return store->flags[id] & flag;
+        }
+
+        inline void setFlag(uint8_t flag, bool set) const {
+            store->flags[id] = set ? (store->flags[id] | flag) : (store->flags[id] & ~flag);
+            if (flag & MOD_STATUS_INPUTS) {
+                invalidateStatus();
+            }
+        }
+
+        inline void invalidateStatus(void) const {
+            if (!hasFlag(MOD_STATUS_STALE)) {
+                store->markStale(id);
+            }
+        }
+
+        std::vector<ExtraBsa> *findExtraBsas(void) const;
+
+        ModStatus computeStatus(void) const;
+
+        void refreshStatus(void) const;
+
+    public:
+        SkyrimMod(void):
+                store(NULL),
+                id(MOD_ID_NONE) {
+        }
+
+        SkyrimMod(ModStore *store, ModId id):
+                store(store),
+                id(id) {
+        }
+
+        explicit inline operator bool(void) const {
+            return store != NULL;
+        }
+
+        inline bool operator==(SkyrimMod const &other) const {
+            return store == other.store && id == other.id;
+        }
+
+        inline bool operator!=(SkyrimMod const &other) const {
+            return !(*this == other);
+        }
 
-    SkyrimMod(std::string const &base_name):
-            base_name(base_name),
-            has_esp(false),
-            is_master(false),
-            esp_enabled(false),
-            bsa_suffixes(),
-            enabled_bsas() {
-    }
+        inline ModStore *getStore(void) const {
+            return store;
+        }
 
-    ModStatus getStatus(void);
+        inline ModId getId(void) const {
+            return id;
+        }
 
-    void enable(void);
+        inline std::string_view getBaseName(void) const {
+            return store->getBaseName(id);
+        }
 
-    void disable(void);
+        inline bool hasEsp(void) const {
+            return hasFlag(MOD_HAS_ESP);
+        }
 
-    void loadSooner(void);
+        inline void setHasEsp(bool has_esp) const {
+            setFlag(MOD_HAS_ESP, has_esp);
+        }
 
-    void loadLater(void);
+        inline bool isMaster(void) const {
+            return hasFlag(MOD_IS_MASTER);
+        }
+
+        inline void setMaster(bool is_master) const {
+            setFlag(MOD_IS_MASTER, is_master);
+        }
+
+        inline bool isEspEnabled(void) const {
+            return hasFlag(MOD_ESP_ENABLED);
+        }
+
+        inline void setEspEnabled(bool enabled) const {
+            setFlag(MOD_ESP_ENABLED, enabled);
+        }
+
+        inline bool isMissing(void) const {
+            return hasFlag(MOD_MISSING);
+        }
+
+        inline void setMissing(bool missing) const {
+            setFlag(MOD_MISSING, missing);
+        }
+
+        inline BsaState const &getBsaState(void) const {
+            return store->bsa_states[id];
+        }
+
+        // Returns the mod's archive state for modification, invalidating its status.
+        inline BsaState &editBsaState(void) const {
+            invalidateStatus();
+            return store->bsa_states[id];
+        }
+
+        // Returns the mod's archives with unknown suffixes, or NULL if it has none.
+        inline std::vector<ExtraBsa> const *getExtraBsas(void) const {
+            return findExtraBsas();
+        }
+
+        // Returns the mod's archives with unknown suffixes for modification, or NULL
+        // if it has none. This invalidates the mod's status.
+        inline std::vector<ExtraBsa> *editExtraBsas(void) const {
+            invalidateStatus();
+            return findExtraBsas();
+        }
+
+        // Returns the entry for an archive with an unknown suffix for modification,
+        // creating it if need be. This invalidates the mod's status.
+        ExtraBsa &getExtraBsa(std::string_view suffix) const;
+
+        // The name of the mod's plugin, e.g. "Foo.esp", for a mod which has one.
+        std::string getPluginFileName(void) const;
+
+        // The name of the mod's archive with the given suffix, e.g. "Foo - Textures.bsa".
+        std::string getArchiveFileName(std::string_view suffix) const;
+
+        // Appends the file name of every archive of the mod in the data directory.
+        void getArchiveFileNames(std::vector<std::string> &file_names) const;
+
+        bool hasBsas(void) const;
+
+        bool hasEnabledBsas(void) const;
+
+        // Returns whether the archive with the given suffix is registered in at
+        // least one archive list.
+        bool isBsaEnabled(std::string_view suffix) const;
+
+        // Records an archive found in the data directory.
+        void addBsa(std::string_view suffix) const;
+
+        // Records one archive list entry for an archive of this mod.
+        void registerBsa(std::string_view suffix) const;
+
+        void clearBsas(void) const;
+
+        // Brings the mod's archives in line with those of a fresh scan, dropping the
+        // enabled state of any which are gone. Returns whether anything changed.
+        bool reconcileBsas(SkyrimMod const &scanned) const;
+
+        // Copies everything but the name from a mod which may be in another store.
+        void assign(SkyrimMod const &other) const;
+
+        // Returns the cached status, recomputing it first if the mod changed since.
+        inline ModStatus getStatus(void) const {
+            if (hasFlag(MOD_STATUS_STALE)) {
+                refreshStatus();
+            }
+            return store->statuses[id];
+        }
+
+        void enable(void) const;
+
+        void disable(void) const;
 };
 
-typedef std::vector<std::shared_ptr<SkyrimMod>> ModList;
+// Ordered list of mods from a ModStore, paired with an open-addressing hash
+// index keyed on the case-folded base name of each mod. The index tracks list
+// positions, so all mutations must go through the registry to keep it in sync.
+// Registries sharing a store can pass mods between them.
+class ModRegistry {
+    private:
+        struct IndexSlot {
+            uint32_t hash;
+            uint32_t pos;
+        };
+
+        ModStore *store;
+        std::vector<ModId> mods;
+        std::vector<IndexSlot> index;
+
+        size_t findSlot(std::string_view name, uint32_t hash) const;
+
+        size_t findSlotForPos(size_t pos) const;
+
+        void rehash(size_t capacity);
+
+    public:
+        class const_iterator {
+            private:
+                ModStore *store;
+                std::vector<ModId>::const_iterator it;
+
+            public:
+                const_iterator(ModStore *store, std::vector<ModId>::const_iterator it):
+                        store(store),
+                        it(it) {
+                }
+
+                inline SkyrimMod operator*(void) const {
+                    return SkyrimMod(store, *it);
+                }
+
+                inline const_iterator &operator++(void) {
+                    ++it;
+                    return *this;
+                }
+
+                inline bool operator==(const_iterator const &other) const {
+                    return it == other.it;
+                }
+
+                inline bool operator!=(const_iterator const &other) const {
+                    return it != other.it;
+                }
+        };
+
+        // Creates a registry over the global mod store.
+        ModRegistry(void);
+
+        ModRegistry(ModStore &store):
+                store(&store),
+                mods(),
+                index() {
+        }
+
+        inline ModStore &getStore(void) const {
+            return *store;
+        }
+
+        SkyrimMod find(std::string_view name) const;
+
+        ssize_t indexOf(std::string_view name) const;
+
+        // Adds a new mod to the store and appends it.
+        SkyrimMod create(std::string_view base_name);
+
+        // Appends a mod from the same store.
+        void append(SkyrimMod const &mod);
+
+        // Takes on the mods of other in the same order. This registry's store must
+        // be a copy of other's, as made by ModStore::copyFrom().
+        void copyFrom(ModRegistry const &other);
+
+        void swap(size_t a, size_t b);
+
+        void move(size_t from, size_t to);
+
+        // Puts the list's mods in the given order, which must hold each of them
+        // exactly once.
+        void reorder(std::vector<ModId> const &order);
+
+        void clear(void);
+
+        inline size_t size(void) const {
+            return mods.size();
+        }
+
+        inline bool empty(void) const {
+            return mods.empty();
+        }
+
+        inline SkyrimMod at(size_t pos) const {
+            return SkyrimMod(store, mods.at(pos));
+        }
+
+        // The ids of the listed mods in order, e.g. to restore it later with reorder().
+        inline std::vector<ModId> const &getIds(void) const {
+            return mods;
+        }
+
+        inline const_iterator begin(void) const {
+            return const_iterator(store, mods.cbegin());
+        }
+
+        inline const_iterator end(void) const {
+            return const_iterator(store, mods.cend());
+        }
+};
 
-ModList &getGlobalModList(void);
+ModStore &getGlobalModStore(void);
 
-std::shared_ptr<SkyrimMod> find_mod(ModList const &mod_list, std::string const &name);
+ModRegistry &getGlobalModList(void);
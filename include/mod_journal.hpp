@@ -0,0 +1,139 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "mod.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define JOURNAL_NO_EXTRAS UINT32_MAX
+
+enum class JournalOp : uint8_t {
+    ENABLE,
+    DISABLE,
+    MOVE,
+    // the whole list put in a new order, e.g. by sorting it
+    REORDER
+};
+
+// A single edit, sized the same whatever it did. Toggles keep the state they
+// replaced so they can be undone exactly, since enabling a partially enabled mod
+// isn't reversed by disabling it.
+struct JournalEntry {
+    JournalOp op;
+    // for toggles, the mod's ESP and archive state from before
+    bool esp_enabled;
+    uint8_t bsas_enabled;
+    uint8_t bsas_animations;
+    // the mod toggled, the place a mod was moved from, or where the order a
+    // reorder replaced starts in the journal's order buffer
+    uint32_t target;
+    // for moves, the place the mod was moved to; for toggles, where the enabled
+    // counts of the mod's archives with unknown suffixes start in the journal's
+    // side buffer, or JOURNAL_NO_EXTRAS; for reorders, the length of the order
+    uint32_t arg;
+};
+
+// Append-only log of the edits made to a mod list, which can be stepped back and
+// forth through. Each step touches only the mod it concerns, so undoing and
+// redoing cost the same as the edit did however long the session has been,
+// and the list itself is only copied for edits which reorder all of it. Making
+// a new edit after undoing drops the undone entries.
+//
+// Entries refer to mods by id and to places in the list by index, so anything
+// which changes the list other than through the journal must clear it.
+class ModJournal {
+    private:
+        ModRegistry &mod_list;
+        std::vector<JournalEntry> entries;
+        // enabled counts of archives with unknown suffixes from before a toggle,
+        // for the few mods which have any
+        std::vector<uint8_t> extra_counts;
+        // orders replaced by reorders, or for undone reorders the orders they made
+        std::vector<ModId> orders;
+        // number of entries in effect; those past it have been undone
+        size_t position;
+
+        void append(JournalEntry const &entry);
+
+        void apply(JournalEntry const &entry);
+
+        void swapOrder(JournalEntry const &entry);
+
+    public:
+        ModJournal(ModRegistry &mod_list):
+                mod_list(mod_list),
+                entries(),
+                extra_counts(),
+                orders(),
+                position(0) {
+        }
+
+        // Enables the mod, or disables it if it's fully enabled already, as (A)
+        // does. Returns the op which was applied.
+        JournalOp toggle(SkyrimMod const &mod);
+
+        // Records a move which was already made to the list.
+        void recordMove(size_t from, size_t to);
+
+        // Records a reorder of the whole list which was already made, given the
+        // order it had before.
+        void recordReorder(std::vector<ModId> const &previous);
+
+        // Reverts the latest entry in effect and returns it, or NULL if there's
+        // nothing left to undo.
+        JournalEntry const *undo(void);
+
+        // Reapplies the earliest undone entry and returns it, or NULL if there's
+        // nothing left to redo.
+        JournalEntry const *redo(void);
+
+        void clear(void);
+
+        inline bool canUndo(void) const {
+            return position > 0;
+        }
+
+        inline bool canRedo(void) const {
+            return position < entries.size();
+        }
+
+        inline size_t size(void) const {
+            return entries.size();
+        }
+
+        inline size_t getPosition(void) const {
+            return position;
+        }
+
+        // Memory held by the log, for judging how it grows over a session.
+        inline size_t getByteSize(void) const {
+            return entries.capacity() * sizeof(JournalEntry) + extra_counts.capacity()
+                    + orders.capacity() * sizeof(ModId);
+        }
+};
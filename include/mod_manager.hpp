@@ -0,0 +1,139 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "asset_index.hpp"
+#include "file_helper.hpp"
+#include "master_graph.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// threads used to read the Data directory, the Plugins file and both INIs at once
+#define LOAD_WORKERS 4
+
+// Scans the Data directory into the pending mod list.
+int discoverMods(void);
+
+// Reads the Plugins file, moving every mod it lists into the global mod list.
+int processPluginsFile(void);
+
+// Reads the archive lists from the INIs into both mod lists.
+int processInis(void);
+
+// Appends every discovered mod not placed by the Plugins file to the global mod list.
+void mergePendingMods(void);
+
+// Builds the global mod list by running the stages above one after another.
+int loadSourcesSequential(void);
+
+// Builds the same mod list as loadSourcesSequential(), but with the Data scan and
+// the reads of the Plugins file and both INIs issued concurrently on a pool of
+// LOAD_WORKERS threads. Parsing and merging then happen on this thread in the
+// usual order, so the result and whichever error is reported first don't depend
+// on how the reads were scheduled.
+int loadSourcesParallel(void);
+
+int writePluginsFile(size_t *bytes_written, bool *written);
+
+// Builds the global mod list from the snapshot cache if it's still fresh, or
+// otherwise from the Data directory, the Plugins file and the INIs.
+int loadModList(void);
+
+// Discards the loaded mod list, Plugins header and INIs so they can be loaded again.
+void resetModList(void);
+
+// Writes every output whose content changed since it was loaded or last saved.
+int writeChanges(size_t *bytes_written, bool *wrote_plugins, int *wrote_inis);
+
+enum class SaveStage {
+    IDLE,
+    PLUGINS,
+    INIS
+};
+
+// The outcome of a save run by queueSave().
+struct SaveResult {
+    int rc;
+    // the file which stopped the save, if it failed
+    FileError error;
+    bool wrote_plugins;
+    int wrote_inis;
+    size_t plugins_bytes;
+    size_t inis_bytes;
+    uint64_t plugins_ns;
+    uint64_t inis_ns;
+    uint64_t total_ns;
+    uint64_t plugins_allocs;
+    uint64_t inis_allocs;
+    // saves queued before this one which were dropped in its favour before being written
+    size_t superseded;
+};
+
+// Copies the load order and queues the copy to be written on the save worker,
+// so the caller can carry on while the files are written. A save which is queued
+// but not yet started is replaced rather than followed, so however quickly saves
+// are queued, only the latest state is written once the current one is done.
+// The global mod store must not be cleared while a save is queued.
+int queueSave(void);
+
+// Returns which output the save worker is writing, if any.
+SaveStage getSaveStage(void);
+
+// Returns whether a queued save has yet to finish.
+bool isSaveQueued(void);
+
+// Picks up the oldest save which finished since the last call, recording its
+// timings and reporting its failure the way writeChanges() would. Returns false
+// if no save has finished.
+bool pollSave(SaveResult *result);
+
+// Blocks until every queued save has finished.
+void waitForSaves(void);
+
+// Starts reading the header of every plugin in the global mod list on a worker,
+// so the master graph is built without holding up startup. Headers are read on
+// LOAD_WORKERS threads and cached between runs by size and mtime.
+void queueMasterGraphLoad(void);
+
+// Returns true once the master graph queued last has been built, recording how
+// long that took as a phase the first time it's seen. Main thread only.
+bool pollMasterGraph(void);
+
+// Blocks until the master graph queued last has been built and returns it.
+MasterGraph const &waitForMasterGraph(void);
+
+// Starts listing the assets of every archive in the global mod list on a worker,
+// the same way as queueMasterGraphLoad(). Only archives which changed since the
+// last load are read again, and directories are cached between runs.
+void queueAssetIndexLoad(void);
+
+// Returns true once the asset index queued last has been built, recording how
+// long that took as a phase the first time it's seen. Main thread only.
+bool pollAssetIndex(void);
+
+// Blocks until the asset index queued last has been built and returns it.
+AssetIndex const &waitForAssetIndex(void);
@@ -41,3 +41,9 @@ std::string getRomfsPath(std::string &partial);
 std::string getRomfsPath(const char *partial);
 
 const char *getBaseRomfsPath(void);
+
+// Overrides the romfs directory which would otherwise be picked based on the
+// installed Atmosphere version. Passing an empty string restores the default.
+void setBaseRomfsPath(const char *path);
+
+std::string getTitlePath(const char *partial);
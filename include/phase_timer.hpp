@@ -0,0 +1,88 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define PHASE_LOG_FILE "SkyMM.timing.log"
+#define PHASE_ROW_LEN 80
+
+struct PhaseRecord {
+    const char *name;
+    // nesting depth, 0 for a top-level phase
+    unsigned depth;
+    bool open;
+    uint64_t duration_ns;
+    // files scanned or read, and bytes read or written, including nested phases
+    uint64_t files;
+    uint64_t bytes;
+    uint64_t allocs;
+};
+
+// Times the enclosing scope as a named phase. Phases nest; records are kept in
+// the order they were opened, so a phase is followed by the phases within it.
+// Starting a top-level phase replaces the previous run of the same name.
+// Phases must only be opened from the main thread.
+class PhaseTimer {
+    private:
+        size_t record;
+        uint64_t start_tick;
+        uint64_t start_allocs;
+
+    public:
+        PhaseTimer(const char *name);
+
+        ~PhaseTimer();
+
+        PhaseTimer(PhaseTimer const &) = delete;
+
+        PhaseTimer &operator=(PhaseTimer const &) = delete;
+};
+
+// Adds a phase which was timed elsewhere, e.g. on a worker thread, as though it
+// had been opened and closed just now. Its depth is taken relative to the
+// innermost open phase, so a run can be added as a top-level record followed by
+// the records nested in it. Main thread only.
+void addPhaseRecord(PhaseRecord const &record);
+
+// Attributes work to the innermost open phase, if there is one. Like phases
+// themselves, these must only be called from the main thread.
+void phaseAddFiles(uint64_t count);
+
+void phaseAddBytes(uint64_t count);
+
+// Number of allocations made through operator new since startup.
+uint64_t getAllocationCount(void);
+
+std::vector<PhaseRecord> const &getPhaseRecords(void);
+
+// Formats a record as a fixed-width table row, or the table header if record is
+// NULL. buf should hold at least PHASE_ROW_LEN + 1 bytes.
+void formatPhaseRecord(PhaseRecord const *record, char *buf, size_t len);
+
+int appendPhaseLog(const char *path);
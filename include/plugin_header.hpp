@@ -0,0 +1,67 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// bytes taken by the first read of a plugin, which holds the whole TES4 record
+// of all but plugins with unusually long descriptions or master lists
+#define PLUGIN_HEADER_READ_SIZE 4096
+// TES4 records larger than this are taken to be corrupt rather than read
+#define PLUGIN_HEADER_MAX_SIZE 0x10000
+
+#define TES4_RECORD_HEADER_SIZE 24
+#define TES4_SUBRECORD_HEADER_SIZE 6
+
+// record flag marking a plugin as a master, whatever its extension
+#define TES4_FLAG_MASTER 0x1
+// record flag marking a light plugin (ESL)
+#define TES4_FLAG_LIGHT 0x200
+
+// What a plugin declares about itself in the TES4 record at the start of the file.
+struct PluginHeader {
+    uint32_t flags;
+    // file names of the plugins this one depends on, e.g. "Skyrim.esm", in the order listed
+    std::vector<std::string> masters;
+
+    inline bool isMasterFlagged(void) const {
+        return (flags & TES4_FLAG_MASTER) != 0;
+    }
+};
+
+// Parses the TES4 record at the start of data, which must hold the whole record.
+// Returns -1 if data doesn't start with a well-formed TES4 record.
+int parsePluginHeader(std::string_view data, PluginHeader *header);
+
+// Reads and parses the header of the plugin at path. The first
+// PLUGIN_HEADER_READ_SIZE bytes are read with a single positioned read, and the
+// rest of the record only if it doesn't fit. This isn't attributed to a phase,
+// so it can be called from worker threads.
+int readPluginHeader(const char *path, PluginHeader *header, size_t *bytes_read);
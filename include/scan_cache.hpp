@@ -0,0 +1,50 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "mod.hpp"
+
+#include <string>
+#include <vector>
+
+#define SCAN_CACHE_FILE "SkyMM.cache"
+
+#define SCAN_CACHE_MAGIC 0x434D4B53 // "SKMC"
+#define SCAN_CACHE_VERSION 2
+
+// Restores a mod list previously written by saveScanCache(). The snapshot is
+// only accepted if every input path still has the mtime and size it had when
+// the snapshot was written.
+//
+// Returns 0 on a hit or -1 if the snapshot is missing, stale or malformed, in
+// which case mod_list and plugins_header are left untouched.
+int loadScanCache(const char *path, std::vector<std::string> const &inputs, ModRegistry &mod_list,
+        std::string &plugins_header);
+
+int saveScanCache(const char *path, std::vector<std::string> const &inputs, ModRegistry const &mod_list,
+        std::string const &plugins_header);
+
+void invalidateScanCache(const char *path);
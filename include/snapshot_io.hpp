@@ -0,0 +1,121 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Serializes the fields of a cache file in native byte order. Strings are written
+// as a u32 length followed by that many bytes.
+class SnapshotWriter {
+    private:
+        std::string &buf;
+
+    public:
+        SnapshotWriter(std::string &buf):
+                buf(buf) {
+        }
+
+        template<typename T>
+        void put(T val) {
+            buf.append((const char *) &val, sizeof(T));
+        }
+
+        void putString(std::string_view str) {
+            put<uint32_t>((uint32_t) str.size());
+            buf.append(str.data(), str.size());
+        }
+
+        // Writes the raw bytes of count values, without a length.
+        template<typename T>
+        void putArray(T const *vals, size_t count) {
+            buf.append((const char *) vals, count * sizeof(T));
+        }
+};
+
+// Reads back what a SnapshotWriter wrote. Reading past the end of the buffer
+// yields zeroes and marks the reader as failed instead of overrunning it.
+class SnapshotReader {
+    private:
+        std::string_view buf;
+        size_t off;
+        bool failed;
+
+    public:
+        SnapshotReader(std::string_view buf):
+                buf(buf),
+                off(0),
+                failed(false) {
+        }
+
+        template<typename T>
+        T get(void) {
+            T val = T();
+            if (failed || buf.size() - off < sizeof(T)) {
+                failed = true;
+                return val;
+            }
+            memcpy(&val, buf.data() + off, sizeof(T));
+            off += sizeof(T);
+            return val;
+        }
+
+        std::string_view getString(void) {
+            uint32_t len = get<uint32_t>();
+            if (failed || buf.size() - off < len) {
+                failed = true;
+                return std::string_view();
+            }
+            std::string_view str = buf.substr(off, len);
+            off += len;
+            return str;
+        }
+
+        // Reads count values written by putArray() into out, replacing its contents.
+        template<typename T>
+        void getArray(size_t count, std::vector<T> &out) {
+            out.clear();
+            if (failed || (buf.size() - off) / sizeof(T) < count) {
+                failed = true;
+                return;
+            }
+            out.resize(count);
+            memcpy(out.data(), buf.data() + off, count * sizeof(T));
+            off += count * sizeof(T);
+        }
+
+        bool good(void) const {
+            return !failed;
+        }
+
+        bool atEnd(void) const {
+            return off == buf.size();
+        }
+};
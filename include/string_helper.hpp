@@ -26,9 +26,13 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <cctype>
+
 inline std::string trim(std::string &str) {
     std::string sc = str;
     sc.erase(sc.begin(), std::find_if(sc.begin(), sc.end(), [](int ch) { return !std::isspace(ch); }));
@@ -36,6 +40,18 @@ inline std::string trim(std::string &str) {
     return sc;
 }
 
+inline std::string_view trimView(std::string_view str) {
+    size_t start = 0;
+    size_t end = str.size();
+    while (start < end && std::isspace((unsigned char) str[start])) {
+        start++;
+    }
+    while (end > start && std::isspace((unsigned char) str[end - 1])) {
+        end--;
+    }
+    return str.substr(start, end - start);
+}
+
 inline std::vector<std::string> split(std::string str, std::string delim) {
     std::vector<std::string> res;
     size_t pos = 0;
@@ -50,3 +66,53 @@ inline std::vector<std::string> split(std::string str, std::string delim) {
 
     return res;
 }
+
+inline char foldCase(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? (ch | 0x20) : ch;
+}
+
+// FNV-1a over the case-folded bytes of the string
+inline uint32_t hashFolded(std::string_view str) {
+    uint32_t hash = 2166136261u;
+    for (char ch : str) {
+        hash ^= (uint8_t) foldCase(ch);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// FNV-1a over the raw bytes of the string, optionally continuing from a previous hash
+inline uint64_t hashBytes(std::string_view str, uint64_t hash = 14695981039346656037ull) {
+    for (char ch : str) {
+        hash ^= (uint8_t) ch;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline bool equalsFolded(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); i++) {
+        if (foldCase(a[i]) != foldCase(b[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Case-insensitive hashing and comparison for unordered containers keyed by file name.
+struct FoldedHash {
+    size_t operator()(std::string_view str) const {
+        return hashFolded(str);
+    }
+};
+
+struct FoldedEqual {
+    bool operator()(std::string_view a, std::string_view b) const {
+        return equalsFolded(a, b);
+    }
+};
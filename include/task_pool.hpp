@@ -0,0 +1,67 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads running queued tasks in submission order.
+// Tasks must not touch console output or phase timing, both of which belong to
+// the main thread; they should leave their results where the submitter can pick
+// them up after wait().
+class TaskPool {
+    private:
+        std::mutex mutex;
+        std::condition_variable has_work;
+        std::condition_variable idle;
+        std::deque<std::function<void(void)>> tasks;
+        std::vector<std::thread> workers;
+        // tasks submitted but not yet finished, queued or running
+        size_t pending;
+        bool closed;
+
+        void runWorker(void);
+
+    public:
+        TaskPool(size_t worker_count);
+
+        // Finishes every queued task before the workers are joined.
+        ~TaskPool();
+
+        TaskPool(TaskPool const &) = delete;
+
+        TaskPool &operator=(TaskPool const &) = delete;
+
+        void submit(std::function<void(void)> &&task);
+
+        // Blocks until every task submitted so far has finished.
+        void wait(void);
+};
@@ -0,0 +1,382 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "asset_index.hpp"
+
+#include "bsa_archive.hpp"
+#include "file_helper.hpp"
+#include "mod.hpp"
+#include "snapshot_io.hpp"
+#include "string_helper.hpp"
+#include "task_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+// Cache layout (native byte order):
+//
+//   u32 magic, u32 version
+//   u32 archive count, then per archive:
+//     str file name, i64 mtime, i64 size, u8 status, u32 asset count
+//   u32 entry count, then per entry: u64 folder hash, u64 file hash
+//   then per entry: u32 archive
+//
+// where str is a u32 length followed by that many bytes (see SnapshotWriter).
+// Entries are stored sorted, as the index holds them, so a launch which finds
+// every archive as it was left takes them as they are instead of sorting again.
+
+void AssetIndex::readCache(std::string const &path, std::vector<Archive> &cached, std::vector<Entry> &cached_entries,
+        size_t *bytes_read) {
+    std::string data;
+    if (readFileUntracked(path.c_str(), data) != 0) {
+        return;
+    }
+    *bytes_read += data.size();
+
+    SnapshotReader reader(data);
+    if (reader.get<uint32_t>() != ASSET_CACHE_MAGIC || reader.get<uint32_t>() != ASSET_CACHE_VERSION) {
+        return;
+    }
+
+    uint32_t count = reader.get<uint32_t>();
+    std::vector<uint32_t> asset_counts;
+    for (uint32_t i = 0; i < count && reader.good(); i++) {
+        Archive archive;
+        archive.file_name = std::string(reader.getString());
+        archive.stamp.mtime = reader.get<int64_t>();
+        archive.stamp.size = reader.get<int64_t>();
+        uint8_t status = reader.get<uint8_t>();
+        archive.status = (ArchiveStatus) status;
+        uint32_t asset_count = reader.get<uint32_t>();
+
+        if (!reader.good() || status > (uint8_t) ArchiveStatus::MALFORMED) {
+            break;
+        }
+        cached.insert(cached.end(), std::move(archive));
+        asset_counts.insert(asset_counts.end(), asset_count);
+    }
+
+    std::vector<AssetHash> assets;
+    std::vector<uint32_t> owners;
+    uint32_t entry_count = reader.get<uint32_t>();
+    reader.getArray(entry_count, assets);
+    reader.getArray(entry_count, owners);
+    if (!reader.good() || !reader.atEnd() || cached.size() != count) {
+        cached.clear();
+        return;
+    }
+
+    // each archive's assets come out sorted, as they'd be after reading it
+    for (size_t i = 0; i < cached.size(); i++) {
+        cached[i].assets.reserve(asset_counts[i]);
+    }
+    cached_entries.reserve(entry_count);
+    for (size_t i = 0; i < entry_count; i++) {
+        Entry entry = { assets[i], owners[i] };
+        if (entry.archive >= cached.size() || (i > 0 && !entryLess(cached_entries.back(), entry))) {
+            cached.clear();
+            cached_entries.clear();
+            return;
+        }
+        cached[entry.archive].assets.insert(cached[entry.archive].assets.end(), entry.asset);
+        cached_entries.insert(cached_entries.end(), entry);
+    }
+
+    for (size_t i = 0; i < cached.size(); i++) {
+        if (cached[i].assets.size() != asset_counts[i]) {
+            cached.clear();
+            cached_entries.clear();
+            return;
+        }
+    }
+}
+
+void AssetIndex::clear(void) {
+    archives.clear();
+    entries.clear();
+}
+
+int AssetIndex::load(std::string const &data_dir, std::vector<std::string> const &file_names,
+        std::string const &cache_path, size_t worker_count, AssetIndexStats *stats) {
+    *stats = AssetIndexStats();
+
+    // directories are carried over from the last load, so a rescan only reads
+    // the archives which changed, and from the cache if this is the first load
+    std::vector<Archive> previous = std::move(archives);
+    std::vector<Entry> previous_entries = std::move(entries);
+    clear();
+    if (previous.empty()) {
+        readCache(cache_path, previous, previous_entries, &stats->bytes_read);
+    }
+
+    std::unordered_map<std::string_view, size_t, FoldedHash, FoldedEqual> previous_index;
+    previous_index.reserve(previous.size());
+    for (size_t i = 0; i < previous.size(); i++) {
+        previous_index.emplace(previous[i].file_name, i);
+    }
+
+    archives.resize(file_names.size());
+    // bytes read from each archive, or -1 if its directory wasn't read
+    std::vector<int64_t> read_sizes(file_names.size(), -1);
+
+    {
+        // each worker fills in its own slice of archives, and since file names
+        // are distinct, takes the directories of distinct previous archives
+        TaskPool pool(worker_count);
+        for (size_t start = 0; start < archives.size(); start += ASSET_INDEX_BATCH) {
+            size_t end = std::min(start + ASSET_INDEX_BATCH, archives.size());
+            pool.submit([&, start, end]() {
+                for (size_t i = start; i < end; i++) {
+                    Archive &archive = archives[i];
+                    archive.file_name = file_names[i];
+
+                    std::string path = data_dir + "/" + archive.file_name;
+                    if (statFile(path.c_str(), &archive.stamp) != 0) {
+                        archive.stamp = FileStamp();
+                        archive.status = ArchiveStatus::MISSING;
+                        continue;
+                    }
+
+                    // without an mtime a cached directory can't be told apart from a stale one
+                    auto it = previous_index.find(archive.file_name);
+                    if (it != previous_index.end() && archive.stamp.mtime != 0
+                            && previous[it->second].stamp.mtime == archive.stamp.mtime
+                            && previous[it->second].stamp.size == archive.stamp.size) {
+                        archive.status = previous[it->second].status;
+                        archive.assets = std::move(previous[it->second].assets);
+                        continue;
+                    }
+
+                    size_t bytes_read = 0;
+                    int rc = readBsaAssets(path.c_str(), archive.assets, &bytes_read);
+                    read_sizes[i] = bytes_read;
+                    archive.status = rc == 0 ? ArchiveStatus::OK : ArchiveStatus::MALFORMED;
+
+                    // an archive listing a file twice still only provides it once
+                    std::sort(archive.assets.begin(), archive.assets.end());
+                    archive.assets.erase(std::unique(archive.assets.begin(), archive.assets.end()),
+                            archive.assets.end());
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    stats->archives = archives.size();
+    for (size_t i = 0; i < archives.size(); i++) {
+        if (read_sizes[i] >= 0) {
+            stats->read++;
+            stats->bytes_read += read_sizes[i];
+        } else if (archives[i].status != ArchiveStatus::MISSING) {
+            stats->cached++;
+        }
+        if (archives[i].status != ArchiveStatus::OK) {
+            stats->failed++;
+        }
+        stats->assets += archives[i].assets.size();
+    }
+
+    // the last load's entries still hold if every archive kept its directory and
+    // its position, as they do when a rescan finds the archives untouched
+    bool unchanged = !previous_entries.empty() && previous.size() == archives.size();
+    for (size_t i = 0; i < archives.size() && unchanged; i++) {
+        unchanged = read_sizes[i] < 0 && archives[i].status == previous[i].status
+                && archives[i].file_name == previous[i].file_name;
+    }
+
+    if (unchanged) {
+        entries = std::move(previous_entries);
+    } else {
+        entries.reserve(stats->assets);
+        for (size_t i = 0; i < archives.size(); i++) {
+            for (AssetHash const &asset : archives[i].assets) {
+                entries.insert(entries.end(), { asset, (uint32_t) i });
+            }
+        }
+        std::sort(entries.begin(), entries.end(), entryLess);
+    }
+    for (size_t i = 0; i < entries.size(); ) {
+        size_t end = i + 1;
+        while (end < entries.size() && entries[end].asset == entries[i].asset) {
+            end++;
+        }
+        stats->shared_assets += end - i > 1;
+        i = end;
+    }
+
+    // a cache which already matches the index exactly doesn't need rewriting
+    if (stats->read == 0 && stats->cached == previous.size()) {
+        return 0;
+    }
+
+    std::string data;
+    SnapshotWriter writer(data);
+    writer.put<uint32_t>(ASSET_CACHE_MAGIC);
+    writer.put<uint32_t>(ASSET_CACHE_VERSION);
+
+    // archives left out of the cache take their entries with them, and the rest
+    // are renumbered to match
+    std::vector<uint32_t> cached_positions(archives.size(), UINT32_MAX);
+    size_t count_off = data.size();
+    uint32_t count = 0;
+    writer.put<uint32_t>(0);
+    for (size_t i = 0; i < archives.size(); i++) {
+        Archive const &archive = archives[i];
+        if (archive.status == ArchiveStatus::MISSING || archive.stamp.mtime == 0) {
+            continue;
+        }
+
+        writer.putString(archive.file_name);
+        writer.put<int64_t>(archive.stamp.mtime);
+        writer.put<int64_t>(archive.stamp.size);
+        writer.put<uint8_t>((uint8_t) archive.status);
+        writer.put<uint32_t>(archive.assets.size());
+        cached_positions[i] = count++;
+    }
+    memcpy(&data[count_off], &count, sizeof(count));
+
+    std::vector<AssetHash> assets;
+    std::vector<uint32_t> owners;
+    assets.reserve(entries.size());
+    owners.reserve(entries.size());
+    for (Entry const &entry : entries) {
+        if (cached_positions[entry.archive] != UINT32_MAX) {
+            assets.insert(assets.end(), entry.asset);
+            owners.insert(owners.end(), cached_positions[entry.archive]);
+        }
+    }
+    writer.put<uint32_t>(assets.size());
+    writer.putArray(assets.data(), assets.size());
+    writer.putArray(owners.data(), owners.size());
+
+    if (writeFileAtomicUntracked(cache_path.c_str(), data) != 0) {
+        return -1;
+    }
+    stats->bytes_written = data.size();
+
+    return 0;
+}
+
+size_t AssetIndex::size(void) const {
+    return archives.size();
+}
+
+std::string const &AssetIndex::getFileName(size_t i) const {
+    return archives[i].file_name;
+}
+
+ArchiveStatus AssetIndex::getStatus(size_t i) const {
+    return archives[i].status;
+}
+
+size_t AssetIndex::getAssetCount(size_t i) const {
+    return archives[i].assets.size();
+}
+
+size_t AssetIndex::findProviders(AssetHash const &asset, std::vector<size_t> &providers) const {
+    auto it = std::lower_bound(entries.begin(), entries.end(), asset, [](Entry const &entry, AssetHash const &key) {
+        return entry.asset < key;
+    });
+
+    size_t found = 0;
+    for (; it != entries.end() && it->asset == asset; ++it) {
+        providers.insert(providers.end(), it->archive);
+        found++;
+    }
+    return found;
+}
+
+void findAssetConflicts(ModRegistry const &mod_list, AssetIndex const &index, std::vector<AssetConflict> &conflicts,
+        AssetConflictStats *stats) {
+    *stats = AssetConflictStats();
+    conflicts.clear();
+
+    // the position in mod_list of each archive's mod, or -1 if the archive
+    // doesn't load
+    std::vector<ssize_t> positions(index.size(), -1);
+    for (size_t i = 0; i < index.size(); i++) {
+        if (index.getStatus(i) != ArchiveStatus::OK) {
+            continue;
+        }
+
+        ModFileView file = ModFileView::classify(index.getFileName(i));
+        ssize_t pos = mod_list.indexOf(file.base_name);
+        if (pos >= 0 && mod_list.at(pos).isBsaEnabled(file.suffix)) {
+            positions[i] = pos;
+            stats->enabled_archives++;
+        }
+    }
+
+    // one key per asset a mod overrides in another, holding the winner's position
+    // above the loser's, so sorting the keys groups them into conflicts in order
+    std::vector<uint64_t> overrides;
+    std::vector<ssize_t> losers;
+    index.forEachShared([&](AssetHash const &, uint32_t const *providers, size_t count) {
+        ssize_t winner = -1;
+        for (size_t i = 0; i < count; i++) {
+            winner = std::max(winner, positions[providers[i]]);
+        }
+
+        // a mod with several archives providing the asset only loses it once
+        losers.clear();
+        for (size_t i = 0; i < count; i++) {
+            ssize_t pos = positions[providers[i]];
+            if (pos >= 0 && pos != winner) {
+                losers.insert(losers.end(), pos);
+            }
+        }
+        if (losers.empty()) {
+            return;
+        }
+        std::sort(losers.begin(), losers.end());
+        losers.erase(std::unique(losers.begin(), losers.end()), losers.end());
+
+        for (ssize_t loser : losers) {
+            overrides.insert(overrides.end(), (uint64_t) winner << 32 | (uint64_t) loser);
+        }
+        stats->contested_assets++;
+    });
+    std::sort(overrides.begin(), overrides.end());
+
+    for (size_t i = 0; i < overrides.size(); ) {
+        size_t end = i + 1;
+        while (end < overrides.size() && overrides[end] == overrides[i]) {
+            end++;
+        }
+        conflicts.insert(conflicts.end(), {
+            mod_list.at(overrides[i] >> 32).getId(),
+            mod_list.at(overrides[i] & UINT32_MAX).getId(),
+            end - i
+        });
+        i = end;
+    }
+}
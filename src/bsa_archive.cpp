@@ -0,0 +1,217 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "bsa_archive.hpp"
+
+#include "file_helper.hpp"
+#include "string_helper.hpp"
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Archives are little-endian, as is everything this runs on, so fields are copied
+// out as they are.
+template<typename T>
+static inline T readField(std::string_view data, size_t off) {
+    T val;
+    memcpy(&val, data.data() + off, sizeof(T));
+    return val;
+}
+
+// the game hashes names in lower case and with backslashes
+static inline uint32_t foldHashChar(char ch) {
+    return (uint8_t) (ch == '/' ? '\\' : foldCase(ch));
+}
+
+// Hashes a name split into its stem and extension (with the dot), where a
+// folder's whole path is the stem. The low half is built from the length and a
+// few characters of the stem, flagged by the common asset types, and the high
+// half from the rest of the stem and the extension.
+static uint64_t hashBsaName(std::string_view stem, std::string_view ext) {
+    size_t len = stem.size();
+    if (len == 0) {
+        return 0;
+    }
+
+    uint32_t low = foldHashChar(stem[len - 1])
+            | (len > 2 ? foldHashChar(stem[len - 2]) << 8 : 0)
+            | (uint32_t) len << 16
+            | foldHashChar(stem[0]) << 24;
+    if (equalsFolded(ext, ".kf")) {
+        low |= 0x80;
+    } else if (equalsFolded(ext, ".nif")) {
+        low |= 0x8000;
+    } else if (equalsFolded(ext, ".dds")) {
+        low |= 0x8080;
+    } else if (equalsFolded(ext, ".wav")) {
+        low |= 0x80000000;
+    }
+
+    uint32_t stem_hash = 0;
+    for (size_t i = 1; i + 2 < len; i++) {
+        stem_hash = stem_hash * 0x1003F + foldHashChar(stem[i]);
+    }
+    uint32_t ext_hash = 0;
+    for (char ch : ext) {
+        ext_hash = ext_hash * 0x1003F + foldHashChar(ch);
+    }
+
+    return (uint64_t) (stem_hash + ext_hash) << 32 | low;
+}
+
+uint64_t hashBsaFolder(std::string_view path) {
+    return hashBsaName(path, std::string_view());
+}
+
+uint64_t hashBsaFile(std::string_view name) {
+    size_t dot = name.rfind('.');
+    if (dot == std::string_view::npos) {
+        return hashBsaName(name, std::string_view());
+    }
+    return hashBsaName(name.substr(0, dot), name.substr(dot));
+}
+
+AssetHash hashAssetPath(std::string_view path) {
+    size_t slash = path.find_last_of("\\/");
+    if (slash == std::string_view::npos) {
+        return { 0, hashBsaFile(path) };
+    }
+    return { hashBsaFolder(path.substr(0, slash)), hashBsaFile(path.substr(slash + 1)) };
+}
+
+size_t BsaHeader::getDirectorySize(void) const {
+    size_t folder_record_size = version == BSA_VERSION_SKYRIM_SE ? BSA_FOLDER_RECORD_SIZE_SE : BSA_FOLDER_RECORD_SIZE;
+    size_t size = BSA_HEADER_SIZE + (size_t) folder_count * folder_record_size
+            + (size_t) file_count * BSA_FILE_RECORD_SIZE;
+    if (flags & BSA_FLAG_FOLDER_NAMES) {
+        size += (size_t) folder_count + folder_names_length;
+    }
+    return size;
+}
+
+// Header layout:
+//
+//   char[4] "BSA\0", u32 version, u32 offset of the folder records (always 36),
+//   u32 archive flags, u32 folder count, u32 file count, u32 total folder name
+//   length, u32 total file name length, u16 file flags, u16 padding
+int parseBsaHeader(std::string_view data, BsaHeader *header) {
+    if (data.size() < BSA_HEADER_SIZE || data.substr(0, 4) != std::string_view("BSA\0", 4)) {
+        return -1;
+    }
+
+    header->version = readField<uint32_t>(data, 4);
+    if (header->version < BSA_VERSION_OBLIVION || header->version > BSA_VERSION_SKYRIM_SE
+            || readField<uint32_t>(data, 8) != BSA_HEADER_SIZE) {
+        return -1;
+    }
+
+    header->flags = readField<uint32_t>(data, 12);
+    header->folder_count = readField<uint32_t>(data, 16);
+    header->file_count = readField<uint32_t>(data, 20);
+    header->folder_names_length = readField<uint32_t>(data, 24);
+    return 0;
+}
+
+// Directory layout, following the header:
+//
+//   per folder: u64 name hash, u32 file count, then u32 offset (u32 padding and
+//     u64 offset for version 105)
+//   per folder: the folder name as a u8 length and that many bytes, if the
+//     archive has folder names, then per file: u64 name hash, u32 size, u32 offset
+//
+// The file names and data come after, neither of which is needed here.
+int parseBsaDirectory(std::string_view data, BsaHeader const &header, std::vector<AssetHash> &assets) {
+    size_t dir_size = header.getDirectorySize();
+    if (data.size() < dir_size) {
+        return -1;
+    }
+
+    size_t folder_record_size = header.version == BSA_VERSION_SKYRIM_SE ? BSA_FOLDER_RECORD_SIZE_SE
+            : BSA_FOLDER_RECORD_SIZE;
+    size_t start_size = assets.size();
+    assets.reserve(start_size + header.file_count);
+
+    size_t off = BSA_HEADER_SIZE + (size_t) header.folder_count * folder_record_size;
+    size_t files_left = header.file_count;
+    for (uint32_t i = 0; i < header.folder_count; i++) {
+        size_t record = BSA_HEADER_SIZE + i * folder_record_size;
+        uint64_t folder_hash = readField<uint64_t>(data, record);
+        uint32_t count = readField<uint32_t>(data, record + 8);
+
+        if ((header.flags & BSA_FLAG_FOLDER_NAMES) && off < dir_size) {
+            off += 1 + (uint8_t) data[off];
+        }
+        if (count > files_left || off > dir_size || (dir_size - off) / BSA_FILE_RECORD_SIZE < count) {
+            assets.resize(start_size);
+            return -1;
+        }
+
+        for (uint32_t j = 0; j < count; j++) {
+            assets.insert(assets.end(), { folder_hash, readField<uint64_t>(data, off) });
+            off += BSA_FILE_RECORD_SIZE;
+        }
+        files_left -= count;
+    }
+
+    if (files_left != 0) {
+        assets.resize(start_size);
+        return -1;
+    }
+    return 0;
+}
+
+int readBsaAssets(const char *path, std::vector<AssetHash> &assets, size_t *bytes_read) {
+    assets.clear();
+    *bytes_read = 0;
+
+    std::string data;
+    if (readFileRangeUntracked(path, 0, BSA_DIRECTORY_READ_SIZE, data) != 0) {
+        return -1;
+    }
+    *bytes_read = data.size();
+
+    BsaHeader header;
+    if (parseBsaHeader(data, &header) != 0) {
+        return -1;
+    }
+
+    size_t dir_size = header.getDirectorySize();
+    if (dir_size > BSA_DIRECTORY_MAX_SIZE) {
+        return -1;
+    }
+    // a short first read means the file ended, so a directory past it is truncated
+    if (dir_size > data.size() && data.size() == BSA_DIRECTORY_READ_SIZE) {
+        std::string rest;
+        if (readFileRangeUntracked(path, data.size(), dir_size - data.size(), rest) != 0) {
+            return -1;
+        }
+        *bytes_read += rest.size();
+        data += rest;
+    }
+
+    return parseBsaDirectory(data, header, assets);
+}
@@ -0,0 +1,214 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "console_renderer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+// unchanged cells between two changed ones are rewritten rather than skipped
+// with a cursor escape if the gap is at most this wide
+#define MAX_REWRITE_GAP 4
+
+// a cell which never matches anything that can be drawn, used for unknown screen contents
+static const ConsoleCell UNKNOWN_CELL = {'\0', {0xFF, 0xFF, 0xFF}};
+
+ConsoleRenderer::ConsoleRenderer(size_t rows, size_t cols, ConsoleStyle clear_style, unsigned cursor_origin,
+        bool scroll_regions, ConsoleSink sink):
+        rows(rows),
+        cols(cols),
+        clear_style(clear_style),
+        cursor_origin(cursor_origin),
+        scroll_regions(scroll_regions),
+        sink(sink),
+        front(rows * cols, UNKNOWN_CELL),
+        back(rows * cols, {' ', clear_style}),
+        out(),
+        cursor_known(false),
+        cursor_row(0),
+        cursor_col(0),
+        style_known(false),
+        cur_style(clear_style),
+        total_bytes(0) {
+}
+
+void ConsoleRenderer::clearRow(size_t row) {
+    clearRow(row, clear_style);
+}
+
+void ConsoleRenderer::clearRow(size_t row, ConsoleStyle const &style) {
+    if (row >= rows) {
+        return;
+    }
+    std::fill(back.begin() + row * cols, back.begin() + (row + 1) * cols, ConsoleCell {' ', style});
+}
+
+size_t ConsoleRenderer::putText(size_t row, size_t col, std::string_view text, ConsoleStyle const &style) {
+    if (row >= rows) {
+        return col;
+    }
+
+    for (char ch : text) {
+        if (col >= cols) {
+            break;
+        }
+        back[row * cols + col] = {ch, style};
+        col++;
+    }
+
+    return col;
+}
+
+void ConsoleRenderer::shiftRows(size_t top, size_t bottom, int delta) {
+    if (!scroll_regions || delta == 0 || bottom >= rows || top >= bottom) {
+        return;
+    }
+
+    size_t height = bottom - top + 1;
+    size_t dist = (size_t) std::abs(delta);
+    if (dist >= height) {
+        return;
+    }
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "\x1b[%zu;%zur\x1b[%zu%c\x1b[r",
+            top + 1, bottom + 1, dist, delta > 0 ? 'S' : 'T');
+    out += buf;
+
+    // setting the scroll region homes the cursor
+    cursor_known = false;
+
+    auto region_begin = front.begin() + top * cols;
+    auto region_end = front.begin() + (bottom + 1) * cols;
+    if (delta > 0) {
+        std::copy(region_begin + dist * cols, region_end, region_begin);
+        std::fill(region_end - dist * cols, region_end, UNKNOWN_CELL);
+    } else {
+        std::copy_backward(region_begin, region_end - dist * cols, region_end);
+        std::fill(region_begin, region_begin + dist * cols, UNKNOWN_CELL);
+    }
+}
+
+void ConsoleRenderer::invalidate(bool cleared) {
+    std::fill(front.begin(), front.end(), cleared ? ConsoleCell {' ', clear_style} : UNKNOWN_CELL);
+    cursor_known = false;
+    style_known = false;
+}
+
+void ConsoleRenderer::moveCursor(size_t row, size_t col) {
+    if (cursor_known && cursor_row == row && cursor_col == col) {
+        return;
+    }
+
+    char buf[24];
+    if (cursor_known && cursor_row == row && cursor_col < col) {
+        // a relative move is shorter than an absolute one
+        snprintf(buf, sizeof(buf), "\x1b[%zuC", col - cursor_col);
+    } else {
+        snprintf(buf, sizeof(buf), "\x1b[%zu;%zuH", row + cursor_origin, col + cursor_origin);
+    }
+    out += buf;
+
+    cursor_known = true;
+    cursor_row = row;
+    cursor_col = col;
+}
+
+void ConsoleRenderer::setStyle(ConsoleStyle const &style) {
+    if (style_known && style == cur_style) {
+        return;
+    }
+
+    char buf[16];
+    // attribute changes may reset the colors, so those are re-sent afterwards
+    bool force_colors = !style_known || style.attr != cur_style.attr;
+    if (force_colors) {
+        snprintf(buf, sizeof(buf), "\x1b[%um", style.attr);
+        out += buf;
+    }
+    if (force_colors || style.fg != cur_style.fg) {
+        snprintf(buf, sizeof(buf), "\x1b[%um", style.fg);
+        out += buf;
+    }
+    if (force_colors || style.bg != cur_style.bg) {
+        snprintf(buf, sizeof(buf), "\x1b[%um", style.bg);
+        out += buf;
+    }
+
+    style_known = true;
+    cur_style = style;
+}
+
+void ConsoleRenderer::emitCell(size_t row, size_t col) {
+    ConsoleCell const &cell = back[row * cols + col];
+
+    moveCursor(row, col);
+    setStyle(cell.style);
+    out += cell.ch;
+    front[row * cols + col] = cell;
+
+    cursor_col++;
+    if (cursor_col >= cols) {
+        // terminals disagree on where the cursor ends up after the last column
+        cursor_known = false;
+    }
+}
+
+size_t ConsoleRenderer::present(void) {
+    for (size_t row = 0; row < rows; row++) {
+        size_t base = row * cols;
+        size_t col = 0;
+        while (col < cols) {
+            if (front[base + col] == back[base + col]) {
+                col++;
+                continue;
+            }
+
+            // extend the run across short gaps of unchanged cells
+            size_t last_diff = col;
+            for (size_t c = col + 1; c < cols && c - last_diff <= MAX_REWRITE_GAP; c++) {
+                if (front[base + c] != back[base + c]) {
+                    last_diff = c;
+                }
+            }
+
+            for (size_t c = col; c <= last_diff; c++) {
+                emitCell(row, c);
+            }
+            col = last_diff + 1;
+        }
+    }
+
+    size_t emitted = out.size();
+    if (emitted > 0) {
+        sink(out.data(), out.size());
+        total_bytes += emitted;
+        out.clear();
+    }
+    return emitted;
+}
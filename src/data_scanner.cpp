@@ -0,0 +1,328 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "data_scanner.hpp"
+#include "mod.hpp"
+#include "string_helper.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+struct ScanBatch {
+    size_t first_seq;
+    size_t count;
+    // file names, each terminated by a NUL byte
+    std::string names;
+};
+
+struct PartialMod {
+    size_t first_seq;
+    std::string base_name;
+    bool has_esp;
+    bool is_master;
+    // archives with known suffixes, as BSA_BIT()s
+    uint8_t bsa_mask;
+    std::vector<std::string> extra_bsa_suffixes;
+};
+
+typedef std::unordered_map<std::string, PartialMod, FoldedHash, FoldedEqual> PartialModMap;
+
+class BatchQueue {
+    private:
+        std::mutex mutex;
+        std::condition_variable not_empty;
+        std::condition_variable not_full;
+        std::deque<ScanBatch> batches;
+        bool closed;
+
+    public:
+        BatchQueue(void):
+                mutex(),
+                not_empty(),
+                not_full(),
+                batches(),
+                closed(false) {
+        }
+
+        void push(ScanBatch &&batch) {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [this] { return batches.size() < SCAN_QUEUE_DEPTH; });
+            batches.push_back(std::move(batch));
+            not_empty.notify_one();
+        }
+
+        // Blocks until a batch is available. Returns false once the queue has
+        // been closed and drained.
+        bool pop(ScanBatch &batch) {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_empty.wait(lock, [this] { return closed || !batches.empty(); });
+            if (batches.empty()) {
+                return false;
+            }
+            batch = std::move(batches.front());
+            batches.pop_front();
+            not_full.notify_one();
+            return true;
+        }
+
+        void close(void) {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            not_empty.notify_all();
+        }
+};
+
+static bool isRegularFile(const char *dir_path, struct dirent *ent) {
+    if (ent->d_type != DT_UNKNOWN) {
+        return ent->d_type == DT_REG;
+    }
+
+    // not every filesystem reports the entry type, so fall back to a stat
+    struct stat st;
+    std::string full_path = std::string(dir_path) + "/" + ent->d_name;
+    return stat(full_path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// key_buf is scratch space for the map lookup, so a name is only copied to the
+// heap the first time its mod is seen
+static void classifyFile(PartialModMap &mods, std::string &key_buf, std::string_view file_name, size_t seq) {
+    ModFileView mod_file = ModFileView::classify(file_name);
+    if (mod_file.type == ModFileType::UNKNOWN) {
+        return;
+    }
+
+    key_buf.assign(mod_file.base_name);
+    auto it = mods.find(key_buf);
+    if (it == mods.end()) {
+        it = mods.emplace(key_buf, PartialMod {seq, key_buf, false, false, 0, {}}).first;
+    }
+    PartialMod &mod = it->second;
+
+    if (mod_file.type == ModFileType::ESP) {
+        mod.has_esp = true;
+    } else if (mod_file.type == ModFileType::ESM) {
+        mod.has_esp = true;
+        mod.is_master = true;
+    } else if (mod_file.type == ModFileType::BSA) {
+        BsaSuffix suffix = parseBsaSuffix(mod_file.suffix);
+        if (suffix != BsaSuffix::OTHER) {
+            mod.bsa_mask |= BSA_BIT(suffix);
+        } else {
+            mod.extra_bsa_suffixes.insert(mod.extra_bsa_suffixes.end(), std::string(mod_file.suffix));
+        }
+    }
+}
+
+static void runWorker(BatchQueue &queue, PartialModMap &mods) {
+    ScanBatch batch;
+    std::string key_buf;
+    while (queue.pop(batch)) {
+        const char *name = batch.names.c_str();
+        for (size_t i = 0; i < batch.count; i++) {
+            size_t len = strlen(name);
+            classifyFile(mods, key_buf, std::string_view(name, len), batch.first_seq + i);
+            name += len + 1;
+        }
+    }
+}
+
+static void mergePartial(PartialModMap &dest, PartialModMap &src) {
+    for (auto &entry : src) {
+        PartialMod &mod = entry.second;
+        auto it = dest.find(entry.first);
+        if (it == dest.end()) {
+            dest.emplace(entry.first, std::move(mod));
+            continue;
+        }
+
+        PartialMod &existing = it->second;
+        if (mod.first_seq < existing.first_seq) {
+            existing.first_seq = mod.first_seq;
+            existing.base_name = std::move(mod.base_name);
+        }
+        existing.has_esp |= mod.has_esp;
+        existing.is_master |= mod.is_master;
+        existing.bsa_mask |= mod.bsa_mask;
+        existing.extra_bsa_suffixes.insert(existing.extra_bsa_suffixes.end(),
+                std::make_move_iterator(mod.extra_bsa_suffixes.begin()),
+                std::make_move_iterator(mod.extra_bsa_suffixes.end()));
+    }
+}
+
+int scanDataDir(const char *path, ModRegistry &mod_list, size_t *file_count, size_t worker_count) {
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return -1;
+    }
+
+    if (worker_count == 0) {
+        worker_count = std::thread::hardware_concurrency();
+        if (worker_count == 0) {
+            worker_count = SCAN_DEFAULT_WORKERS;
+        }
+        worker_count = std::min(worker_count, (size_t) SCAN_MAX_WORKERS);
+    }
+
+    BatchQueue queue;
+    std::vector<PartialModMap> partials(worker_count);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < worker_count; i++) {
+        workers.insert(workers.end(), std::thread(runWorker, std::ref(queue), std::ref(partials[i])));
+    }
+
+    // this thread streams the directory listing into the queue while the workers classify it
+    size_t seq = 0;
+    ScanBatch batch = {0, 0, ""};
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        if (!isRegularFile(path, ent)) {
+            continue;
+        }
+
+        batch.names.append(ent->d_name);
+        batch.names.push_back('\0');
+        batch.count++;
+        seq++;
+
+        if (batch.count == SCAN_BATCH_SIZE) {
+            queue.push(std::move(batch));
+            batch = {seq, 0, ""};
+        }
+    }
+
+    closedir(dir);
+
+    if (batch.count > 0) {
+        queue.push(std::move(batch));
+    }
+    queue.close();
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    if (file_count) {
+        *file_count = seq;
+    }
+
+    PartialModMap merged = std::move(partials[0]);
+    for (size_t i = 1; i < partials.size(); i++) {
+        mergePartial(merged, partials[i]);
+    }
+
+    // restore listing order so the result doesn't depend on how the work was scheduled
+    std::vector<PartialMod *> ordered;
+    ordered.reserve(merged.size());
+    for (auto &entry : merged) {
+        ordered.insert(ordered.end(), &entry.second);
+    }
+    std::sort(ordered.begin(), ordered.end(), [](PartialMod *a, PartialMod *b) {
+        return a->first_seq < b->first_seq;
+    });
+
+    for (PartialMod *partial : ordered) {
+        SkyrimMod mod = mod_list.find(partial->base_name);
+        if (!mod) {
+            mod = mod_list.create(partial->base_name);
+        }
+
+        mod.setHasEsp(mod.hasEsp() || partial->has_esp);
+        mod.setMaster(mod.isMaster() || partial->is_master);
+        mod.editBsaState().present |= partial->bsa_mask;
+        for (std::string const &suffix : partial->extra_bsa_suffixes) {
+            mod.addBsa(suffix);
+        }
+    }
+
+    return 0;
+}
+
+static bool reconcileMod(SkyrimMod const &mod, SkyrimMod const &scanned) {
+    bool changed = mod.isMissing()
+            || mod.hasEsp() != scanned.hasEsp()
+            || mod.isMaster() != scanned.isMaster();
+
+    mod.setMissing(false);
+    mod.setHasEsp(scanned.hasEsp());
+    mod.setMaster(scanned.isMaster());
+    if (!mod.hasEsp()) {
+        mod.setEspEnabled(false);
+    }
+
+    changed |= mod.reconcileBsas(scanned);
+
+    return changed;
+}
+
+int rescanDataDir(const char *path, ModRegistry &mod_list, RescanResult *result) {
+    // the scan gets a store of its own so it doesn't leave stray mods in the list's store
+    ModStore scan_store;
+    ModRegistry scanned(scan_store);
+    size_t file_count;
+    if (scanDataDir(path, scanned, &file_count) != 0) {
+        return -1;
+    }
+
+    *result = {0, 0, 0};
+
+    // both directions of the diff are hash lookups, so this stays linear in the number of mods
+    for (SkyrimMod mod : mod_list) {
+        if (mod.isMissing() || scanned.indexOf(mod.getBaseName()) >= 0) {
+            continue;
+        }
+
+        mod.setMissing(true);
+        mod.setHasEsp(false);
+        mod.setMaster(false);
+        mod.setEspEnabled(false);
+        mod.clearBsas();
+        result->missing_mods++;
+    }
+
+    for (SkyrimMod scanned_mod : scanned) {
+        SkyrimMod mod = mod_list.find(scanned_mod.getBaseName());
+        if (!mod) {
+            mod_list.create(scanned_mod.getBaseName()).assign(scanned_mod);
+            result->added_mods++;
+        } else if (reconcileMod(mod, scanned_mod)) {
+            result->changed_mods++;
+        }
+    }
+
+    return 0;
+}
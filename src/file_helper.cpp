@@ -0,0 +1,143 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "file_helper.hpp"
+
+#include "phase_timer.hpp"
+
+#include <cstdio>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TEMP_FILE_SUFFIX ".tmp"
+
+int statFile(const char *path, FileStamp *stamp) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+
+    stamp->mtime = (int64_t) st.st_mtime;
+    stamp->size = S_ISDIR(st.st_mode) ? 0 : (int64_t) st.st_size;
+    return 0;
+}
+
+// Reads the entire file into out with a single read call.
+int readFileUntracked(const char *path, std::string &out) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0) {
+        fclose(file);
+        return -1;
+    }
+
+    out.resize(st.st_size);
+    size_t read = st.st_size > 0 ? fread(&out[0], 1, st.st_size, file) : 0;
+    fclose(file);
+
+    if (read != (size_t) st.st_size) {
+        out.clear();
+        return -1;
+    }
+
+    return 0;
+}
+
+int readFile(const char *path, std::string &out) {
+    if (readFileUntracked(path, out) != 0) {
+        return -1;
+    }
+
+    phaseAddFiles(1);
+    phaseAddBytes(out.size());
+    return 0;
+}
+
+int readFileRangeUntracked(const char *path, uint64_t offset, size_t size, std::string &out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    out.resize(size);
+    ssize_t read = size > 0 ? pread(fd, &out[0], size, (off_t) offset) : 0;
+    close(fd);
+
+    if (read < 0) {
+        out.clear();
+        return -1;
+    }
+
+    out.resize(read);
+    return 0;
+}
+
+// Writes the file by way of a temporary sibling which is renamed over the
+// original once it has been fully written and synced, so an interrupted write
+// never leaves a truncated file behind.
+int writeFileAtomicUntracked(const char *path, std::string const &data) {
+    std::string temp_path = std::string(path) + TEMP_FILE_SUFFIX;
+
+    FILE *file = fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        return -1;
+    }
+
+    size_t written = fwrite(data.data(), 1, data.size(), file);
+    bool flushed = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    fclose(file);
+
+    if (written != data.size() || !flushed) {
+        remove(temp_path.c_str());
+        return -1;
+    }
+
+    if (rename(temp_path.c_str(), path) != 0) {
+        // some filesystems refuse to rename over an existing file
+        remove(path);
+        if (rename(temp_path.c_str(), path) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int writeFileAtomic(const char *path, std::string const &data) {
+    if (writeFileAtomicUntracked(path, data) != 0) {
+        return -1;
+    }
+
+    phaseAddFiles(1);
+    phaseAddBytes(data.size());
+    return 0;
+}
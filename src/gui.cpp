@@ -31,12 +31,16 @@
 #define MAX(a, b) ((a > b) ? a : b)
 #define CLAMP(n, l, h) (MIN(MAX(n, l), h))
 
+#define STYLE_FG(fg) (ConsoleStyle {fg, CONSOLE_COLOR_BG_BLACK, CONSOLE_ATTR_BOLD})
+#define STYLE_PLAIN STYLE_FG(CONSOLE_COLOR_FG_WHITE)
+#define STYLE_HIGHLIGHT (ConsoleStyle {CONSOLE_COLOR_FG_BLACK, CONSOLE_COLOR_BG_WHITE, CONSOLE_ATTR_NONE})
+
 size_t ModGui::getSelectedIndex(void) {
     return selected_row;
 }
 
-std::shared_ptr<SkyrimMod> ModGui::getSelectedMod(void) {
-    return *(mod_list.cbegin() + selected_row);
+SkyrimMod ModGui::getSelectedMod(void) {
+    return mod_list.at(selected_row);
 }
 
 void ModGui::scrollSelection(int delta) {
@@ -63,15 +67,70 @@ void ModGui::scrollSelection(int delta) {
         redrawRow(listToGuiSpace(old_selection));
         redrawRow(listToGuiSpace(new_selection));
     } else {
+        // let the renderer reuse the rows which are still visible
+        renderer.shiftRows(guiToScreenSpace(0), guiToScreenSpace(display_rows - 1), (int) (new_scroll - scroll));
+
         selected_row = new_selection;
         scroll = new_scroll;
         redraw();
     }
 }
 
+// Moves the selected mod by `delta` places in the load order, keeping it
+// selected. Returns whether the load order changed.
+bool ModGui::moveSelection(int delta) {
+    if (delta == 0 || mod_list.empty()) {
+        return false;
+    }
+
+    return moveSelectionTo(CLAMP((ssize_t) (selected_row + delta), 0, (ssize_t) (mod_list.size() - 1)));
+}
+
+bool ModGui::moveSelectionTo(size_t target) {
+    if (target >= mod_list.size() || target == selected_row) {
+        return false;
+    }
+
+    mod_list.move(selected_row, target);
+
+    if (target + 1 == selected_row || selected_row + 1 == target) {
+        // only the two swapped rows changed
+        scrollSelection((int) ((ssize_t) target - (ssize_t) selected_row));
+        return true;
+    }
+
+    selected_row = target;
+    if (selected_row < scroll) {
+        scroll = selected_row;
+    } else if (selected_row >= scroll + display_rows) {
+        scroll = selected_row - (display_rows - 1);
+    }
+    redraw();
+
+    return true;
+}
+
+void ModGui::selectIndex(size_t index) {
+    if (mod_list.empty()) {
+        return;
+    }
+
+    selected_row = MIN(index, mod_list.size() - 1);
+    if (selected_row < scroll) {
+        scroll = selected_row;
+    } else if (selected_row >= scroll + display_rows) {
+        scroll = selected_row - (display_rows - 1);
+    }
+    redraw();
+}
+
 void ModGui::redraw(void) {
-    for (size_t y = 0; y < MIN(display_rows, mod_list.size()); y++) {
-        redrawRow(y);
+    for (size_t y = 0; y < display_rows; y++) {
+        if (guiToListSpace(y) < mod_list.size()) {
+            redrawRow(y);
+        } else {
+            renderer.clearRow(guiToScreenSpace(y));
+        }
     }
 }
 
@@ -83,58 +142,44 @@ void ModGui::redrawRow(size_t gui_y) {
     size_t screen_y = guiToScreenSpace(gui_y);
     size_t list_index = guiToListSpace(gui_y);
 
-    if (list_index < 0 || list_index >= mod_list.size()) {
+    if (list_index >= mod_list.size()) {
         PANIC();
     }
 
-    std::shared_ptr<SkyrimMod> cur_mod = mod_list.at(list_index);
+    SkyrimMod cur_mod = mod_list.at(list_index);
 
     bool highlighted = selected_row == list_index;
 
-    CONSOLE_SET_POS(0, 0);
-    for (size_t i = 0; i < screen_y; i++) {
-        CONSOLE_MOVE_DOWN(1);
-    }
-    CONSOLE_CLEAR_LINE();
-
-    CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_WHITE);
-    printf("[");
-
-    ModStatus mod_status = cur_mod->getStatus();
-    switch (mod_status) {
-        case ModStatus::ENABLED:
-            CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_GREEN);
-            printf("*");
-            break;
-        case ModStatus::PARTIAL:
-            CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_YELLOW);
-            printf("*");
-            break;
-        case ModStatus::DISABLED:
-            printf(" ");
-            break;
-        default:
-            PANIC();
-    }
+    renderer.clearRow(screen_y);
 
-    CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_WHITE);
-    printf("] ");
+    size_t x = renderer.putText(screen_y, 0, "[", STYLE_PLAIN);
 
-    if (highlighted) {
-        CONSOLE_SET_ATTRS(CONSOLE_ATTR_NONE);
-        CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_BLACK);
-        CONSOLE_SET_COLOR(CONSOLE_COLOR_BG_WHITE);
+    if (cur_mod.isMissing()) {
+        x = renderer.putText(screen_y, x, "!", STYLE_FG(CONSOLE_COLOR_FG_RED));
     } else {
-        CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_WHITE);
-        CONSOLE_SET_COLOR(CONSOLE_COLOR_BG_BLACK);
+        ModStatus mod_status = cur_mod.getStatus();
+        switch (mod_status) {
+            case ModStatus::ENABLED:
+                x = renderer.putText(screen_y, x, "*", STYLE_FG(CONSOLE_COLOR_FG_GREEN));
+                break;
+            case ModStatus::PARTIAL:
+                x = renderer.putText(screen_y, x, "*", STYLE_FG(CONSOLE_COLOR_FG_YELLOW));
+                break;
+            case ModStatus::DISABLED:
+                x = renderer.putText(screen_y, x, " ", STYLE_PLAIN);
+                break;
+            default:
+                PANIC();
+        }
     }
 
-    printf(cur_mod->base_name.c_str());
-    printf("\n");
+    x = renderer.putText(screen_y, x, "] ", STYLE_PLAIN);
+
+    x = renderer.putText(screen_y, x, cur_mod.getBaseName(), highlighted ? STYLE_HIGHLIGHT : STYLE_PLAIN);
 
-    CONSOLE_SET_ATTRS(CONSOLE_ATTR_BOLD);
-    CONSOLE_SET_COLOR(CONSOLE_COLOR_BG_BLACK);
-    CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_WHITE);
+    if (linter != NULL && linter->getIssues(cur_mod.getId()) != 0) {
+        renderer.putText(screen_y, x, " !", STYLE_FG(CONSOLE_COLOR_FG_YELLOW));
+    }
 }
 
 void ModGui::redrawCurrentRow(void) {
@@ -0,0 +1,249 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "file_helper.hpp"
+#include "ini_file.hpp"
+
+#include <string>
+#include <string_view>
+
+#include <cctype>
+#include <cstring>
+
+#define INI_COMMENT_CHAR ';'
+#define INI_COMMENT_CHAR_ALT '#'
+
+static inline bool isBlank(char ch) {
+    return std::isspace((unsigned char) ch);
+}
+
+IniFile::IniFile(void):
+        data(),
+        sections(),
+        entries(),
+        newline("\n") {
+    index();
+}
+
+int IniFile::load(const char *path) {
+    std::string new_data;
+    if (readFile(path, new_data) != 0) {
+        return -1;
+    }
+
+    parse(std::move(new_data));
+    return 0;
+}
+
+void IniFile::parse(std::string &&new_data) {
+    data = std::move(new_data);
+    index();
+}
+
+void IniFile::clear(void) {
+    data.clear();
+    index();
+}
+
+// A single pass over the bytes, recording offsets rather than copying anything out.
+void IniFile::index(void) {
+    sections.clear();
+    entries.clear();
+    sections.insert(sections.end(), {0, 0, 0});
+
+    const char *base = data.data();
+    size_t size = data.size();
+
+    const char *first_newline = (const char *) memchr(base, '\n', size);
+    newline = (first_newline && first_newline > base && first_newline[-1] == '\r') ? "\r\n" : "\n";
+
+    size_t section = 0;
+    size_t line_start = 0;
+    while (line_start < size) {
+        const char *line_end_ptr = (const char *) memchr(base + line_start, '\n', size - line_start);
+        size_t line_end = line_end_ptr ? line_end_ptr - base : size;
+        size_t next_start = line_end_ptr ? line_end + 1 : size;
+
+        size_t start = line_start;
+        size_t end = line_end;
+        while (start < end && isBlank(base[start])) {
+            start++;
+        }
+        while (end > start && isBlank(base[end - 1])) {
+            end--;
+        }
+        line_start = next_start;
+
+        if (start == end || base[start] == INI_COMMENT_CHAR || base[start] == INI_COMMENT_CHAR_ALT) {
+            continue;
+        }
+
+        if (base[start] == '[') {
+            if (base[end - 1] != ']' || end - start < 2) {
+                continue;
+            }
+
+            // a repeated header continues the earlier section rather than starting a new one
+            ssize_t existing = findSection(std::string_view(base + start + 1, end - start - 2));
+            if (existing >= 0) {
+                section = existing;
+            } else {
+                section = sections.size();
+                sections.insert(sections.end(), {start + 1, end - start - 2, next_start});
+            }
+            continue;
+        }
+
+        const char *assign = (const char *) memchr(base + start, '=', end - start);
+        if (!assign) {
+            continue;
+        }
+
+        size_t key_end = assign - base;
+        size_t value_start = key_end + 1;
+        while (key_end > start && isBlank(base[key_end - 1])) {
+            key_end--;
+        }
+        while (value_start < end && isBlank(base[value_start])) {
+            value_start++;
+        }
+
+        std::string_view key(base + start, key_end - start);
+        if (findEntry(section, key) < 0) {
+            entries.insert(entries.end(), {section, start, key_end - start, value_start, end - value_start});
+        }
+        sections[section].insert_off = next_start;
+    }
+}
+
+ssize_t IniFile::findSection(std::string_view name) const {
+    for (size_t i = 0; i < sections.size(); i++) {
+        if (std::string_view(data.data() + sections[i].name_off, sections[i].name_len) == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ssize_t IniFile::findEntry(size_t section, std::string_view key) const {
+    for (size_t i = 0; i < entries.size(); i++) {
+        Entry const &entry = entries[i];
+        if (entry.section == section && std::string_view(data.data() + entry.key_off, entry.key_len) == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void IniFile::shiftOffsets(size_t pos, ssize_t delta) {
+    for (Section &section : sections) {
+        if (section.name_off >= pos) {
+            section.name_off += delta;
+        }
+        if (section.insert_off >= pos) {
+            section.insert_off += delta;
+        }
+    }
+    for (Entry &entry : entries) {
+        if (entry.key_off >= pos) {
+            entry.key_off += delta;
+        }
+        if (entry.value_off >= pos) {
+            entry.value_off += delta;
+        }
+    }
+}
+
+std::string_view IniFile::get(std::string_view section, std::string_view key) const {
+    ssize_t section_index = findSection(section);
+    if (section_index < 0) {
+        return std::string_view();
+    }
+
+    ssize_t entry_index = findEntry(section_index, key);
+    if (entry_index < 0) {
+        return std::string_view();
+    }
+
+    Entry const &entry = entries[entry_index];
+    return std::string_view(data.data() + entry.value_off, entry.value_len);
+}
+
+void IniFile::set(std::string_view section, std::string_view key, std::string_view value) {
+    ssize_t section_index = findSection(section);
+    if (section_index < 0) {
+        // a file not ending in a newline needs one before the new header
+        std::string header;
+        if (!data.empty() && data.back() != '\n') {
+            header += newline;
+        }
+        header += '[';
+        header += section;
+        header += ']';
+        header += newline;
+
+        size_t name_off = data.size() + header.size() - strlen(newline) - section.size() - 1;
+        data += header;
+        section_index = sections.size();
+        sections.insert(sections.end(), {name_off, section.size(), data.size()});
+    }
+
+    ssize_t entry_index = findEntry(section_index, key);
+    if (entry_index >= 0) {
+        Entry &entry = entries[entry_index];
+        size_t value_off = entry.value_off;
+        size_t value_end = value_off + entry.value_len;
+        data.replace(value_off, entry.value_len, value);
+        shiftOffsets(value_end, (ssize_t) value.size() - (ssize_t) entry.value_len);
+        // an empty value starts where it ends, so the shift moved it along with what follows
+        entry.value_off = value_off;
+        entry.value_len = value.size();
+        return;
+    }
+
+    size_t insert_off = sections[section_index].insert_off;
+    std::string line;
+    if (insert_off > 0 && data[insert_off - 1] != '\n') {
+        // the section's last line is also the file's last, without a newline
+        line += newline;
+    }
+    size_t key_off = insert_off + line.size();
+    line += key;
+    line += '=';
+    size_t value_off = insert_off + line.size();
+    line += value;
+    line += newline;
+
+    data.insert(insert_off, line);
+    shiftOffsets(insert_off, line.size());
+    // an empty value on the last line ends where the new line goes, so it stays put
+    for (Entry &entry : entries) {
+        if (entry.value_len == 0 && entry.value_off == insert_off + line.size()) {
+            entry.value_off = insert_off;
+        }
+    }
+    sections[section_index].insert_off = insert_off + line.size();
+    entries.insert(entries.end(), {(size_t) section_index, key_off, key.size(), value_off, value.size()});
+}
@@ -24,24 +24,45 @@
  */
 
 #include "error_defs.hpp"
+#include "file_helper.hpp"
 #include "ini_helper.hpp"
 #include "mod.hpp"
 #include "path_helper.hpp"
+#include "phase_timer.hpp"
 #include "string_helper.hpp"
+#include "task_pool.hpp"
 
-#include <inipp/inipp.h>
 #include <switch.h>
 
 #include <algorithm>
-#include <fstream>
 #include <memory>
-
-static const std::vector<std::string> g_archive_types_1 = {"", "Animations", "Meshes", "Sounds"};
-static const std::vector<std::string> g_archive_types_2 = {"Textures", "Voices"};
-static const std::vector<std::string> g_archive_types_3 = {"Animations"};
-
-static StdIni g_skyrim_ini;
-static StdIni g_skyrim_lang_ini;
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Archive kinds which belong in each list, as BSA_BIT()s. The first list also
+// takes anything unknown, since its empty suffix matches every archive.
+#define ARCHIVE_TYPES_1 ((uint8_t) (BSA_BIT(BsaSuffix::OTHER) | (BSA_BIT(BsaSuffix::OTHER) - 1)))
+#define ARCHIVE_TYPES_2 (BSA_BIT(BsaSuffix::TEXTURES) | BSA_BIT(BsaSuffix::VOICES))
+#define ARCHIVE_TYPES_3 BSA_BIT(BsaSuffix::ANIMATIONS)
+
+static IniFile g_skyrim_ini;
+static IniFile g_skyrim_lang_ini;
+static bool g_inis_loaded = false;
+
+static std::string g_skyrim_ini_path;
+static std::string g_skyrim_lang_ini_path;
+// set once reads of both INIs have been queued by prefetchInis(), whose results
+// are picked up by the next loadInis()
+static bool g_inis_prefetched = false;
+static int g_skyrim_ini_read_rc = 0;
+static int g_skyrim_lang_ini_read_rc = 0;
+
+// hashes of the mod-managed archive lists as of the last load or save
+static uint64_t g_skyrim_ini_hash = 0;
+static uint64_t g_skyrim_lang_ini_hash = 0;
+
+#define INI_LIST_SEPARATOR_SEED 0x9E3779B97F4A7C15ull
 
 static inline const char *get_language_code(SetLanguage &lang) {
     switch (lang) {
@@ -84,15 +105,8 @@ static inline const char *get_language_code(SetLanguage &lang) {
     }
 }
 
-static std::string getString(StdIni &ini, std::string section, std::string key) {
-    auto sec = ini.sections.find(section);
-    if (sec != ini.sections.cend()) {
-        auto val_it = sec->second.find(key);
-        if (val_it != sec->second.cend()) {
-            return val_it->second;
-        }
-    }
-    return "";
+static inline std::string getString(IniFile &ini, const char *section, const char *key) {
+    return std::string(ini.get(section, key));
 }
 
 static int getLanguage(SetLanguage *lang) {
@@ -104,30 +118,27 @@ static int getLanguage(SetLanguage *lang) {
     return 0;
 }
 
-int readIniFile(std::string &path, StdIni &ini) {
-    std::ifstream ini_stream = std::ifstream(path, std::ios::in);
-    if (!ini_stream.good()) {
+int readIniFile(std::string &path, IniFile &ini) {
+    if (RC_FAILURE(ini.load(path.c_str()))) {
         FATAL("Failed to read file at %s", path.c_str());
         return -1;
     }
 
-    ini.parse(ini_stream);
-
     return 0;
 }
 
-int readIniFile(const char *path, StdIni &ini) {
+int readIniFile(const char *path, IniFile &ini) {
     std::string path_str = std::string(path);
     return readIniFile(path_str, ini);
 }
 
-int processIniDefs(ModList &final_mod_list, ModList &temp_mod_list, StdIni &ini, const char *key,
-        const std::vector<std::string> &expected_suffixes) {
+int processIniDefs(ModRegistry &final_mod_list, ModRegistry &temp_mod_list, IniFile &ini, const char *key,
+        uint8_t expected_types) {
     std::string archive_list_str = getString(ini, INI_SECTION_ARCHIVE, key);
     std::vector<std::string> archive_list = split(archive_list_str, ",");
     
-    for (std::string archive_file : archive_list) {
-        ModFile mod_file = ModFile::fromFileName(archive_file);
+    for (std::string const &archive_file : archive_list) {
+        ModFileView mod_file = ModFileView::classify(archive_file);
         if (mod_file.type != ModFileType::BSA) {
             continue;
         }
@@ -136,35 +147,27 @@ int processIniDefs(ModList &final_mod_list, ModList &temp_mod_list, StdIni &ini,
             continue;
         }
 
-        bool good_suffix = false;
-        for (std::string expected_suffix : expected_suffixes) {
-            if (mod_file.suffix.find_last_of(expected_suffix, expected_suffix.size())) {
-                good_suffix = true;
-                break;
-            }
-        }
-        if (!good_suffix) {
+        if (!(BSA_BIT(classifyBsaSuffix(mod_file.suffix)) & expected_types)) {
             continue;
         }
 
-        std::shared_ptr<SkyrimMod> mod = find_mod(final_mod_list, mod_file.base_name);
+        SkyrimMod mod = final_mod_list.find(mod_file.base_name);
         if (!mod) {
-            mod = find_mod(temp_mod_list, mod_file.base_name);
+            mod = temp_mod_list.find(mod_file.base_name);
             if (mod) {
-                final_mod_list.insert(final_mod_list.end(), mod);
+                final_mod_list.append(mod);
             } else {
                 continue;
             }
         }
 
-        mod->enabled_bsas[mod_file.suffix] += 1;
+        mod.registerBsa(mod_file.suffix);
     }
 
     return 0;
 }
 
-int parseInis(ModList &final_mod_list, ModList &temp_mod_list) {
-    int rc;
+int getLangIniPath(std::string &path) {
     SetLanguage lang;
     if (RC_FAILURE(getLanguage(&lang))) {
         return -1;
@@ -172,92 +175,301 @@ int parseInis(ModList &final_mod_list, ModList &temp_mod_list) {
     const char *skyrim_lang_code = get_language_code(lang);
 
     std::string ini_lang_base = std::string(SKYRIM_INI_LANG_FILE_PREFIX) + skyrim_lang_code + ".ini";
-    std::string ini_lang_file = getRomfsPath(ini_lang_base);
+    path = getRomfsPath(ini_lang_base);
+    return 0;
+}
+
+// Parses the INI at path into ini without touching the console or phase
+// timing, so it can run on a worker thread.
+static int readIniUntracked(std::string const &path, IniFile &ini) {
+    std::string data;
+    if (RC_FAILURE(readFileUntracked(path.c_str(), data))) {
+        return -1;
+    }
 
-    DO_OR_DIE(rc, readIniFile(getRomfsPath(SKYRIM_INI_FILE).c_str(), g_skyrim_ini), "Failed to read Skyrim.ini");
-    DO_OR_DIE(rc, readIniFile(ini_lang_file, g_skyrim_lang_ini), "Failed to read Skyrim_%s.ini", skyrim_lang_code);
+    ini.parse(std::move(data));
+    return 0;
+}
 
-    processIniDefs(final_mod_list, temp_mod_list, g_skyrim_ini, INI_ARCHIVE_LIST_1, g_archive_types_1);
-    processIniDefs(final_mod_list, temp_mod_list, g_skyrim_ini, INI_ARCHIVE_LIST_3, g_archive_types_3);
-    processIniDefs(final_mod_list, temp_mod_list, g_skyrim_lang_ini, INI_ARCHIVE_LIST_2, g_archive_types_2);
+// Reports the outcome of an INI read on the main thread.
+static int finishIniRead(std::string const &path, IniFile &ini, int read_rc) {
+    if (RC_FAILURE(read_rc)) {
+        FATAL("Failed to read file at %s", path.c_str());
+        return -1;
+    }
 
+    phaseAddFiles(1);
+    phaseAddBytes(ini.getData().size());
     return 0;
 }
 
-static int writeFileList(const char *path, StdIni &ini, std::string key,
-        std::vector<std::string> const &expected_suffixes) {
-    std::vector<ModFile> file_list;
+static int setIniPaths(void) {
+    if (RC_FAILURE(getLangIniPath(g_skyrim_lang_ini_path))) {
+        return -1;
+    }
+    g_skyrim_ini_path = getRomfsPath(SKYRIM_INI_FILE);
+    return 0;
+}
 
-    std::string archive_list_str = getString(ini, INI_SECTION_ARCHIVE, key);
-    std::vector<std::string> archive_list = split(archive_list_str, ",");
-    std::vector<ModFile> cur_file_list;
-    std::transform(archive_list.cbegin(), archive_list.cend(), std::back_inserter(cur_file_list), ModFile::fromFileName);
+int prefetchInis(TaskPool &pool) {
+    if (g_inis_loaded || g_inis_prefetched) {
+        return 0;
+    }
+
+    if (RC_FAILURE(setIniPaths())) {
+        return -1;
+    }
+
+    pool.submit([]() {
+        g_skyrim_ini_read_rc = readIniUntracked(g_skyrim_ini_path, g_skyrim_ini);
+    });
+    pool.submit([]() {
+        g_skyrim_lang_ini_read_rc = readIniUntracked(g_skyrim_lang_ini_path, g_skyrim_lang_ini);
+    });
+
+    g_inis_prefetched = true;
+    return 0;
+}
+
+static int loadInis(void) {
+    int rc;
+    if (g_inis_loaded) {
+        return 0;
+    }
+
+    if (!g_inis_prefetched) {
+        if (RC_FAILURE(setIniPaths())) {
+            return -1;
+        }
+
+        g_skyrim_ini_read_rc = readIniUntracked(g_skyrim_ini_path, g_skyrim_ini);
+        g_skyrim_lang_ini_read_rc = readIniUntracked(g_skyrim_lang_ini_path, g_skyrim_lang_ini);
+    }
+    g_inis_prefetched = false;
+
+    DO_OR_DIE(rc, finishIniRead(g_skyrim_ini_path, g_skyrim_ini, g_skyrim_ini_read_rc),
+            "Failed to read Skyrim.ini");
+    DO_OR_DIE(rc, finishIniRead(g_skyrim_lang_ini_path, g_skyrim_lang_ini, g_skyrim_lang_ini_read_rc),
+            "Failed to read %s", g_skyrim_lang_ini_path.c_str());
+
+    g_inis_loaded = true;
+    return 0;
+}
+
+int parseInis(ModRegistry &final_mod_list, ModRegistry &temp_mod_list) {
+    if (RC_FAILURE(loadInis())) {
+        return -1;
+    }
+
+    processIniDefs(final_mod_list, temp_mod_list, g_skyrim_ini, INI_ARCHIVE_LIST_1, ARCHIVE_TYPES_1);
+    processIniDefs(final_mod_list, temp_mod_list, g_skyrim_ini, INI_ARCHIVE_LIST_3, ARCHIVE_TYPES_3);
+    processIniDefs(final_mod_list, temp_mod_list, g_skyrim_lang_ini, INI_ARCHIVE_LIST_2, ARCHIVE_TYPES_2);
+
+    return 0;
+}
+
+static void appendArchive(std::string &list, std::string_view base_name, std::string_view suffix) {
+    if (!list.empty()) {
+        list += ", ";
+    }
+    list += base_name;
+    if (!suffix.empty()) {
+        list += " - ";
+        list += suffix;
+    }
+    list += ".bsa";
+}
 
-    for (ModFile file : cur_file_list) {
+// Seeds an archive list with the vanilla archives from the existing value, which
+// always load first and aren't managed by us.
+static std::string getBaseArchiveList(IniFile &ini, const char *key) {
+    std::string out_list;
+    for (std::string const &archive_file : split(getString(ini, INI_SECTION_ARCHIVE, key), ",")) {
+        ModFileView file = ModFileView::classify(archive_file);
         if (file.base_name == "Skyrim") {
-            file_list.insert(file_list.end(), file);
+            appendArchive(out_list, file.base_name, file.suffix);
         }
     }
+    return out_list;
+}
 
-    for (std::shared_ptr<SkyrimMod> mod : getGlobalModList()) {
-        for (std::pair<std::string, int> suffix_pair : mod->enabled_bsas) {
-            for (std::string expected_suffix : expected_suffixes) {
-                if (suffix_pair.first.find(expected_suffix) == 0) {
-                    file_list.insert(file_list.end(), {mod->is_master ? ModFileType::ESM : ModFileType::ESP, mod->base_name, suffix_pair.first});
-                    break;
+static std::string joinArchiveLists(std::string const &base_list, std::string const &mod_list) {
+    if (base_list.empty() || mod_list.empty()) {
+        return base_list + mod_list;
+    }
+    return base_list + ", " + mod_list;
+}
+
+static void appendToArchiveLists(std::string &list_1, std::string &list_2, std::string &list_3,
+        std::string_view base_name, std::string_view suffix, BsaSuffix kind) {
+    uint8_t bit = BSA_BIT(kind);
+    if (bit & ARCHIVE_TYPES_1) {
+        appendArchive(list_1, base_name, suffix);
+    }
+    if (bit & ARCHIVE_TYPES_2) {
+        appendArchive(list_2, base_name, suffix);
+    }
+    if (bit & ARCHIVE_TYPES_3) {
+        appendArchive(list_3, base_name, suffix);
+    }
+}
+
+// Builds the mod-managed portion of all three archive lists in a single pass
+// over the load order. Each mod's archives go in suffix order, with any unknown
+// suffixes merged in among the known ones.
+static void buildArchiveLists(ModRegistry const &mod_list, std::string &list_1, std::string &list_2,
+        std::string &list_3) {
+    for (SkyrimMod mod : mod_list) {
+        std::string_view base_name = mod.getBaseName();
+        uint8_t enabled = mod.getBsaState().enabled;
+        std::vector<ExtraBsa> const *extras = mod.getExtraBsas();
+        size_t extra_count = extras ? extras->size() : 0;
+        size_t extra_index = 0;
+
+        for (uint8_t i = 0; i < BSA_SUFFIX_COUNT; i++) {
+            BsaSuffix kind = (BsaSuffix) i;
+            std::string_view suffix = getBsaSuffixName(kind);
+            for (; extra_index < extra_count && (*extras)[extra_index].suffix < suffix; extra_index++) {
+                ExtraBsa const &extra = (*extras)[extra_index];
+                if (extra.enabled_count > 0) {
+                    appendToArchiveLists(list_1, list_2, list_3, base_name, extra.suffix, extra.kind);
                 }
             }
-        }
-    }
 
-    std::stringstream ss;
-    for (auto mf_it = file_list.cbegin(); mf_it != file_list.cend(); mf_it++) {
-        ss << mf_it->base_name;
-        if (!mf_it->suffix.empty()) {
-            ss << " - " << mf_it->suffix;
+            if (enabled & BSA_BIT(kind)) {
+                appendToArchiveLists(list_1, list_2, list_3, base_name, suffix, kind);
+            }
         }
-        ss << ".bsa";
 
-        if (mf_it != file_list.cend() - 1) {
-            ss << ", ";
+        for (; extra_index < extra_count; extra_index++) {
+            ExtraBsa const &extra = (*extras)[extra_index];
+            if (extra.enabled_count > 0) {
+                appendToArchiveLists(list_1, list_2, list_3, base_name, extra.suffix, extra.kind);
+            }
         }
     }
+}
 
-    std::string out_list_str = ss.str();
+static inline uint64_t hashSkyrimIniLists(std::string const &list_1, std::string const &list_3) {
+    return hashBytes(list_3, hashBytes(list_1) ^ INI_LIST_SEPARATOR_SEED);
+}
 
-    auto sec_it = ini.sections.find(INI_SECTION_ARCHIVE);
-    std::map<std::string, std::string> sec_map;
-    if (sec_it != ini.sections.cend()) {
-        sec_map = sec_it->second;
-    }
+void captureIniBaseline(void) {
+    std::string list_1;
+    std::string list_2;
+    std::string list_3;
+    buildArchiveLists(getGlobalModList(), list_1, list_2, list_3);
 
-    sec_map.insert_or_assign(key, out_list_str);
+    g_skyrim_ini_hash = hashSkyrimIniLists(list_1, list_3);
+    g_skyrim_lang_ini_hash = hashBytes(list_2);
+}
 
-    ini.sections.insert_or_assign(INI_SECTION_ARCHIVE, sec_map);
+void resetInis(void) {
+    g_skyrim_ini.clear();
+    g_skyrim_lang_ini.clear();
+    g_inis_loaded = false;
+    g_inis_prefetched = false;
+    g_skyrim_ini_path.clear();
+    g_skyrim_lang_ini_path.clear();
+    g_skyrim_ini_hash = 0;
+    g_skyrim_lang_ini_hash = 0;
+}
 
-    std::ofstream ini_stream(path, std::ios::out | std::ios::trunc | std::ios::binary);
-    if (!ini_stream.good()) {
-        FATAL("Failed to open %s", path);
+int prepareIniSave(void) {
+    if (!g_skyrim_ini_path.empty()) {
+        return 0;
+    }
+    return setIniPaths();
+}
+
+// Writes the INI's bytes out as they are, which apart from the archive lists
+// spliced in by the caller are those that were read.
+static int saveIni(std::string const &path, IniFile &ini, size_t *bytes_written, FileError *error) {
+    std::string const &data = ini.getData();
+
+    if (RC_FAILURE(writeFileAtomicUntracked(path.c_str(), data))) {
+        *error = {"write", path};
         return -1;
     }
 
-    ini.generate(ini_stream);
+    *bytes_written += data.size();
     return 0;
 }
 
-int writeIniChanges(void) {
-    SetLanguage lang;
-    if (RC_FAILURE(getLanguage(&lang))) {
-        return -1;
+int saveIniChanges(ModRegistry const &mod_list, size_t *bytes_written, int *files_written, FileError *error) {
+    *bytes_written = 0;
+    *files_written = 0;
+
+    std::string list_1;
+    std::string list_2;
+    std::string list_3;
+    buildArchiveLists(mod_list, list_1, list_2, list_3);
+
+    // the rest of each INI is passed through untouched, so only the managed lists can make it differ
+    uint64_t skyrim_ini_hash = hashSkyrimIniLists(list_1, list_3);
+    uint64_t skyrim_lang_ini_hash = hashBytes(list_2);
+    bool write_skyrim_ini = skyrim_ini_hash != g_skyrim_ini_hash;
+    bool write_skyrim_lang_ini = skyrim_lang_ini_hash != g_skyrim_lang_ini_hash;
+
+    if (!write_skyrim_ini && !write_skyrim_lang_ini) {
+        return 0;
     }
-    const char *skyrim_lang_code = get_language_code(lang);
 
-    std::string ini_lang_base = std::string(SKYRIM_INI_LANG_FILE_PREFIX) + skyrim_lang_code + ".ini";
-    std::string ini_lang_file = getRomfsPath(ini_lang_base);
+    // the INIs aren't parsed up front when the mod list comes from the scan cache
+    if (!g_inis_loaded) {
+        if (RC_FAILURE(readIniUntracked(g_skyrim_ini_path, g_skyrim_ini))) {
+            *error = {"read", g_skyrim_ini_path};
+            return -1;
+        }
+        if (RC_FAILURE(readIniUntracked(g_skyrim_lang_ini_path, g_skyrim_lang_ini))) {
+            *error = {"read", g_skyrim_lang_ini_path};
+            return -1;
+        }
+        g_inis_loaded = true;
+    }
+
+    int rc;
+
+    if (write_skyrim_ini) {
+        std::string base_list_1 = getBaseArchiveList(g_skyrim_ini, INI_ARCHIVE_LIST_1);
+        std::string base_list_3 = getBaseArchiveList(g_skyrim_ini, INI_ARCHIVE_LIST_3);
+        g_skyrim_ini.set(INI_SECTION_ARCHIVE, INI_ARCHIVE_LIST_1, joinArchiveLists(base_list_1, list_1));
+        g_skyrim_ini.set(INI_SECTION_ARCHIVE, INI_ARCHIVE_LIST_3, joinArchiveLists(base_list_3, list_3));
+
+        if (RC_FAILURE(rc = saveIni(g_skyrim_ini_path, g_skyrim_ini, bytes_written, error))) {
+            return rc;
+        }
+        g_skyrim_ini_hash = skyrim_ini_hash;
+        *files_written |= INI_WROTE_SKYRIM;
+    }
 
-    writeFileList(getRomfsPath(SKYRIM_INI_FILE).c_str(), g_skyrim_ini, INI_ARCHIVE_LIST_1, g_archive_types_1);
-    writeFileList(ini_lang_file.c_str(), g_skyrim_lang_ini, INI_ARCHIVE_LIST_2, g_archive_types_2);
-    writeFileList(getRomfsPath(SKYRIM_INI_FILE).c_str(), g_skyrim_ini, INI_ARCHIVE_LIST_3, g_archive_types_3);
+    if (write_skyrim_lang_ini) {
+        std::string base_list_2 = getBaseArchiveList(g_skyrim_lang_ini, INI_ARCHIVE_LIST_2);
+        g_skyrim_lang_ini.set(INI_SECTION_ARCHIVE, INI_ARCHIVE_LIST_2, joinArchiveLists(base_list_2, list_2));
+
+        if (RC_FAILURE(rc = saveIni(g_skyrim_lang_ini_path, g_skyrim_lang_ini, bytes_written, error))) {
+            return rc;
+        }
+        g_skyrim_lang_ini_hash = skyrim_lang_ini_hash;
+        *files_written |= INI_WROTE_SKYRIM_LANG;
+    }
+
+    return 0;
+}
+
+int writeIniChanges(size_t *bytes_written, int *files_written) {
+    int rc;
+    if (RC_FAILURE(rc = prepareIniSave())) {
+        return rc;
+    }
+
+    FileError error;
+    if (RC_FAILURE(rc = saveIniChanges(getGlobalModList(), bytes_written, files_written, &error))) {
+        FATAL("Failed to %s %s", error.action, error.path.c_str());
+        return rc;
+    }
 
+    phaseAddFiles(((*files_written & INI_WROTE_SKYRIM) != 0) + ((*files_written & INI_WROTE_SKYRIM_LANG) != 0));
+    phaseAddBytes(*bytes_written);
     return 0;
 }
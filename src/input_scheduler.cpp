@@ -0,0 +1,71 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "input_scheduler.hpp"
+
+#include <cstdint>
+#include <vector>
+
+void InputScheduler::update(uint64_t buttons, uint64_t now, std::vector<InputEvent> &events) {
+    uint64_t pressed = buttons & ~held;
+    uint64_t released = held & ~buttons;
+    held = buttons;
+
+    for (uint64_t bits = released; bits != 0; bits &= bits - 1) {
+        uint64_t button = bits & -bits;
+        events.insert(events.end(), {InputEventType::RELEASE, button});
+
+        if (button == repeat_button) {
+            repeat_button = 0;
+            next_repeat = INPUT_NO_DEADLINE;
+        }
+    }
+
+    for (uint64_t bits = pressed; bits != 0; bits &= bits - 1) {
+        uint64_t button = bits & -bits;
+        events.insert(events.end(), {InputEventType::PRESS, button});
+
+        // the most recently pressed repeatable button takes over
+        if (button & repeat.buttons) {
+            repeat_button = button;
+            next_repeat = now + repeat.initial_delay;
+            cur_interval = repeat.interval;
+        }
+    }
+
+    if (repeat_button != 0 && now >= next_repeat) {
+        events.insert(events.end(), {InputEventType::REPEAT, repeat_button});
+
+        // schedule from the missed deadline rather than from now so a late
+        // update doesn't slow the repeat rate, but never queue up a backlog
+        next_repeat += cur_interval;
+        if (next_repeat <= now) {
+            next_repeat = now + cur_interval;
+        }
+
+        uint64_t accelerated = cur_interval - cur_interval * repeat.accel_percent / 100;
+        cur_interval = accelerated > repeat.min_interval ? accelerated : repeat.min_interval;
+    }
+}
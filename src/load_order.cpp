@@ -0,0 +1,332 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "load_order.hpp"
+
+#include "master_graph.hpp"
+#include "mod.hpp"
+#include "plugin_header.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#define SORT_NONE UINT32_MAX
+
+// Plugins are numbered in list order, and each plugin's masters are kept in a
+// single array, sorted by their numbers so they're pulled up in the order they
+// already have.
+struct DependencyGraph {
+    // list position of each plugin
+    std::vector<uint32_t> positions;
+    std::vector<bool> flagged;
+    // masters of plugin k are masters[first_edge[k]] up to masters[first_edge[k + 1]]
+    std::vector<uint32_t> first_edge;
+    std::vector<uint32_t> masters;
+};
+
+// Plugins which depend on one another in a loop are grouped into a component,
+// which is placed as a whole. Plugins outside any loop are components of one.
+struct ComponentGraph {
+    std::vector<uint32_t> components;
+    // members of component c are members[first_member[c]] up to
+    // members[first_member[c + 1]], in list order
+    std::vector<uint32_t> first_member;
+    std::vector<uint32_t> members;
+};
+
+// A plugin or component being visited, along with where its walk over its
+// masters has got to.
+struct SortFrame {
+    uint32_t node;
+    uint32_t next_member;
+    uint32_t next_edge;
+};
+
+// Turns (plugin, master) pairs into per-plugin master lists in list order with
+// a counting sort by master followed by a stable one by plugin.
+static void buildEdgeLists(std::vector<std::pair<uint32_t, uint32_t>> const &edges, size_t node_count,
+        DependencyGraph &deps) {
+    std::vector<uint32_t> counts(node_count + 1, 0);
+    for (std::pair<uint32_t, uint32_t> const &edge : edges) {
+        counts[edge.second + 1]++;
+    }
+    for (size_t i = 0; i < node_count; i++) {
+        counts[i + 1] += counts[i];
+    }
+    std::vector<uint32_t> by_master(edges.size());
+    for (uint32_t i = 0; i < edges.size(); i++) {
+        by_master[counts[edges[i].second]++] = i;
+    }
+
+    deps.first_edge.assign(node_count + 1, 0);
+    for (std::pair<uint32_t, uint32_t> const &edge : edges) {
+        deps.first_edge[edge.first + 1]++;
+    }
+    for (size_t i = 0; i < node_count; i++) {
+        deps.first_edge[i + 1] += deps.first_edge[i];
+    }
+    std::vector<uint32_t> cursors(deps.first_edge.begin(), deps.first_edge.end() - 1);
+    deps.masters.resize(edges.size());
+    for (uint32_t i : by_master) {
+        deps.masters[cursors[edges[i].first]++] = edges[i].second;
+    }
+}
+
+static void buildDependencies(ModRegistry const &mod_list, MasterGraph const &graph, DependencyGraph &deps,
+        LoadOrderSortResult *result) {
+    std::vector<uint32_t> pos_nodes(mod_list.size(), SORT_NONE);
+    for (size_t pos = 0; pos < mod_list.size(); pos++) {
+        if (mod_list.at(pos).hasEsp()) {
+            pos_nodes[pos] = deps.positions.size();
+            deps.positions.insert(deps.positions.end(), pos);
+        }
+    }
+
+    size_t node_count = deps.positions.size();
+    std::vector<PluginHeader const *> headers(node_count);
+    deps.flagged.resize(node_count);
+    for (size_t k = 0; k < node_count; k++) {
+        SkyrimMod mod = mod_list.at(deps.positions[k]);
+        headers[k] = graph.find(mod.getPluginFileName());
+        // the game treats a plugin as a master if it's flagged as one or named like one
+        deps.flagged[k] = mod.isMaster() || (headers[k] && headers[k]->isMasterFlagged());
+    }
+
+    // (plugin, master) pairs in the order the headers list them
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    for (uint32_t k = 0; k < node_count; k++) {
+        if (!headers[k]) {
+            continue;
+        }
+
+        for (std::string const &master : headers[k]->masters) {
+            ModFileView file = ModFileView::classify(master);
+            ssize_t pos = file.type == ModFileType::ESP || file.type == ModFileType::ESM
+                    ? mod_list.indexOf(file.base_name)
+                    : -1;
+            // Foo.esm isn't satisfied by Foo.esp, nor by a mod with no plugin at all
+            if (pos < 0 || pos_nodes[pos] == SORT_NONE
+                    || mod_list.at(pos).isMaster() != (file.type == ModFileType::ESM)) {
+                result->missing_masters++;
+                continue;
+            }
+
+            uint32_t m = pos_nodes[pos];
+            if (m == k) {
+                continue;
+            }
+            if (deps.flagged[k] && !deps.flagged[m]) {
+                // the game loads this master after the plugin whatever the order says
+                result->flag_conflicts++;
+                continue;
+            }
+            edges.insert(edges.end(), {k, m});
+        }
+    }
+    result->dependencies = edges.size();
+
+    buildEdgeLists(edges, node_count, deps);
+}
+
+// Finds the strongly connected components of the dependency graph with
+// Tarjan's algorithm, kept iterative since dependency chains can be thousands
+// of plugins long.
+static void findComponents(DependencyGraph const &deps, ComponentGraph &comps) {
+    size_t node_count = deps.positions.size();
+    std::vector<uint32_t> indices(node_count, SORT_NONE);
+    std::vector<uint32_t> lowlinks(node_count);
+    std::vector<bool> on_stack(node_count, false);
+    std::vector<uint32_t> open;
+    std::vector<SortFrame> frames;
+    uint32_t next_index = 0;
+    uint32_t component_count = 0;
+
+    comps.components.assign(node_count, SORT_NONE);
+    for (uint32_t root = 0; root < node_count; root++) {
+        if (indices[root] != SORT_NONE) {
+            continue;
+        }
+
+        indices[root] = lowlinks[root] = next_index++;
+        open.insert(open.end(), root);
+        on_stack[root] = true;
+        frames.insert(frames.end(), {root, 0, deps.first_edge[root]});
+
+        while (!frames.empty()) {
+            SortFrame &frame = frames.back();
+            uint32_t node = frame.node;
+            if (frame.next_edge < deps.first_edge[node + 1]) {
+                uint32_t master = deps.masters[frame.next_edge++];
+                if (indices[master] == SORT_NONE) {
+                    indices[master] = lowlinks[master] = next_index++;
+                    open.insert(open.end(), master);
+                    on_stack[master] = true;
+                    frames.insert(frames.end(), {master, 0, deps.first_edge[master]});
+                } else if (on_stack[master]) {
+                    lowlinks[node] = std::min(lowlinks[node], indices[master]);
+                }
+                continue;
+            }
+
+            frames.pop_back();
+            if (!frames.empty()) {
+                uint32_t parent = frames.back().node;
+                lowlinks[parent] = std::min(lowlinks[parent], lowlinks[node]);
+            }
+            if (lowlinks[node] == indices[node]) {
+                uint32_t member;
+                do {
+                    member = open.back();
+                    open.pop_back();
+                    on_stack[member] = false;
+                    comps.components[member] = component_count;
+                } while (member != node);
+                component_count++;
+            }
+        }
+    }
+
+    // counting sort by component, which keeps each one's members in list order
+    comps.first_member.assign(component_count + 1, 0);
+    for (uint32_t c : comps.components) {
+        comps.first_member[c + 1]++;
+    }
+    for (size_t c = 0; c < component_count; c++) {
+        comps.first_member[c + 1] += comps.first_member[c];
+    }
+    std::vector<uint32_t> cursors(comps.first_member.begin(), comps.first_member.end() - 1);
+    comps.members.resize(node_count);
+    for (uint32_t k = 0; k < node_count; k++) {
+        comps.members[cursors[comps.components[k]]++] = k;
+    }
+}
+
+void sortLoadOrder(ModRegistry const &mod_list, MasterGraph const &graph, std::vector<ModId> &order,
+        LoadOrderSortResult *result) {
+    *result = LoadOrderSortResult();
+    order = mod_list.getIds();
+
+    DependencyGraph deps;
+    buildDependencies(mod_list, graph, deps, result);
+    size_t node_count = deps.positions.size();
+    result->plugins = node_count;
+
+    ComponentGraph comps;
+    findComponents(deps, comps);
+    size_t component_count = comps.first_member.size() - 1;
+    for (size_t c = 0; c < component_count; c++) {
+        uint32_t first = comps.first_member[c];
+        uint32_t end = comps.first_member[c + 1];
+        if (end - first < 2) {
+            continue;
+        }
+        if (result->cycle_count++ < SORT_MAX_REPORTED_CYCLES) {
+            std::vector<ModId> cycle;
+            for (uint32_t i = first; i < end; i++) {
+                cycle.insert(cycle.end(), order[deps.positions[comps.members[i]]]);
+            }
+            result->cycles.insert(result->cycles.end(), std::move(cycle));
+        }
+    }
+
+    std::vector<bool> placed(component_count, false);
+    std::vector<bool> pending(component_count, false);
+    std::vector<SortFrame> frames;
+    std::vector<uint32_t> sorted;
+    sorted.reserve(node_count);
+
+    // Places a component after whichever of its members' masters aren't placed
+    // yet, depth first. Components form no loops, so the walk always ends.
+    auto visit = [&](uint32_t root) {
+        pending[root] = true;
+        frames.insert(frames.end(), {root, comps.first_member[root], 0});
+
+        while (!frames.empty()) {
+            SortFrame &frame = frames.back();
+            uint32_t comp = frame.node;
+            uint32_t members_end = comps.first_member[comp + 1];
+
+            // step through the masters of each member in turn
+            uint32_t master = SORT_NONE;
+            while (frame.next_member < members_end && master == SORT_NONE) {
+                uint32_t member = comps.members[frame.next_member];
+                if (frame.next_edge < deps.first_edge[member]) {
+                    frame.next_edge = deps.first_edge[member];
+                }
+                if (frame.next_edge < deps.first_edge[member + 1]) {
+                    master = deps.masters[frame.next_edge++];
+                } else {
+                    frame.next_member++;
+                }
+            }
+
+            if (master == SORT_NONE) {
+                for (uint32_t i = comps.first_member[comp]; i < members_end; i++) {
+                    sorted.insert(sorted.end(), comps.members[i]);
+                }
+                placed[comp] = true;
+                frames.pop_back();
+                continue;
+            }
+
+            uint32_t master_comp = comps.components[master];
+            if (placed[master_comp] || pending[master_comp]) {
+                continue;
+            }
+            pending[master_comp] = true;
+            frames.insert(frames.end(), {master_comp, comps.first_member[master_comp], 0});
+        }
+    };
+
+    // master-flagged plugins all load first, so they're placed among themselves first
+    for (uint32_t k = 0; k < node_count; k++) {
+        if (deps.flagged[k] && !pending[comps.components[k]]) {
+            visit(comps.components[k]);
+        }
+    }
+    for (uint32_t k = 0; k < node_count; k++) {
+        if (!pending[comps.components[k]]) {
+            visit(comps.components[k]);
+        }
+    }
+
+    // the plugins placed earlier than a plugin they used to follow are the ones
+    // which had to move; the rest keep their order
+    uint32_t min_after = SORT_NONE;
+    for (size_t i = node_count; i-- > 0; ) {
+        if (sorted[i] < min_after) {
+            min_after = sorted[i];
+        } else {
+            result->moved++;
+        }
+    }
+
+    std::vector<ModId> const &ids = mod_list.getIds();
+    for (size_t i = 0; i < node_count; i++) {
+        order[deps.positions[i]] = ids[deps.positions[sorted[i]]];
+    }
+}
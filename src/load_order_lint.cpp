@@ -0,0 +1,317 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "load_order_lint.hpp"
+
+#include "master_graph.hpp"
+#include "mod.hpp"
+#include "plugin_header.hpp"
+#include "string_helper.hpp"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#define LINT_NO_POSITION UINT32_MAX
+
+// masters the game always loads first, which the plugin list leaves out
+static const char *const IMPLICIT_PLUGINS[] = {
+    "Skyrim", "Update", "Dawnguard", "HearthFires", "Dragonborn"
+};
+
+static bool isImplicitPlugin(SkyrimMod const &mod) {
+    if (!mod.hasEsp() || !mod.isMaster()) {
+        return false;
+    }
+    for (const char *name : IMPLICIT_PLUGINS) {
+        if (equalsFolded(mod.getBaseName(), name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Mirrors the Animations check behind a PARTIAL status.
+static bool isAnimationsOnce(SkyrimMod const &mod) {
+    BsaState const &bsas = mod.getBsaState();
+    if ((bsas.enabled & BSA_BIT(BsaSuffix::ANIMATIONS)) && bsas.animations < BSA_ANIMATIONS_LISTS) {
+        return true;
+    }
+
+    std::vector<ExtraBsa> const *extras = mod.getExtraBsas();
+    if (extras != NULL) {
+        for (ExtraBsa const &extra : *extras) {
+            if (extra.kind == BsaSuffix::ANIMATIONS && extra.enabled_count > 0
+                    && extra.enabled_count < BSA_ANIMATIONS_LISTS) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Turns (from, to) pairs into per-mod lists of to with a counting sort by from,
+// which keeps each list in the order its pairs were given.
+static void buildAdjacency(std::vector<std::pair<ModId, ModId>> const &edges, size_t mod_count, bool reverse,
+        std::vector<uint32_t> &first, std::vector<ModId> &targets) {
+    first.assign(mod_count + 1, 0);
+    for (std::pair<ModId, ModId> const &edge : edges) {
+        first[(reverse ? edge.second : edge.first) + 1]++;
+    }
+    for (size_t i = 0; i < mod_count; i++) {
+        first[i + 1] += first[i];
+    }
+    std::vector<uint32_t> cursors(first.begin(), first.end() - 1);
+    targets.resize(edges.size());
+    for (std::pair<ModId, ModId> const &edge : edges) {
+        ModId from = reverse ? edge.second : edge.first;
+        targets[cursors[from]++] = reverse ? edge.first : edge.second;
+    }
+}
+
+bool LoadOrderLinter::isActive(ModId id) const {
+    SkyrimMod mod(&mod_list.getStore(), id);
+    return mod.hasEsp() && !mod.isMissing() && (mod.isEspEnabled() || implicit[id]);
+}
+
+ssize_t LoadOrderLinter::getPosition(ModId id, std::vector<uint32_t> const *positions) const {
+    if (positions != NULL) {
+        return (*positions)[id] == LINT_NO_POSITION ? -1 : (ssize_t) (*positions)[id];
+    }
+    return mod_list.indexOf(mod_list.getStore().getBaseName(id));
+}
+
+uint8_t LoadOrderLinter::checkMaster(ModId plugin, ssize_t plugin_pos, ModId master,
+        std::vector<uint32_t> const *positions) const {
+    if (implicit[master]) {
+        return 0;
+    }
+    if (SkyrimMod(&mod_list.getStore(), master).isMissing()) {
+        return LINT_MASTER_MISSING;
+    }
+    if (!isActive(master)) {
+        return LINT_MASTER_DISABLED;
+    }
+
+    // master-flagged plugins all load first, whatever the order says
+    if (flagged[plugin] != flagged[master]) {
+        return flagged[plugin] ? LINT_MASTER_LATER : 0;
+    }
+    return getPosition(master, positions) > plugin_pos ? LINT_MASTER_LATER : 0;
+}
+
+uint8_t LoadOrderLinter::check(ModId id, std::vector<uint32_t> const *positions) const {
+    SkyrimMod mod(&mod_list.getStore(), id);
+    if (mod.isMissing()) {
+        return 0;
+    }
+
+    uint8_t found = 0;
+    bool active = isActive(id);
+    if (mod.hasEsp() && !active && mod.hasEnabledBsas()) {
+        found |= LINT_ORPHANED_BSAS;
+    }
+    if (isAnimationsOnce(mod)) {
+        found |= LINT_ANIMATIONS_ONCE;
+    }
+
+    if (!active || first_master.empty()) {
+        return found;
+    }
+
+    if (absent_masters.find(id) != absent_masters.end()) {
+        found |= LINT_MASTER_MISSING;
+    }
+    ssize_t pos = getPosition(id, positions);
+    for (size_t i = first_master[id]; i < first_master[id + 1]; i++) {
+        found |= checkMaster(id, pos, masters[i], positions);
+    }
+    return found;
+}
+
+bool LoadOrderLinter::setIssues(ModId id, uint8_t found) {
+    uint8_t old = issues[id];
+    if (found == old) {
+        return false;
+    }
+
+    for (size_t bit = 0; bit < LINT_ISSUE_COUNT; bit++) {
+        counts.issues[bit] -= (old >> bit) & 1;
+        counts.issues[bit] += (found >> bit) & 1;
+    }
+    counts.flagged -= old != 0;
+    counts.flagged += found != 0;
+    issues[id] = found;
+    return true;
+}
+
+void LoadOrderLinter::relintAll(MasterGraph const *graph) {
+    clear();
+
+    ModStore const &store = mod_list.getStore();
+    size_t mod_count = store.size();
+    std::vector<ModId> const &ids = mod_list.getIds();
+    issues.assign(mod_count, 0);
+    implicit.assign(mod_count, false);
+    flagged.assign(mod_count, false);
+
+    std::vector<uint32_t> positions(mod_count, LINT_NO_POSITION);
+    for (size_t pos = 0; pos < ids.size(); pos++) {
+        SkyrimMod mod = mod_list.at(pos);
+        positions[ids[pos]] = pos;
+        implicit[ids[pos]] = isImplicitPlugin(mod);
+        flagged[ids[pos]] = mod.isMaster();
+    }
+
+    if (graph != NULL) {
+        // (plugin, master) pairs, each plugin's in the order its header lists them
+        std::vector<std::pair<ModId, ModId>> edges;
+        for (size_t pos = 0; pos < ids.size(); pos++) {
+            SkyrimMod mod = mod_list.at(pos);
+            PluginHeader const *header = mod.hasEsp() ? graph->find(mod.getPluginFileName()) : NULL;
+            if (header == NULL) {
+                continue;
+            }
+            // the game treats a plugin as a master if it's flagged as one or named like one
+            flagged[ids[pos]] = flagged[ids[pos]] || header->isMasterFlagged();
+
+            size_t plugin_edges = edges.size();
+            for (std::string const &master : header->masters) {
+                ModFileView file = ModFileView::classify(master);
+                ssize_t master_pos = file.type == ModFileType::ESP || file.type == ModFileType::ESM
+                        ? mod_list.indexOf(file.base_name)
+                        : -1;
+                // Foo.esm isn't satisfied by Foo.esp, nor by a mod with no plugin at all
+                if (master_pos < 0 || !mod_list.at(master_pos).hasEsp()
+                        || mod_list.at(master_pos).isMaster() != (file.type == ModFileType::ESM)) {
+                    absent_masters.emplace(ids[pos], master);
+                    continue;
+                }
+
+                ModId master_id = ids[master_pos];
+                bool listed = master_id == ids[pos];
+                for (size_t i = plugin_edges; i < edges.size() && !listed; i++) {
+                    listed = edges[i].second == master_id;
+                }
+                if (!listed) {
+                    edges.insert(edges.end(), {ids[pos], master_id});
+                }
+            }
+        }
+
+        buildAdjacency(edges, mod_count, false, first_master, masters);
+        buildAdjacency(edges, mod_count, true, first_dependent, dependents);
+    }
+
+    for (ModId id : ids) {
+        setIssues(id, check(id, &positions));
+    }
+}
+
+LintUpdate LoadOrderLinter::relint(ModId id) {
+    LintUpdate update = {0, 0};
+    if (id >= issues.size()) {
+        return update;
+    }
+
+    setIssues(id, check(id, NULL));
+    if (first_dependent.empty()) {
+        return update;
+    }
+
+    for (size_t i = first_dependent[id]; i < first_dependent[id + 1]; i++) {
+        ModId dependent = dependents[i];
+        if (setIssues(dependent, check(dependent, NULL))) {
+            update.changed++;
+        }
+        if (isActive(dependent)
+                && checkMaster(dependent, getPosition(dependent, NULL), id, NULL) != 0) {
+            update.broken_dependents++;
+        }
+    }
+    return update;
+}
+
+uint8_t LoadOrderLinter::getIssues(ModId id) const {
+    return id < issues.size() ? issues[id] : 0;
+}
+
+LintCounts const &LoadOrderLinter::getCounts(void) const {
+    return counts;
+}
+
+std::string LoadOrderLinter::describe(ModId id) const {
+    uint8_t found = getIssues(id);
+    if (found & LINT_MASTER_ISSUES) {
+        // name the first master at fault, preferring the issue which stops the game loading at all
+        ssize_t pos = getPosition(id, NULL);
+        for (uint8_t issue : {LINT_MASTER_MISSING, LINT_MASTER_DISABLED, LINT_MASTER_LATER}) {
+            if (!(found & issue)) {
+                continue;
+            }
+
+            std::string master;
+            if (issue == LINT_MASTER_MISSING && absent_masters.find(id) != absent_masters.end()) {
+                master = absent_masters.at(id);
+            } else {
+                for (size_t i = first_master[id]; i < first_master[id + 1] && master.empty(); i++) {
+                    if (checkMaster(id, pos, masters[i], NULL) == issue) {
+                        master = SkyrimMod(&mod_list.getStore(), masters[i]).getPluginFileName();
+                    }
+                }
+            }
+
+            switch (issue) {
+                case LINT_MASTER_MISSING:
+                    return "Master " + master + " is missing";
+                case LINT_MASTER_DISABLED:
+                    return "Master " + master + " is disabled";
+                default:
+                    return "Master " + master + " loads after it";
+            }
+        }
+    }
+
+    if (found & LINT_ORPHANED_BSAS) {
+        return "Archives are enabled without the plugin";
+    }
+    if (found & LINT_ANIMATIONS_ONCE) {
+        return "Animations archive is only in one archive list";
+    }
+    return "";
+}
+
+void LoadOrderLinter::clear(void) {
+    issues.clear();
+    implicit.clear();
+    flagged.clear();
+    first_master.clear();
+    masters.clear();
+    first_dependent.clear();
+    dependents.clear();
+    absent_masters.clear();
+    counts = LintCounts();
+}
@@ -23,27 +23,37 @@
  * THE SOFTWARE.
  */
 
+#include "asset_index.hpp"
 #include "console_helper.hpp"
+#include "console_renderer.hpp"
+#include "data_scanner.hpp"
 #include "error_defs.hpp"
+#include "file_helper.hpp"
 #include "gui.hpp"
 #include "ini_helper.hpp"
+#include "input_scheduler.hpp"
+#include "load_order.hpp"
+#include "load_order_lint.hpp"
 #include "mod.hpp"
+#include "mod_journal.hpp"
+#include "mod_manager.hpp"
 #include "path_helper.hpp"
+#include "phase_timer.hpp"
+#include "plugins_helper.hpp"
+#include "scan_cache.hpp"
 #include "string_helper.hpp"
 
-#include <inipp/inipp.h>
 #include <switch.h>
 
 #include <algorithm>
-#include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <cstdio>
-#include <dirent.h>
 
 #define STRINGIZE0(x) #x
 #define STRINGIZE(x) STRINGIZE0(x)
@@ -55,10 +65,24 @@
 #define HEADER_HEIGHT 3
 #define FOOTER_HEIGHT 5
 
+#define FOOTER_ROW (CONSOLE_LINES - FOOTER_HEIGHT)
+
 #define HRULE "--------------------------------"
 
+#define STYLE_FG(fg) (ConsoleStyle {fg, CONSOLE_COLOR_BG_BLACK, CONSOLE_ATTR_BOLD})
+#define STYLE_PLAIN STYLE_FG(CONSOLE_COLOR_FG_WHITE)
+#define STYLE_STATUS (ConsoleStyle {CONSOLE_COLOR_FG_YELLOW, CONSOLE_COLOR_BG_BLACK, CONSOLE_ATTR_NONE})
+
 #define SCROLL_INTERVAL 100000000
 #define SCROLL_INITIAL_DELAY 400000000
+#define SCROLL_MIN_INTERVAL 30000000
+#define SCROLL_ACCEL_PERCENT 10
+
+#define FRAME_INTERVAL 16666667
+
+#define TIMINGS_COMBO (HidNpadButton_ZL | HidNpadButton_ZR)
+
+#define MIN(a, b) (a < b ? a : b)
 
 static HidNpadButton g_key_edit_lo = HidNpadButton_Y;
 
@@ -68,418 +92,759 @@ static bool g_dirty_warned = false;
 static std::string g_status_msg = "";
 static bool g_tmp_status = false;
 
-static ModList g_mod_list_tmp;
+#define UNDO_BUTTONS (HidNpadButton_L | HidNpadButton_R)
 
-static std::string g_plugins_header;
-
-static int g_scroll_dir = 0;
-static u64 g_last_scroll_time = 0;
-static bool g_scroll_initial_cooldown;
+static InputScheduler g_input({
+    HidNpadButton_AnyUp | HidNpadButton_AnyDown | UNDO_BUTTONS,
+    SCROLL_INITIAL_DELAY,
+    SCROLL_INTERVAL,
+    SCROLL_MIN_INTERVAL,
+    SCROLL_ACCEL_PERCENT
+});
 
 static bool g_edit_load_order = false;
 
+// every toggle and move made since the mod list was loaded or last rescanned
+static ModJournal g_journal(getGlobalModList());
+
+// load order issues of every mod, re-checked after each edit
+static LoadOrderLinter g_linter(getGlobalModList());
+// whether the linter has the masters from the plugin headers yet
+static bool g_lint_masters = false;
+// what the last edit broke, shown under the status until the next input
+static std::string g_lint_msg = "";
+
+static bool g_show_timings = false;
+// set while the timings combo is held so it toggles once per press
+static bool g_timings_combo_latched = false;
+
+static void writeConsole(const char *data, size_t len) {
+    fwrite(data, 1, len, stdout);
+    fflush(stdout);
+}
+
+// the console addresses rows and columns from 0 and doesn't support scroll regions
+static ConsoleRenderer g_renderer(CONSOLE_ROWS, CONSOLE_COLUMNS, STYLE_PLAIN, 0, false, writeConsole);
+
 static u64 _nanotime(void) {
     return armTicksToNs(armGetSystemTick());
 }
 
-int discoverMods() {
-    DIR *dir = opendir(getRomfsPath(SKYRIM_DATA_DIR).c_str());
+int initialize(void) {
+    int rc;
 
-    if (!dir) {
-        FATAL("No Skyrim data folder found!\nSearched in %s", getBaseRomfsPath());
-        return -1;
-    }
+    CONSOLE_SET_POS(0, 0);
+    CONSOLE_CLEAR_SCREEN();
+    CONSOLE_SET_ATTRS(CONSOLE_ATTR_BOLD);
+    printf("Discovering available mods...\n");
 
-    std::vector<std::string> files;
+    if (RC_FAILURE(rc = loadModList())) {
+        return rc;
+    }
+    // nothing needs the masters or archives until the load order is checked, so read them behind the UI
+    queueMasterGraphLoad();
+    queueAssetIndexLoad();
 
-    struct dirent *ent;
-    while ((ent = readdir(dir))) {
-        if (ent->d_type != DT_REG) {
-            continue;
+    CONSOLE_MOVE_DOWN(3);
+    printf("Mod listing:\n\n");
+    for (SkyrimMod mod : getGlobalModList()) {
+        ModStatus status = mod.getStatus();
+        const char *status_str;
+        switch (status) {
+            case ModStatus::ENABLED:
+                status_str = "Enabled";
+                break;
+            case ModStatus::DISABLED:
+                status_str = "Disabled";
+                break;
+            case ModStatus::PARTIAL:
+                status_str = "Partial";
+                break;
+            default:
+                PANIC();
+                return -1;
         }
+        std::string_view name = mod.getBaseName();
+        printf("  - %.*s (%s)\n", (int) name.size(), name.data(), status_str);
+    }
+
+    return 0;
+}
 
-        files.insert(files.end(), ent->d_name);
+// Draws the status totals, which are kept up to date as mods change rather than
+// counted here.
+static void redrawSummary(void) {
+    ModStatusCounts const &counts = getGlobalModStore().getStatusCounts();
+
+    char summary[CONSOLE_COLUMNS + 1];
+    if (counts.missing > 0) {
+        snprintf(summary, sizeof(summary), "%lu mods: %lu enabled, %lu partial, %lu disabled, %lu missing",
+                getGlobalModList().size(), counts.enabled, counts.partial, counts.disabled, counts.missing);
+    } else {
+        snprintf(summary, sizeof(summary), "%lu mods: %lu enabled, %lu partial, %lu disabled",
+                getGlobalModList().size(), counts.enabled, counts.partial, counts.disabled);
     }
 
-    closedir(dir);
+    g_renderer.clearRow(1);
+    g_renderer.putText(1, 0, summary, STYLE_PLAIN);
+}
 
-    printf("Found %lu mod files\n", files.size());
+static void redrawHeader(void) {
+    g_renderer.clearRow(0);
+    g_renderer.putText(0, 0, "SkyMM-NX v" STRINGIZE(__VERSION) " by caseif", STYLE_FG(CONSOLE_COLOR_FG_CYAN));
 
-    for (std::string file_name : files) {
-        ModFile mod_file = ModFile::fromFileName(file_name);
+    redrawSummary();
 
-        if (mod_file.type == ModFileType::UNKNOWN) {
-            continue;
-        } 
+    g_renderer.clearRow(2);
+    g_renderer.putText(2, 0, HRULE, STYLE_PLAIN);
+}
 
-        std::shared_ptr<SkyrimMod> mod = find_mod(g_mod_list_tmp, mod_file.base_name);
-        if (!mod) {
-            mod = std::shared_ptr<SkyrimMod>(new SkyrimMod(mod_file.base_name));
-            // everything gets loaded into a temp buffer so we can rebuild it with the proper order later
-            g_mod_list_tmp.insert(g_mod_list_tmp.end(), mod);
-        }
+static void redrawFooter() {
+    g_renderer.clearRow(FOOTER_ROW);
+    g_renderer.putText(FOOTER_ROW, 0, HRULE, STYLE_PLAIN);
 
-        if (mod_file.type == ModFileType::ESP) {
-            mod->has_esp = true;
-        } else if (mod_file.type == ModFileType::ESM) {
-            mod->has_esp = true;
-            mod->is_master = true;
-        } else if (mod_file.type == ModFileType::BSA) {
-            mod->bsa_suffixes.insert(mod->bsa_suffixes.end(), mod_file.suffix);
-        } else {
-            PANIC();
-            return -1;
-        }
+    g_renderer.clearRow(FOOTER_ROW + 2);
+    if (!g_status_msg.empty()) {
+        g_renderer.putText(FOOTER_ROW + 2, 0, g_status_msg, STYLE_STATUS);
     }
 
-    return 0;
-}
+    g_renderer.clearRow(FOOTER_ROW + 3);
+    if (!g_lint_msg.empty()) {
+        g_renderer.putText(FOOTER_ROW + 3, 0, g_lint_msg, STYLE_FG(CONSOLE_COLOR_FG_YELLOW));
+    } else if (g_linter.getCounts().flagged > 0) {
+        char summary[CONSOLE_COLUMNS + 1];
+        snprintf(summary, sizeof(summary), "%lu mod(s) with load order warnings (!)", g_linter.getCounts().flagged);
+        g_renderer.putText(FOOTER_ROW + 3, 0, summary, STYLE_STATUS);
+    }
 
-int processPluginsFile() {
-    std::ifstream plugins_stream = std::ifstream(getRomfsPath(SKYRIM_PLUGINS_FILE), std::ios::in);
-    if (!plugins_stream.good()) {
-        FATAL("Failed to open Plugins file");
-        return -1;
+    g_renderer.clearRow(FOOTER_ROW + 4);
+    g_renderer.clearRow(FOOTER_ROW + 5);
+    if (g_show_timings) {
+        g_renderer.putText(FOOTER_ROW + 4, 0, "(ZL+ZR) Close Timings  |  (A) Append to Log",
+                STYLE_FG(CONSOLE_COLOR_FG_GREEN));
+        g_renderer.putText(FOOTER_ROW + 5, 0, "(+) Exit", STYLE_FG(CONSOLE_COLOR_FG_GREEN));
+        return;
     }
 
-    bool in_header = true;
-    std::stringstream header_stream;
-    std::string line;
-    while (std::getline(plugins_stream, line)) {
-        if (line.length() == 0 || line.at(0) == '#') {
-            if (in_header) {
-                header_stream << line << '\n';
-            }
-            continue;
-        }
+    g_renderer.putText(FOOTER_ROW + 4, 0, "(Up/Down) Navigate  |  (A) Toggle  |  (B) Conflicts  |  (Y) (hold) Load Order",
+            STYLE_FG(CONSOLE_COLOR_FG_GREEN));
+    g_renderer.putText(FOOTER_ROW + 5, 0, "(-) Save  |  (X) Rescan  |  (L/R) Undo/Redo  |  (+) Exit  |  (ZL+ZR) Timings",
+            STYLE_FG(CONSOLE_COLOR_FG_GREEN));
+}
 
-        if (in_header) {
-            g_plugins_header = header_stream.str();
-            in_header = false;
-        }
+// Draws the phase timings over the mod list.
+static void redrawTimings(void) {
+    char row_buf[PHASE_ROW_LEN + 1];
+    size_t row = HEADER_HEIGHT;
 
-        bool enable = line.at(0) == '*';
+    g_renderer.clearRow(row);
+    g_renderer.putText(row++, 0, "Phase timings", STYLE_FG(CONSOLE_COLOR_FG_CYAN));
+    g_renderer.clearRow(row++);
 
-        std::string file_name = enable ? line.substr(1) : line;
-        ModFile file_def = ModFile::fromFileName(file_name);
-        if (file_def.type != ModFileType::ESP && file_def.type != ModFileType::ESM) {
-            continue;
-        }
+    formatPhaseRecord(NULL, row_buf, sizeof(row_buf));
+    g_renderer.clearRow(row);
+    g_renderer.putText(row++, 0, row_buf, STYLE_FG(CONSOLE_COLOR_FG_YELLOW));
 
-        std::shared_ptr<SkyrimMod> mod = find_mod(getGlobalModList(), file_def.base_name);
-        if (!mod) {
-            mod = find_mod(g_mod_list_tmp, file_def.base_name);
-            if (mod) {
-                getGlobalModList().insert(getGlobalModList().end(), mod);
-            } else {
-                continue;
-            }
+    for (PhaseRecord const &record : getPhaseRecords()) {
+        if (row >= FOOTER_ROW) {
+            break;
         }
+        formatPhaseRecord(&record, row_buf, sizeof(row_buf));
+        g_renderer.clearRow(row);
+        g_renderer.putText(row++, 0, row_buf, STYLE_PLAIN);
+    }
 
-        mod->esp_enabled = enable;
+    while (row < FOOTER_ROW) {
+        g_renderer.clearRow(row++);
     }
+}
 
-    return 0;
+static void toggleTimings(ModGui &gui) {
+    if (g_edit_load_order) {
+        // the release of the edit key would be swallowed by the overlay
+        g_edit_load_order = false;
+        g_status_msg = "";
+    }
+
+    g_show_timings = !g_show_timings;
+    if (g_show_timings) {
+        redrawTimings();
+    } else {
+        gui.redraw();
+    }
+    redrawFooter();
 }
 
-int writePluginsFile(void) {
-    std::ofstream plugins_stream = std::ofstream(getRomfsPath(SKYRIM_PLUGINS_FILE),
-            std::ios::out | std::ios::trunc | std::ios::binary);
-    if (!plugins_stream.good()) {
-        FATAL("Failed to open Plugins file");
-        return -1;
+static void appendTimings(void) {
+    if (RC_SUCCESS(appendPhaseLog(getRomfsPath(PHASE_LOG_FILE).c_str()))) {
+        g_status_msg = "Appended timings to " PHASE_LOG_FILE;
+    } else {
+        g_status_msg = "Failed to write " PHASE_LOG_FILE;
     }
+    g_tmp_status = true;
+    redrawFooter();
+}
 
-    // write header that we loaded earlier
-    plugins_stream << g_plugins_header;
+static void clearTempEffects(void) {
+    g_dirty_warned = false;
 
-    for (std::shared_ptr<SkyrimMod> mod : getGlobalModList()) {
-        if (mod->has_esp) {
-            if (mod->esp_enabled) {
-                plugins_stream << '*';
-            }
-            if (mod->is_master) {
-                plugins_stream << mod->base_name << ".esm";
-            } else {
-                plugins_stream << mod->base_name << ".esp";
-            }
-            plugins_stream << '\n';
+    if (g_tmp_status || !g_lint_msg.empty()) {
+        if (g_tmp_status) {
+            g_status_msg = "";
+            g_tmp_status = false;
         }
+        g_lint_msg = "";
+        redrawFooter();
     }
+}
 
-    return 0;
+// Checks the whole list afresh, including masters once the plugin headers are read.
+static void lintAllMods(void) {
+    g_lint_masters = pollMasterGraph();
+    g_lint_msg = "";
+
+    PhaseTimer timer("lint");
+    g_linter.relintAll(g_lint_masters ? &waitForMasterGraph() : NULL);
 }
 
-int initialize(void) {
-    int rc;
+// Re-checks an edited mod and the plugins depending on it, pointing out
+// whatever the edit left broken. The mod must be the selected one.
+static void lintEdit(ModGui &gui, SkyrimMod const &mod) {
+    LintUpdate update = g_linter.relint(mod.getId());
+    if (update.changed > 0) {
+        gui.redraw();
+    } else {
+        gui.redrawCurrentRow();
+    }
 
-    CONSOLE_SET_POS(0, 0);
-    CONSOLE_CLEAR_SCREEN();
-    CONSOLE_SET_ATTRS(CONSOLE_ATTR_BOLD);
-    printf("Discovering available mods...\n");
+    std::string_view name = mod.getBaseName();
+    std::string issue = g_linter.describe(mod.getId());
+    char msg[CONSOLE_COLUMNS + 1];
+    if (!issue.empty()) {
+        snprintf(msg, sizeof(msg), "%.*s: %s", (int) name.size(), name.data(), issue.c_str());
+    } else if (update.broken_dependents > 0 && !mod.isEspEnabled()) {
+        snprintf(msg, sizeof(msg), "%.*s is disabled but is a master of %lu enabled plugin(s)",
+                (int) name.size(), name.data(), update.broken_dependents);
+    } else if (update.broken_dependents > 0) {
+        snprintf(msg, sizeof(msg), "%lu plugin(s) now load before their master %.*s",
+                update.broken_dependents, (int) name.size(), name.data());
+    } else {
+        msg[0] = '\0';
+    }
+    g_lint_msg = msg;
+    redrawFooter();
+}
 
-    if (RC_FAILURE(rc = discoverMods())) {
-        return rc;
+static void rescanMods(ModGui &gui) {
+    g_status_msg = "Rescanning data directory...";
+    redrawFooter();
+    g_renderer.present();
+    consoleUpdate(NULL);
+
+    RescanResult result;
+    int rc;
+    {
+        PhaseTimer timer("rescan");
+        rc = rescanDataDir(getRomfsPath(SKYRIM_DATA_DIR).c_str(), getGlobalModList(), &result);
+    }
+    if (RC_FAILURE(rc)) {
+        g_status_msg = "Failed to rescan data directory";
+        g_tmp_status = true;
+        redrawFooter();
+        return;
     }
 
-    if (RC_FAILURE(rc = processPluginsFile())) {
-        return rc;
+    if (result.added_mods > 0 || result.changed_mods > 0 || result.missing_mods > 0) {
+        g_dirty = true;
+        // the journal's entries may not apply to the rescanned mods
+        g_journal.clear();
     }
+    // plugins and archives may have been added, removed or replaced
+    queueMasterGraphLoad();
+    queueAssetIndexLoad();
+    // the masters are checked again once the new headers are read
+    lintAllMods();
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "Rescan complete: %lu new, %lu changed, %lu missing",
+            result.added_mods, result.changed_mods, result.missing_mods);
+    g_status_msg = msg;
+    g_tmp_status = true;
+
+    redrawSummary();
+    gui.redraw();
+    redrawFooter();
+}
 
-    if (RC_FAILURE(rc = parseInis(getGlobalModList(), g_mod_list_tmp))) {
-        return rc;
+// the save stage the footer last showed
+static SaveStage g_shown_save_stage = SaveStage::IDLE;
+
+static void saveChanges(void) {
+    if (RC_FAILURE(queueSave())) {
+        return;
     }
+    g_dirty = false;
+
+    g_status_msg = "Saving changes...";
+    g_tmp_status = false;
+    g_shown_save_stage = SaveStage::IDLE;
+    redrawFooter();
+}
 
-    for (std::shared_ptr<SkyrimMod> mod : g_mod_list_tmp) {
-        std::string mod_name = mod->base_name;
-        if (!find_mod(getGlobalModList(), mod_name)) {
-            getGlobalModList().insert(getGlobalModList().end(), mod);
+// Keeps the footer in step with the save worker: what it's writing while it
+// works, and what it wrote once it's done.
+static void updateSaveStatus(void) {
+    SaveResult result;
+    bool finished = false;
+    while (pollSave(&result)) {
+        if (RC_FAILURE(result.rc)) {
+            return;
         }
+        finished = true;
     }
 
-    printf("Identified %lu mods\n", getGlobalModList().size());
-
-    CONSOLE_MOVE_DOWN(3);
-    printf("Mod listing:\n\n");
-    for (auto it = getGlobalModList().cbegin(); it != getGlobalModList().cend(); it++) {
-        ModStatus status = (*it)->getStatus();
-        const char *status_str;
-        switch (status) {
-            case ModStatus::ENABLED:
-                status_str = "Enabled";
-                break;
-            case ModStatus::DISABLED:
-                status_str = "Disabled";
-                break;
-            case ModStatus::PARTIAL:
-                status_str = "Partial";
-                break;
-            default:
-                PANIC();
-                return -1;
+    if (!finished) {
+        SaveStage stage = getSaveStage();
+        // the footer is showing the load order editing hint meanwhile
+        if (stage != g_shown_save_stage && !g_edit_load_order) {
+            g_shown_save_stage = stage;
+            if (stage == SaveStage::PLUGINS) {
+                g_status_msg = "Saving changes... (writing " SKYRIM_PLUGINS_FILE ")";
+                redrawFooter();
+            } else if (stage == SaveStage::INIS) {
+                g_status_msg = "Saving changes... (writing INIs)";
+                redrawFooter();
+            }
         }
-        printf("  - %s (%s)\n", (*it)->base_name.c_str(), status_str);
+        return;
     }
 
-    return 0;
-}
+    // a later save still being written will report in turn
+    if (isSaveQueued()) {
+        return;
+    }
 
-static void redrawHeader(void) {
-    CONSOLE_SET_POS(0, 0);
-    CONSOLE_CLEAR_LINE();
-    CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_CYAN);
-    printf("SkyMM-NX v" STRINGIZE(__VERSION) " by caseif");
-    CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_WHITE);
-
-    CONSOLE_MOVE_DOWN(2);
-    CONSOLE_MOVE_LEFT(255);
-    printf(HRULE);
+    bool wrote_plugins = result.wrote_plugins;
+    int wrote_inis = result.wrote_inis;
+    if (wrote_plugins || wrote_inis) {
+        std::string written_files;
+        if (wrote_plugins) {
+            written_files += SKYRIM_PLUGINS_FILE;
+        }
+        if (wrote_inis & INI_WROTE_SKYRIM) {
+            written_files += written_files.empty() ? "" : ", ";
+            written_files += SKYRIM_INI_FILE;
+        }
+        if (wrote_inis & INI_WROTE_SKYRIM_LANG) {
+            std::string lang_ini_path;
+            getLangIniPath(lang_ini_path);
+            written_files += written_files.empty() ? "" : ", ";
+            written_files += lang_ini_path.substr(lang_ini_path.find_last_of('/') + 1);
+        }
+
+        char msg[80];
+        snprintf(msg, sizeof(msg), "Wrote %s (%lu bytes in %lu ms)",
+                written_files.c_str(), result.plugins_bytes + result.inis_bytes, result.total_ns / 1000000);
+        g_status_msg = msg;
+    } else {
+        g_status_msg = "No changes to write";
+    }
+    g_tmp_status = true;
+    g_shown_save_stage = SaveStage::IDLE;
+    redrawFooter();
 }
 
-static void redrawFooter() {
-    CONSOLE_SET_POS(39, 0);
-    CONSOLE_CLEAR_LINE();
-    printf(HRULE);
-    CONSOLE_MOVE_LEFT(255);
-    CONSOLE_MOVE_DOWN(1);
-
-    CONSOLE_MOVE_DOWN(1);
-    CONSOLE_CLEAR_LINE();
-    if (!g_status_msg.empty()) {
-        CONSOLE_SET_ATTRS(CONSOLE_ATTR_NONE);
-        CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_YELLOW);
-        printf(g_status_msg.c_str());
-        CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_WHITE);
-        CONSOLE_SET_ATTRS(CONSOLE_ATTR_BOLD);
-    }
-    CONSOLE_MOVE_LEFT(255);
-
-    CONSOLE_MOVE_DOWN(1);
-    CONSOLE_CLEAR_LINE();
-
-    CONSOLE_MOVE_DOWN(1);
-    CONSOLE_CLEAR_LINE();
-    CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_GREEN);
-    printf("(Up/Down) Navigate  |  (A) Toggle Mod  |  (Y) (hold) Change Load Order");
-    CONSOLE_MOVE_LEFT(255);
-    CONSOLE_MOVE_DOWN(1);
-    printf("(-) Save Changes    |  (+) Exit");
-    CONSOLE_SET_COLOR(CONSOLE_COLOR_FG_WHITE);
+// Shows a note in the footer if there are no mods to act on.
+static bool checkHasMods(void) {
+    if (!getGlobalModList().empty()) {
+        return true;
+    }
+
+    g_status_msg = "No mods installed";
+    g_tmp_status = true;
+    redrawFooter();
+    return false;
 }
 
-static void clearTempEffects(void) {
-    g_dirty_warned = false;
+static void toggleSelectedMod(ModGui &gui) {
+    if (!checkHasMods()) {
+        return;
+    }
 
-    if (g_tmp_status) {
-        g_status_msg = "";
-        g_tmp_status = false;
-        redrawFooter();
+    SkyrimMod mod = gui.getSelectedMod();
+    if (mod.isMissing()) {
+        return;
     }
+
+    g_journal.toggle(mod);
+    g_dirty = true;
+
+    redrawSummary();
+
+    clearTempEffects();
+    lintEdit(gui, mod);
 }
 
-void handleScrollHold(u64 kDown, u64 kHeld, HidNpadButton key, ModGui &gui) {
-    if (kHeld & key && !(kDown & key)) {
-        u64 period = g_scroll_initial_cooldown ? SCROLL_INITIAL_DELAY : SCROLL_INTERVAL;
-
-        if (_nanotime() - g_last_scroll_time >= period) {
-            g_last_scroll_time = _nanotime();
-            g_scroll_initial_cooldown = false;
-
-            if (g_edit_load_order) {
-                if (gui.getSelectedIndex() < getGlobalModList().size() - 1) {
-                    if (g_scroll_dir == 1) {
-                        gui.getSelectedMod()->loadLater();
-                    } else {
-                        gui.getSelectedMod()->loadSooner();
-                    }
-                    g_dirty = true;
-                }
-            }
+// Sorts the load order so every plugin follows its masters, as (Y)+(X) does.
+static void autoSortMods(ModGui &gui) {
+    if (!pollMasterGraph()) {
+        g_status_msg = "Reading plugin headers...";
+        redrawFooter();
+        g_renderer.present();
+        consoleUpdate(NULL);
+    }
+    MasterGraph const &graph = waitForMasterGraph();
 
-            gui.scrollSelection(g_scroll_dir);
+    LoadOrderSortResult result;
+    std::vector<ModId> order;
+    {
+        PhaseTimer timer("sort");
+        sortLoadOrder(getGlobalModList(), graph, order, &result);
+    }
 
-            clearTempEffects();
+    if (result.moved > 0) {
+        std::vector<ModId> previous = getGlobalModList().getIds();
+        getGlobalModList().reorder(order);
+        g_journal.recordReorder(previous);
+        g_dirty = true;
+        lintAllMods();
+        gui.redraw();
+    }
+
+    char msg[CONSOLE_COLUMNS + 1];
+    if (!result.cycles.empty()) {
+        // the first cycle is usually enough to track down the plugins at fault
+        std::string cycle;
+        for (ModId id : result.cycles[0]) {
+            cycle += cycle.empty() ? "" : ", ";
+            cycle += getGlobalModStore().getBaseName(id);
         }
+        snprintf(msg, sizeof(msg), "%lu master cycle(s), e.g. %s", result.cycle_count, cycle.c_str());
+    } else {
+        snprintf(msg, sizeof(msg), "Sorted load order, %lu of %lu plugins moved", result.moved, result.plugins);
     }
+    g_status_msg = msg;
+    g_tmp_status = true;
+    redrawFooter();
 }
 
-int main(int argc, char **argv) {
-    consoleInit(NULL);
+// Sums up which mods the selected mod's archives override and are overridden
+// by, as (B) does.
+static void showConflicts(ModGui &gui) {
+    if (!checkHasMods()) {
+        return;
+    }
 
-    ModGui gui = ModGui(getGlobalModList(), HEADER_HEIGHT, CONSOLE_LINES - HEADER_HEIGHT - FOOTER_HEIGHT);
-    
-    padConfigureInput(1, HidNpadStyleSet_NpadStandard);
-    PadState defaultPad;
-    padInitializeDefault(&defaultPad);
+    SkyrimMod mod = gui.getSelectedMod();
+    if (!mod.hasEnabledBsas()) {
+        g_status_msg = "Mod has no enabled archives";
+        g_tmp_status = true;
+        redrawFooter();
+        return;
+    }
 
-    int init_status = initialize();
-    if (RC_SUCCESS(init_status)) {
-        CONSOLE_CLEAR_SCREEN();
+    if (!pollAssetIndex()) {
+        g_status_msg = "Reading archive directories...";
+        redrawFooter();
+        g_renderer.present();
+        consoleUpdate(NULL);
+    }
+    AssetIndex const &index = waitForAssetIndex();
 
-        redrawHeader();
+    std::vector<AssetConflict> conflicts;
+    AssetConflictStats stats;
+    {
+        PhaseTimer timer("conflicts");
+        findAssetConflicts(getGlobalModList(), index, conflicts, &stats);
+    }
+
+    size_t won_mods = 0;
+    size_t won_assets = 0;
+    size_t lost_mods = 0;
+    size_t lost_assets = 0;
+    // the mod overriding the most of this one's assets
+    AssetConflict const *top_winner = NULL;
+    for (AssetConflict const &conflict : conflicts) {
+        if (conflict.winner == mod.getId()) {
+            won_mods++;
+            won_assets += conflict.assets;
+        } else if (conflict.loser == mod.getId()) {
+            lost_mods++;
+            lost_assets += conflict.assets;
+            if (top_winner == NULL || conflict.assets > top_winner->assets) {
+                top_winner = &conflict;
+            }
+        }
+    }
+
+    char msg[CONSOLE_COLUMNS + 1];
+    if (won_mods == 0 && lost_mods == 0) {
+        snprintf(msg, sizeof(msg), "No conflicts with other mods' archives");
+    } else if (lost_mods == 0) {
+        snprintf(msg, sizeof(msg), "Overrides %lu mod(s) (%lu assets), overridden by none", won_mods, won_assets);
+    } else {
+        std::string top_name(getGlobalModStore().getBaseName(top_winner->winner));
+        snprintf(msg, sizeof(msg), "Overrides %lu mod(s) (%lu assets), overridden by %lu (%lu), most by %s",
+                won_mods, won_assets, lost_mods, lost_assets, top_name.c_str());
+    }
+    g_status_msg = msg;
+    g_tmp_status = true;
+    redrawFooter();
+}
+
+static void stepJournal(ModGui &gui, bool redo) {
+    JournalEntry const *entry = redo ? g_journal.redo() : g_journal.undo();
+    if (entry == NULL) {
+        g_status_msg = redo ? "Nothing to redo" : "Nothing to undo";
+        g_tmp_status = true;
+        redrawFooter();
+        return;
+    }
+    g_dirty = true;
+
+    if (entry->op == JournalOp::REORDER) {
+        lintAllMods();
         gui.redraw();
+        g_status_msg = redo ? "Redid auto-sort" : "Undid auto-sort";
+        g_tmp_status = true;
         redrawFooter();
+        return;
     }
 
-    while (appletMainLoop()) {
-        padUpdate(&defaultPad);
+    // follow the mod the entry concerns
+    SkyrimMod mod;
+    const char *action;
+    if (entry->op == JournalOp::MOVE) {
+        size_t index = redo ? entry->arg : entry->target;
+        gui.selectIndex(index);
+        mod = getGlobalModList().at(index);
+        action = "move of";
+    } else {
+        mod = SkyrimMod(&getGlobalModStore(), entry->target);
+        gui.selectIndex(getGlobalModList().indexOf(mod.getBaseName()));
+        action = entry->op == JournalOp::ENABLE ? "enabling" : "disabling";
+    }
+    redrawSummary();
+
+    std::string_view name = mod.getBaseName();
+    char msg[CONSOLE_COLUMNS + 1];
+    snprintf(msg, sizeof(msg), "%s %s %.*s", redo ? "Redid" : "Undid", action, (int) name.size(), name.data());
+    g_status_msg = msg;
+    g_tmp_status = true;
+    lintEdit(gui, mod);
+}
 
-        u64 kDown = padGetButtonsDown(&defaultPad);
-        u64 kUp = padGetButtonsUp(&defaultPad);
-        u64 kHeld = padGetButtons(&defaultPad);
+// Handles a single input event. Returns false if the app should exit.
+static bool handleInput(InputEvent const &event, ModGui &gui, bool active) {
+    if (event.type == InputEventType::PRESS && event.button == HidNpadButton_Plus) {
+        if (fatal_occurred()) {
+            // the error screen asks for (+) to exit, whatever is left unsaved
+            return false;
+        }
 
-        if (kDown & HidNpadButton_Plus) {
-            if (g_dirty && !g_dirty_warned) {
-                g_status_msg = "Press (+) to exit without saving changes";
-                g_tmp_status = true;
-                g_dirty_warned = true;
-                redrawFooter();
-            } else {
-                break;
+        if (isSaveQueued()) {
+            // let the save finish rather than cut it off, and stay to show it if it failed
+            g_status_msg = "Finishing save before exiting...";
+            redrawFooter();
+            g_renderer.present();
+            consoleUpdate(NULL);
+
+            waitForSaves();
+            updateSaveStatus();
+            if (fatal_occurred()) {
+                return true;
             }
         }
 
-        if (RC_FAILURE(init_status) || fatal_occurred()) {
-            consoleUpdate(NULL);
-            continue;
+        if (g_dirty && !g_dirty_warned) {
+            g_status_msg = "Press (+) to exit without saving changes";
+            g_tmp_status = true;
+            g_dirty_warned = true;
+            redrawFooter();
+            return true;
+        } else {
+            return false;
         }
+    }
 
-        if (kDown & g_key_edit_lo) {
+    if (!active) {
+        return true;
+    }
+
+    if (event.button & TIMINGS_COMBO) {
+        if (event.type == InputEventType::RELEASE) {
+            g_timings_combo_latched = false;
+        } else if ((g_input.getHeld() & TIMINGS_COMBO) == TIMINGS_COMBO && !g_timings_combo_latched) {
+            g_timings_combo_latched = true;
+            toggleTimings(gui);
+        }
+        return true;
+    }
+
+    // the timings overlay covers the list, so nothing else acts on it while shown
+    if (g_show_timings) {
+        if (event.type == InputEventType::PRESS && event.button == HidNpadButton_A) {
+            appendTimings();
+        }
+        return true;
+    }
+
+    if (event.button == g_key_edit_lo) {
+        if (event.type == InputEventType::PRESS) {
             g_edit_load_order = true;
-            g_status_msg = "Editing load order";
+            g_status_msg = "Editing load order  |  (Left/Right) Move to Top/Bottom  |  (X) Auto-sort";
             redrawFooter();
-        }
-        
-        if (kUp & g_key_edit_lo) {
+        } else if (event.type == InputEventType::RELEASE) {
             g_edit_load_order = false;
             g_status_msg = "";
             redrawFooter();
         }
+        return true;
+    }
+
+    if (event.type == InputEventType::RELEASE) {
+        return true;
+    }
 
-        if ((kUp & HidNpadButton_AnyDown) && g_scroll_dir == 1) {
-            g_scroll_dir = 0;
-        } else if ((kUp & HidNpadButton_AnyUp) && g_scroll_dir == -1) {
-            g_scroll_dir = 0;
+    // undo and redo repeat while held, so a run of edits can be stepped through quickly
+    if (event.button & UNDO_BUTTONS) {
+        stepJournal(gui, event.button == HidNpadButton_R);
+        return true;
+    }
+
+    // up/down are the only other buttons which repeat
+    if (event.button & (HidNpadButton_AnyUp | HidNpadButton_AnyDown)) {
+        int delta = (event.button & HidNpadButton_AnyDown) ? 1 : -1;
+        bool moved = false;
+        if (g_edit_load_order) {
+            size_t from = gui.getSelectedIndex();
+            moved = gui.moveSelection(delta);
+            if (moved) {
+                g_journal.recordMove(from, gui.getSelectedIndex());
+                g_dirty = true;
+            }
+        } else {
+            gui.scrollSelection(delta);
         }
 
-        switch (g_scroll_dir) {
-            case -1:
-                handleScrollHold(kDown, kHeld, HidNpadButton_AnyUp, gui);
-                break;
-            case 1:
-                handleScrollHold(kDown, kHeld, HidNpadButton_AnyDown, gui);
-                break;
-            default:
-                break;
+        clearTempEffects();
+        if (moved) {
+            lintEdit(gui, gui.getSelectedMod());
         }
+        return true;
+    }
 
-        if (kDown & HidNpadButton_AnyDown) {
-            if (g_edit_load_order) {
-                if (gui.getSelectedIndex() < getGlobalModList().size() - 1) {
-                    gui.getSelectedMod()->loadLater();
-                    g_dirty = true;
-                }
-            }
+    if (event.type != InputEventType::PRESS) {
+        return true;
+    }
+
+    if ((event.button & (HidNpadButton_AnyLeft | HidNpadButton_AnyRight)) && g_edit_load_order) {
+        size_t target = (event.button & HidNpadButton_AnyLeft) ? 0 : getGlobalModList().size() - 1;
+        size_t from = gui.getSelectedIndex();
+        bool moved = gui.moveSelectionTo(target);
+        if (moved) {
+            g_journal.recordMove(from, target);
+            g_dirty = true;
+        }
+
+        clearTempEffects();
+        if (moved) {
+            lintEdit(gui, gui.getSelectedMod());
+        }
+    } else if (event.button == HidNpadButton_X && g_edit_load_order) {
+        autoSortMods(gui);
+    } else if (event.button == HidNpadButton_X) {
+        rescanMods(gui);
+    } else if (event.button == HidNpadButton_A) {
+        toggleSelectedMod(gui);
+    } else if (event.button == HidNpadButton_B) {
+        showConflicts(gui);
+    } else if (event.button == HidNpadButton_Minus) {
+        saveChanges();
+    }
+
+    return true;
+}
+
+// Sleeps until the next frame is due or the next key repeat fires, whichever
+// comes first, so an idle app doesn't spin.
+static void waitForNextFrame(u64 frame_start) {
+    u64 deadline = MIN(frame_start + FRAME_INTERVAL, g_input.nextDeadline());
+    u64 now = _nanotime();
+    if (deadline > now) {
+        svcSleepThread(deadline - now);
+    }
+}
+
+int main(int argc, char **argv) {
+    consoleInit(NULL);
+
+    ModGui gui = ModGui(getGlobalModList(), g_renderer, HEADER_HEIGHT, CONSOLE_LINES - HEADER_HEIGHT - FOOTER_HEIGHT);
+    gui.setLinter(&g_linter);
+    
+    padConfigureInput(1, HidNpadStyleSet_NpadStandard);
+    PadState defaultPad;
+    padInitializeDefault(&defaultPad);
+
+    int init_status = initialize();
+    if (RC_SUCCESS(init_status)) {
+        lintAllMods();
+
+        CONSOLE_CLEAR_SCREEN();
+        g_renderer.invalidate(true);
+
+        redrawHeader();
+        gui.redraw();
+        redrawFooter();
+    }
+    consoleUpdate(NULL);
 
-            g_last_scroll_time = _nanotime();
-            g_scroll_initial_cooldown = true;
-            g_scroll_dir = 1;
+    std::vector<InputEvent> events;
+    bool running = true;
+    while (running && appletMainLoop()) {
+        padUpdate(&defaultPad);
 
-            gui.scrollSelection(1);
+        u64 frame_start = _nanotime();
+        events.clear();
+        g_input.update(padGetButtons(&defaultPad), frame_start, events);
 
-            clearTempEffects();
-        } else if (kDown & HidNpadButton_AnyUp) {
-            if (g_edit_load_order) {
-                if (gui.getSelectedIndex() > 0) {
-                    gui.getSelectedMod()->loadSooner();
-                    g_dirty = true;
+        if (RC_SUCCESS(init_status) && !fatal_occurred()) {
+            updateSaveStatus();
+            if (pollMasterGraph() && !g_lint_masters) {
+                lintAllMods();
+                if (!g_show_timings) {
+                    gui.redraw();
                 }
+                redrawFooter();
             }
+            pollAssetIndex();
+        }
 
-            g_last_scroll_time = _nanotime();
-            g_scroll_initial_cooldown = true;
-            g_scroll_dir = -1;
-
-            gui.scrollSelection(-1);
-
-            clearTempEffects();
-        } else if (kDown & HidNpadButton_A) {
-            std::shared_ptr<SkyrimMod> mod = gui.getSelectedMod();
-            switch (mod->getStatus()) {
-                case ModStatus::ENABLED:
-                    mod->disable();
-                    break;
-                case ModStatus::PARTIAL:
-                case ModStatus::DISABLED:
-                    mod->enable();
-                    break;
-                default:
-                    PANIC();
+        bool active = RC_SUCCESS(init_status) && !fatal_occurred();
+        for (InputEvent const &event : events) {
+            if (!handleInput(event, gui, active)) {
+                running = false;
+                break;
             }
-            g_dirty = true;
-
-            gui.redrawCurrentRow();
-
-            clearTempEffects();
         }
 
-        if (kDown & HidNpadButton_Minus) {
-            g_status_msg = "Saving changes...";
-            redrawFooter();
+        if (!active) {
+            // anything shown in this state was printed directly rather than through the renderer
+            consoleUpdate(NULL);
+        } else if (g_renderer.present() > 0) {
+            // only present a frame when something actually changed
             consoleUpdate(NULL);
-
-            writePluginsFile();
-            writeIniChanges();
-            g_dirty = false;
-
-            g_status_msg = "Wrote changes to SDMC!";
-            g_tmp_status = true;
-            redrawFooter();
         }
 
-        consoleUpdate(NULL);
+        waitForNextFrame(frame_start);
     }
 
+    // the app may be closed from the home menu mid-save
+    waitForSaves();
+    // or before the master graph and asset index are built, whose caches are only written at the end
+    waitForMasterGraph();
+    waitForAssetIndex();
+
     consoleExit(NULL);
     return 0;
 }
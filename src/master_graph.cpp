@@ -0,0 +1,232 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "master_graph.hpp"
+
+#include "file_helper.hpp"
+#include "plugin_header.hpp"
+#include "snapshot_io.hpp"
+#include "string_helper.hpp"
+#include "task_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Cache layout (native byte order):
+//
+//   u32 magic, u32 version
+//   u32 plugin count, then per plugin:
+//     str file name, i64 mtime, i64 size, u8 status
+//     u32 record flags, u32 master count, then per master: str file name
+//
+// where str is a u32 length followed by that many bytes (see SnapshotWriter).
+
+struct CachedHeader {
+    FileStamp stamp;
+    PluginHeaderStatus status;
+    PluginHeader header;
+};
+
+typedef std::unordered_map<std::string, CachedHeader, FoldedHash, FoldedEqual> HeaderCache;
+
+// Reads the cache into cache, which is left empty if the cache is missing or
+// malformed.
+static void readHeaderCache(std::string const &path, HeaderCache &cache, size_t *bytes_read) {
+    std::string data;
+    if (readFileUntracked(path.c_str(), data) != 0) {
+        return;
+    }
+    *bytes_read += data.size();
+
+    SnapshotReader reader(data);
+    if (reader.get<uint32_t>() != PLUGIN_CACHE_MAGIC || reader.get<uint32_t>() != PLUGIN_CACHE_VERSION) {
+        return;
+    }
+
+    uint32_t count = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < count && reader.good(); i++) {
+        std::string_view name = reader.getString();
+        CachedHeader entry;
+        entry.stamp.mtime = reader.get<int64_t>();
+        entry.stamp.size = reader.get<int64_t>();
+        uint8_t status = reader.get<uint8_t>();
+        entry.status = (PluginHeaderStatus) status;
+        entry.header.flags = reader.get<uint32_t>();
+
+        uint32_t master_count = reader.get<uint32_t>();
+        for (uint32_t j = 0; j < master_count && reader.good(); j++) {
+            entry.header.masters.insert(entry.header.masters.end(), std::string(reader.getString()));
+        }
+
+        if (!reader.good() || status > (uint8_t) PluginHeaderStatus::MALFORMED) {
+            break;
+        }
+        cache[std::string(name)] = std::move(entry);
+    }
+
+    if (!reader.good() || !reader.atEnd()) {
+        cache.clear();
+    }
+}
+
+void MasterGraph::clear(void) {
+    nodes.clear();
+    index.clear();
+}
+
+int MasterGraph::load(std::string const &data_dir, std::vector<std::string> const &file_names,
+        std::string const &cache_path, size_t worker_count, MasterGraphStats *stats) {
+    *stats = MasterGraphStats();
+    clear();
+
+    HeaderCache cache;
+    readHeaderCache(cache_path, cache, &stats->bytes_read);
+
+    nodes.resize(file_names.size());
+    // bytes read from each plugin, or -1 if its header wasn't read
+    std::vector<int64_t> read_sizes(file_names.size(), -1);
+
+    {
+        // each worker fills in its own slice of nodes, and only reads the cache
+        TaskPool pool(worker_count);
+        for (size_t start = 0; start < nodes.size(); start += MASTER_GRAPH_BATCH) {
+            size_t end = std::min(start + MASTER_GRAPH_BATCH, nodes.size());
+            pool.submit([&, start, end]() {
+                for (size_t i = start; i < end; i++) {
+                    Node &node = nodes[i];
+                    node.file_name = file_names[i];
+                    node.header = PluginHeader();
+
+                    std::string path = data_dir + "/" + node.file_name;
+                    if (statFile(path.c_str(), &node.stamp) != 0) {
+                        node.stamp = FileStamp();
+                        node.status = PluginHeaderStatus::MISSING;
+                        continue;
+                    }
+
+                    // without an mtime a cached header can't be told apart from a stale one
+                    auto it = cache.find(node.file_name);
+                    if (it != cache.end() && node.stamp.mtime != 0 && it->second.stamp.mtime == node.stamp.mtime
+                            && it->second.stamp.size == node.stamp.size) {
+                        node.status = it->second.status;
+                        node.header = it->second.header;
+                        continue;
+                    }
+
+                    size_t bytes_read = 0;
+                    int rc = readPluginHeader(path.c_str(), &node.header, &bytes_read);
+                    read_sizes[i] = bytes_read;
+                    node.status = rc == 0 ? PluginHeaderStatus::OK : PluginHeaderStatus::MALFORMED;
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    stats->plugins = nodes.size();
+    index.reserve(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        index.emplace(nodes[i].file_name, i);
+
+        if (read_sizes[i] >= 0) {
+            stats->read++;
+            stats->bytes_read += read_sizes[i];
+        } else if (nodes[i].status != PluginHeaderStatus::MISSING) {
+            stats->cached++;
+        }
+        if (nodes[i].status != PluginHeaderStatus::OK) {
+            stats->failed++;
+        }
+    }
+
+    // a cache which already matches the graph exactly doesn't need rewriting
+    if (stats->read == 0 && stats->cached == cache.size()) {
+        return 0;
+    }
+
+    std::string data;
+    SnapshotWriter writer(data);
+    writer.put<uint32_t>(PLUGIN_CACHE_MAGIC);
+    writer.put<uint32_t>(PLUGIN_CACHE_VERSION);
+
+    size_t count_off = data.size();
+    uint32_t count = 0;
+    writer.put<uint32_t>(0);
+    for (Node const &node : nodes) {
+        if (node.status == PluginHeaderStatus::MISSING || node.stamp.mtime == 0) {
+            continue;
+        }
+
+        writer.putString(node.file_name);
+        writer.put<int64_t>(node.stamp.mtime);
+        writer.put<int64_t>(node.stamp.size);
+        writer.put<uint8_t>((uint8_t) node.status);
+        writer.put<uint32_t>(node.header.flags);
+        writer.put<uint32_t>(node.header.masters.size());
+        for (std::string const &master : node.header.masters) {
+            writer.putString(master);
+        }
+        count++;
+    }
+    memcpy(&data[count_off], &count, sizeof(count));
+
+    if (writeFileAtomicUntracked(cache_path.c_str(), data) != 0) {
+        return -1;
+    }
+    stats->bytes_written = data.size();
+
+    return 0;
+}
+
+size_t MasterGraph::size(void) const {
+    return nodes.size();
+}
+
+ptrdiff_t MasterGraph::indexOf(std::string_view file_name) const {
+    auto it = index.find(std::string(file_name));
+    return it != index.end() ? (ptrdiff_t) it->second : -1;
+}
+
+std::string const &MasterGraph::getFileName(size_t i) const {
+    return nodes[i].file_name;
+}
+
+PluginHeaderStatus MasterGraph::getStatus(size_t i) const {
+    return nodes[i].status;
+}
+
+PluginHeader const *MasterGraph::getHeader(size_t i) const {
+    return nodes[i].status == PluginHeaderStatus::OK ? &nodes[i].header : NULL;
+}
+
+PluginHeader const *MasterGraph::find(std::string_view file_name) const {
+    ptrdiff_t i = indexOf(file_name);
+    return i >= 0 ? getHeader(i) : NULL;
+}
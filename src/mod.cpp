@@ -32,70 +32,128 @@
 #include <memory>
 #include <string>
 
-static ModList g_mod_list;
+#include <cstring>
 
-ModFile ModFile::fromFileName(std::string const &file_name) {
+#define MIN(a, b) (a < b ? a : b)
+#define MAX(a, b) ((a > b) ? a : b)
+
+#define INDEX_SLOT_EMPTY UINT32_MAX
+#define INDEX_MIN_CAPACITY 64
+
+// large enough for any name a store accepts
+#define NAME_BLOCK_SIZE 65536
+
+static inline uint32_t packExtFolded(std::string_view ext) {
+    if (ext.size() != 3) {
+        return 0;
+    }
+    // folding with 0x20 only maps the uppercase forms onto the expected lowercase letters
+    return PACK_EXT(ext[0] | 0x20, ext[1] | 0x20, ext[2] | 0x20);
+}
+
+ModFileView ModFileView::classify(std::string_view file_name) {
     size_t dot_index = file_name.find_last_of('.');
-    if (dot_index == std::string::npos) {
-        return {ModFileType::UNKNOWN};
+    if (dot_index == std::string_view::npos) {
+        return {ModFileType::UNKNOWN, {}, {}};
+    }
+
+    std::string_view base = trimView(file_name.substr(0, dot_index));
+    std::string_view ext = trimView(file_name.substr(dot_index + 1));
+    std::string_view suffix;
+
+    ModFileType type;
+    switch (packExtFolded(ext)) {
+        case PACKED_EXT_ESP:
+            type = ModFileType::ESP;
+            break;
+        case PACKED_EXT_ESM:
+            type = ModFileType::ESM;
+            break;
+        case PACKED_EXT_BSA: {
+            type = ModFileType::BSA;
+            size_t dash_index = base.rfind(" - ");
+            if (dash_index != std::string_view::npos) {
+                suffix = base.substr(dash_index + 3);
+                base = base.substr(0, dash_index);
+            }
+            break;
+        }
+        default:
+            return {ModFileType::UNKNOWN, {}, {}};
     }
 
-    std::string base = file_name.substr(0, dot_index);
-    std::string ext = file_name.substr(dot_index + 1);
-    std::string suffix;
+    return {type, base, suffix};
+}
+
+ModFile ModFile::fromFileName(std::string const &file_name) {
+    ModFileView view = ModFileView::classify(file_name);
+    return {view.type, std::string(view.base_name), std::string(view.suffix)};
+}
 
-    base = trim(base);
-    ext = trim(ext);
+static const std::string_view g_bsa_suffix_names[BSA_SUFFIX_COUNT] = {
+    "",
+    "Animations",
+    "Meshes",
+    "Sounds",
+    "Textures",
+    "Voices"
+};
 
-    if (ext == EXT_BSA) {
-        size_t dash_index = base.rfind(" - ");
-        if (dash_index == std::string::npos) {
-            suffix = "";
-        } else {
-            suffix = base.substr(dash_index + 3);
-            base = base.substr(0, dash_index);
+BsaSuffix parseBsaSuffix(std::string_view suffix) {
+    for (uint8_t i = 0; i < BSA_SUFFIX_COUNT; i++) {
+        if (suffix == g_bsa_suffix_names[i]) {
+            return (BsaSuffix) i;
         }
-    } else if (ext == EXT_ESP || ext == EXT_ESM) {
-        suffix = "";
-    } else {
-        return {ModFileType::UNKNOWN};
     }
+    return BsaSuffix::OTHER;
+}
 
-    ModFileType type;
-    if (ext == EXT_ESM) {
-        type = ModFileType::ESM;
-    } else if (ext == EXT_ESP) {
-        type = ModFileType::ESP;
-    } else if (ext == EXT_BSA) {
-        type = ModFileType::BSA;
-    } else {
-        type = ModFileType::UNKNOWN;
+BsaSuffix classifyBsaSuffix(std::string_view suffix) {
+    // NONE is skipped since every suffix starts with the empty one
+    for (uint8_t i = 1; i < BSA_SUFFIX_COUNT; i++) {
+        if (suffix.substr(0, g_bsa_suffix_names[i].size()) == g_bsa_suffix_names[i]) {
+            return (BsaSuffix) i;
+        }
     }
+    return suffix.empty() ? BsaSuffix::NONE : BsaSuffix::OTHER;
+}
 
-    return {type, base, suffix};
+std::string_view getBsaSuffixName(BsaSuffix suffix) {
+    return suffix < BsaSuffix::OTHER ? g_bsa_suffix_names[(uint8_t) suffix] : std::string_view();
+}
+
+// the enabled count an archive gets from enabling its mod
+static inline uint8_t fullEnabledCount(BsaSuffix kind) {
+    return kind == BsaSuffix::ANIMATIONS ? BSA_ANIMATIONS_LISTS : 1;
 }
 
-ModStatus SkyrimMod::getStatus(void) {
-    bool esp_status = has_esp ? esp_enabled : true;
-    
+ModStatus SkyrimMod::computeStatus(void) const {
+    bool has_esp = hasEsp();
+    bool esp_status = has_esp ? isEspEnabled() : true;
+    BsaState const &bsas = getBsaState();
+
+    bool has_bsas = bsas.present != 0;
+    bool any_enabled = bsas.enabled != 0;
+    bool partial = bsas.enabled != bsas.present
+            || ((bsas.enabled & BSA_BIT(BsaSuffix::ANIMATIONS)) && bsas.animations != BSA_ANIMATIONS_LISTS);
+
+    if (hasFlag(MOD_EXTRA_BSAS)) {
+        for (ExtraBsa const &extra : *getExtraBsas()) {
+            bool enabled = extra.enabled_count > 0;
+            has_bsas |= extra.present;
+            any_enabled |= enabled;
+            partial |= extra.present != enabled
+                    || (enabled && extra.kind == BsaSuffix::ANIMATIONS && extra.enabled_count != BSA_ANIMATIONS_LISTS);
+        }
+    }
+
     ModStatus bsa_status;
-    if (bsa_suffixes.size() > 0 && enabled_bsas.size() == 0) {
+    if (has_bsas && !any_enabled) {
         bsa_status = ModStatus::DISABLED;
-    } else if (bsa_suffixes.size() != enabled_bsas.size()) {
+    } else if (partial) {
         bsa_status = ModStatus::PARTIAL;
     } else {
-        bool bad_anims = false;
-        for (auto bsa_pair : enabled_bsas) {
-            if (bsa_pair.first.find("Animations") == 0 && bsa_pair.second != 2) {
-                bsa_status = ModStatus::PARTIAL;
-                bad_anims = true;
-                break;
-            }
-        }
-
-        if (!bad_anims) {
-            bsa_status = ModStatus::ENABLED;
-        }
+        bsa_status = ModStatus::ENABLED;
     }
 
     switch (bsa_status) {
@@ -104,71 +162,565 @@ ModStatus SkyrimMod::getStatus(void) {
         case ModStatus::DISABLED:
             return (esp_status && has_esp) ? ModStatus::PARTIAL : ModStatus::DISABLED;
         case ModStatus::ENABLED:
-            return esp_status ? ModStatus::ENABLED : (bsa_suffixes.empty() ? ModStatus::DISABLED : ModStatus::PARTIAL);
+            return esp_status ? ModStatus::ENABLED : (has_bsas ? ModStatus::PARTIAL : ModStatus::DISABLED);
         default:
             PANIC();
             return ModStatus::DISABLED;
     }
 }
 
-void SkyrimMod::enable(void) {
-    enabled_bsas.clear();
-    for (std::string bsa : bsa_suffixes) {
-        int count = bsa.find("Animations") == 0 ? 2 : 1;
-        enabled_bsas.insert(std::pair(bsa, count));
+static inline size_t &getStatusCount(ModStatusCounts &counts, ModStatus status, bool missing) {
+    if (missing) {
+        return counts.missing;
+    }
+
+    switch (status) {
+        case ModStatus::ENABLED:
+            return counts.enabled;
+        case ModStatus::PARTIAL:
+            return counts.partial;
+        default:
+            return counts.disabled;
+    }
+}
+
+void SkyrimMod::refreshStatus(void) const {
+    ModStatusCounts &counts = store->status_counts;
+    uint8_t &flags = store->flags[id];
+    ModStatus &status = store->statuses[id];
+
+    if (flags & MOD_STATUS_COUNTED) {
+        getStatusCount(counts, status, flags & MOD_COUNTED_MISSING)--;
+    }
+
+    status = computeStatus();
+    bool missing = flags & MOD_MISSING;
+    getStatusCount(counts, status, missing)++;
+
+    flags = (flags & ~(MOD_STATUS_STALE | MOD_COUNTED_MISSING)) | MOD_STATUS_COUNTED
+            | (missing ? MOD_COUNTED_MISSING : 0);
+}
+
+void SkyrimMod::enable(void) const {
+    BsaState &bsas = editBsaState();
+    bsas.enabled = bsas.present;
+    bsas.animations = (bsas.present & BSA_BIT(BsaSuffix::ANIMATIONS)) ? BSA_ANIMATIONS_LISTS : 0;
+
+    if (hasFlag(MOD_EXTRA_BSAS)) {
+        for (ExtraBsa &extra : *findExtraBsas()) {
+            extra.enabled_count = extra.present ? fullEnabledCount(extra.kind) : 0;
+        }
+    }
+
+    if (hasEsp()) {
+        setEspEnabled(true);
+    }
+}
+
+void SkyrimMod::disable(void) const {
+    BsaState &bsas = editBsaState();
+    bsas.enabled = 0;
+    bsas.animations = 0;
+
+    if (hasFlag(MOD_EXTRA_BSAS)) {
+        for (ExtraBsa &extra : *findExtraBsas()) {
+            extra.enabled_count = 0;
+        }
+    }
+
+    setEspEnabled(false);
+}
+
+std::vector<ExtraBsa> *SkyrimMod::findExtraBsas(void) const {
+    if (!hasFlag(MOD_EXTRA_BSAS)) {
+        return NULL;
+    }
+
+    auto it = store->extra_bsas.find(id);
+    if (it == store->extra_bsas.end()) {
+        PANIC();
+        return NULL;
     }
+    return &it->second;
+}
 
-    if (has_esp) {
-        esp_enabled = true;
+ExtraBsa &SkyrimMod::getExtraBsa(std::string_view suffix) const {
+    std::vector<ExtraBsa> &extras = store->extra_bsas[id];
+    setFlag(MOD_EXTRA_BSAS, true);
+    invalidateStatus();
+
+    auto it = std::lower_bound(extras.begin(), extras.end(), suffix,
+            [](ExtraBsa const &extra, std::string_view suffix) { return extra.suffix < suffix; });
+    if (it == extras.end() || it->suffix != suffix) {
+        it = extras.insert(it, ExtraBsa {std::string(suffix), classifyBsaSuffix(suffix), false, 0});
     }
+    return *it;
 }
 
-void SkyrimMod::disable(void) {
-    enabled_bsas.clear();
-    esp_enabled = false;
+std::string SkyrimMod::getPluginFileName(void) const {
+    std::string file_name(getBaseName());
+    file_name += isMaster() ? "." EXT_ESM : "." EXT_ESP;
+    return file_name;
 }
 
-void SkyrimMod::loadSooner(void) {
-    for (auto it = g_mod_list.begin(); it != g_mod_list.end(); it++) {
-        if ((*it)->base_name == this->base_name) {
-            if (it == g_mod_list.begin()) {
-                // mod is already first, nothing to do
-                return;
-            } else {
-                // swap it with the previous mod
-                std::iter_swap(it, it - 1);
-                return;
+std::string SkyrimMod::getArchiveFileName(std::string_view suffix) const {
+    std::string file_name(getBaseName());
+    if (!suffix.empty()) {
+        file_name += " - ";
+        file_name += suffix;
+    }
+    file_name += "." EXT_BSA;
+    return file_name;
+}
+
+void SkyrimMod::getArchiveFileNames(std::vector<std::string> &file_names) const {
+    uint8_t present = getBsaState().present;
+    for (uint8_t i = 0; i < BSA_SUFFIX_COUNT; i++) {
+        if (present & BSA_BIT((BsaSuffix) i)) {
+            file_names.insert(file_names.end(), getArchiveFileName(getBsaSuffixName((BsaSuffix) i)));
+        }
+    }
+
+    if (hasFlag(MOD_EXTRA_BSAS)) {
+        for (ExtraBsa const &extra : *getExtraBsas()) {
+            if (extra.present) {
+                file_names.insert(file_names.end(), getArchiveFileName(extra.suffix));
             }
         }
     }
 }
 
-void SkyrimMod::loadLater(void) {
-    for (auto it = g_mod_list.begin(); it != g_mod_list.end(); it++) {
-        if ((*it)->base_name == this->base_name) {
-            if (it == g_mod_list.end() - 1) {
-                // mod is already last, nothing to do
-                return;
-            } else {
-                // swap it with the next mod
-                std::iter_swap(it, it + 1);
-                return;
+bool SkyrimMod::hasBsas(void) const {
+    if (getBsaState().present != 0) {
+        return true;
+    }
+
+    if (hasFlag(MOD_EXTRA_BSAS)) {
+        for (ExtraBsa const &extra : *getExtraBsas()) {
+            if (extra.present) {
+                return true;
             }
         }
     }
+    return false;
 }
 
-ModList &getGlobalModList(void) {
-    return g_mod_list;
+bool SkyrimMod::hasEnabledBsas(void) const {
+    if (getBsaState().enabled != 0) {
+        return true;
+    }
+
+    if (hasFlag(MOD_EXTRA_BSAS)) {
+        for (ExtraBsa const &extra : *getExtraBsas()) {
+            if (extra.enabled_count > 0) {
+                return true;
+            }
+        }
+    }
+    return false;
 }
 
-std::shared_ptr<SkyrimMod> find_mod(ModList const &mod_list, std::string const &name) {
-    std::shared_ptr<SkyrimMod> mod;
-    for (std::shared_ptr<SkyrimMod> entry : mod_list) {
-        if (entry->base_name == name) {
-            mod = entry;
-            break;
+bool SkyrimMod::isBsaEnabled(std::string_view suffix) const {
+    BsaSuffix kind = parseBsaSuffix(suffix);
+    if (kind != BsaSuffix::OTHER) {
+        return (getBsaState().enabled & BSA_BIT(kind)) != 0;
+    }
+
+    if (hasFlag(MOD_EXTRA_BSAS)) {
+        for (ExtraBsa const &extra : *getExtraBsas()) {
+            if (extra.suffix == suffix) {
+                return extra.enabled_count > 0;
+            }
         }
     }
+    return false;
+}
+
+void SkyrimMod::addBsa(std::string_view suffix) const {
+    BsaSuffix kind = parseBsaSuffix(suffix);
+    if (kind != BsaSuffix::OTHER) {
+        editBsaState().present |= BSA_BIT(kind);
+    } else {
+        getExtraBsa(suffix).present = true;
+    }
+}
+
+void SkyrimMod::registerBsa(std::string_view suffix) const {
+    BsaSuffix kind = parseBsaSuffix(suffix);
+    if (kind != BsaSuffix::OTHER) {
+        BsaState &bsas = editBsaState();
+        bsas.enabled |= BSA_BIT(kind);
+        if (kind == BsaSuffix::ANIMATIONS && bsas.animations < UINT8_MAX) {
+            bsas.animations++;
+        }
+    } else {
+        ExtraBsa &extra = getExtraBsa(suffix);
+        if (extra.enabled_count < UINT8_MAX) {
+            extra.enabled_count++;
+        }
+    }
+}
+
+void SkyrimMod::clearBsas(void) const {
+    editBsaState() = {0, 0, 0};
+    if (hasFlag(MOD_EXTRA_BSAS)) {
+        store->extra_bsas.erase(id);
+        setFlag(MOD_EXTRA_BSAS, false);
+    }
+}
+
+bool SkyrimMod::reconcileBsas(SkyrimMod const &scanned) const {
+    BsaState &bsas = editBsaState();
+    uint8_t scanned_present = scanned.getBsaState().present;
+
+    uint8_t gone = bsas.present & ~scanned_present;
+    bool changed = bsas.present != scanned_present;
+    bsas.present = scanned_present;
+    bsas.enabled &= ~gone;
+    if (gone & BSA_BIT(BsaSuffix::ANIMATIONS)) {
+        bsas.animations = 0;
+    }
+
+    std::vector<ExtraBsa> *extras = findExtraBsas();
+    std::vector<ExtraBsa> const *scanned_extras = scanned.getExtraBsas();
+    if (extras) {
+        // drop archives which are gone, keeping the enabled state of the rest
+        for (ExtraBsa &extra : *extras) {
+            if (!extra.present) {
+                continue;
+            }
+
+            bool found = false;
+            if (scanned_extras) {
+                for (ExtraBsa const &scanned_extra : *scanned_extras) {
+                    if (scanned_extra.present && scanned_extra.suffix == extra.suffix) {
+                        found = true;
+                        break;
+                    }
+                }
+            }
+            if (!found) {
+                extra.present = false;
+                extra.enabled_count = 0;
+                changed = true;
+            }
+        }
+    }
+
+    if (scanned_extras) {
+        for (ExtraBsa const &scanned_extra : *scanned_extras) {
+            if (!scanned_extra.present) {
+                continue;
+            }
+
+            ExtraBsa &extra = getExtraBsa(scanned_extra.suffix);
+            if (!extra.present) {
+                extra.present = true;
+                changed = true;
+            }
+        }
+    }
+
+    return changed;
+}
+
+void SkyrimMod::assign(SkyrimMod const &other) const {
+    // the status bookkeeping belongs to this store, so it's left alone
+    uint8_t own_flags = MOD_STATUS_STALE | MOD_STATUS_COUNTED | MOD_COUNTED_MISSING;
+    clearBsas();
+    store->flags[id] = (store->flags[id] & own_flags) | (other.store->flags[other.id] & ~(own_flags | MOD_EXTRA_BSAS));
+    editBsaState() = other.getBsaState();
+
+    std::vector<ExtraBsa> const *other_extras = other.getExtraBsas();
+    if (other_extras) {
+        store->extra_bsas[id] = *other_extras;
+        setFlag(MOD_EXTRA_BSAS, true);
+    }
+}
+
+const char *ModStore::internName(std::string_view name) {
+    if (name_blocks.empty() || NAME_BLOCK_SIZE - name_block_used < name.size()) {
+        name_blocks.insert(name_blocks.end(), std::unique_ptr<char[]>(new char[NAME_BLOCK_SIZE]));
+        name_block_used = 0;
+    }
+
+    char *interned = name_blocks.back().get() + name_block_used;
+    memcpy(interned, name.data(), name.size());
+    name_block_used += name.size();
+    return interned;
+}
+
+ModId ModStore::add(std::string_view base_name) {
+    if (base_name.size() > UINT16_MAX) {
+        // no file system we run on allows names anywhere near this long
+        PANIC();
+        base_name = base_name.substr(0, UINT16_MAX);
+    }
+
+    ModId id = names.size();
+    names.insert(names.end(), internName(base_name));
+    name_lengths.insert(name_lengths.end(), base_name.size());
+    name_hashes.insert(name_hashes.end(), hashFolded(base_name));
+    flags.insert(flags.end(), 0);
+    bsa_states.insert(bsa_states.end(), {0, 0, 0});
+    statuses.insert(statuses.end(), ModStatus::DISABLED);
+    markStale(id);
+    return id;
+}
+
+void ModStore::copyFrom(ModStore const &other) {
+    name_blocks.clear();
+    name_block_used = 0;
+    names = other.names;
+    name_lengths = other.name_lengths;
+    name_hashes = other.name_hashes;
+    flags = other.flags;
+    bsa_states = other.bsa_states;
+    extra_bsas = other.extra_bsas;
+    statuses = other.statuses;
+    stale_mods = other.stale_mods;
+    status_counts = other.status_counts;
+}
+
+void ModStore::clear(void) {
+    name_blocks.clear();
+    name_block_used = 0;
+    names.clear();
+    name_lengths.clear();
+    name_hashes.clear();
+    flags.clear();
+    bsa_states.clear();
+    extra_bsas.clear();
+    statuses.clear();
+    stale_mods.clear();
+    status_counts = {0, 0, 0, 0};
+}
+
+void ModStore::truncate(size_t size) {
+    for (ModId id = size; id < names.size(); id++) {
+        if (flags[id] & MOD_STATUS_COUNTED) {
+            getStatusCount(status_counts, statuses[id], flags[id] & MOD_COUNTED_MISSING)--;
+        }
+    }
+
+    names.resize(size);
+    name_lengths.resize(size);
+    name_hashes.resize(size);
+    flags.resize(size);
+    bsa_states.resize(size);
+    statuses.resize(size);
+    extra_bsas.erase(extra_bsas.lower_bound(size), extra_bsas.end());
+    stale_mods.erase(std::remove_if(stale_mods.begin(), stale_mods.end(),
+            [size](ModId id) { return id >= size; }), stale_mods.end());
+}
+
+void ModStore::markStale(ModId id) {
+    // reading a mod's status refreshes it but leaves its entry behind, and a mod
+    // made stale again gets a second one, so once the list is as long as the store
+    // bring every mod on it up to date and start over; that's one pass over the
+    // list per store's worth of invalidations
+    if (stale_mods.size() >= names.size()) {
+        getStatusCounts();
+    }
+
+    flags[id] |= MOD_STATUS_STALE;
+    stale_mods.insert(stale_mods.end(), id);
+}
+
+ModStatusCounts const &ModStore::getStatusCounts(void) {
+    for (ModId id : stale_mods) {
+        if (flags[id] & MOD_STATUS_STALE) {
+            SkyrimMod(this, id).refreshStatus();
+        }
+    }
+    stale_mods.clear();
+
+    return status_counts;
+}
+
+ModRegistry::ModRegistry(void):
+        store(&getGlobalModStore()),
+        mods(),
+        index() {
+}
+
+size_t ModRegistry::findSlot(std::string_view name, uint32_t hash) const {
+    size_t mask = index.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        const IndexSlot &slot = index[i];
+        if (slot.pos == INDEX_SLOT_EMPTY) {
+            return i;
+        }
+        if (slot.hash == hash && equalsFolded(store->getBaseName(mods[slot.pos]), name)) {
+            return i;
+        }
+    }
+}
+
+size_t ModRegistry::findSlotForPos(size_t pos) const {
+    size_t mask = index.size() - 1;
+    for (size_t i = store->getNameHash(mods[pos]) & mask; ; i = (i + 1) & mask) {
+        if (index[i].pos == pos) {
+            return i;
+        }
+    }
+}
+
+void ModRegistry::rehash(size_t capacity) {
+    index.assign(capacity, {0, INDEX_SLOT_EMPTY});
+
+    size_t mask = capacity - 1;
+    for (size_t pos = 0; pos < mods.size(); pos++) {
+        uint32_t hash = store->getNameHash(mods[pos]);
+        size_t i = hash & mask;
+        while (index[i].pos != INDEX_SLOT_EMPTY) {
+            i = (i + 1) & mask;
+        }
+        index[i] = {hash, (uint32_t) pos};
+    }
+}
+
+SkyrimMod ModRegistry::find(std::string_view name) const {
+    ssize_t pos = indexOf(name);
+    return pos >= 0 ? SkyrimMod(store, mods[pos]) : SkyrimMod();
+}
+
+ssize_t ModRegistry::indexOf(std::string_view name) const {
+    if (index.empty()) {
+        return -1;
+    }
+
+    const IndexSlot &slot = index[findSlot(name, hashFolded(name))];
+    return slot.pos == INDEX_SLOT_EMPTY ? -1 : (ssize_t) slot.pos;
+}
+
+SkyrimMod ModRegistry::create(std::string_view base_name) {
+    SkyrimMod mod(store, store->add(base_name));
+    append(mod);
     return mod;
 }
+
+void ModRegistry::append(SkyrimMod const &mod) {
+    if (mod.getStore() != store) {
+        PANIC();
+        return;
+    }
+
+    // keep the load factor at or below 1/2 so probe sequences stay short
+    if ((mods.size() + 1) * 2 > index.size()) {
+        rehash(MAX(index.size() * 2, INDEX_MIN_CAPACITY));
+    }
+
+    uint32_t hash = store->getNameHash(mod.getId());
+    size_t slot = findSlot(mod.getBaseName(), hash);
+    if (index[slot].pos != INDEX_SLOT_EMPTY) {
+        // callers are expected to check for an existing entry first
+        PANIC();
+        return;
+    }
+
+    index[slot] = {hash, (uint32_t) mods.size()};
+    mods.insert(mods.end(), mod.getId());
+}
+
+void ModRegistry::copyFrom(ModRegistry const &other) {
+    if (store->size() != other.store->size()) {
+        PANIC();
+        return;
+    }
+
+    // ids and name hashes match between the stores, so the index carries over as is
+    mods = other.mods;
+    index = other.index;
+}
+
+void ModRegistry::swap(size_t a, size_t b) {
+    if (a == b) {
+        return;
+    }
+
+    size_t slot_a = findSlotForPos(a);
+    size_t slot_b = findSlotForPos(b);
+    index[slot_a].pos = b;
+    index[slot_b].pos = a;
+
+    std::swap(mods[a], mods[b]);
+}
+
+// Moves the mod at `from` to `to`, shifting everything in between by one. This
+// is a single rotate over the affected range rather than a chain of swaps.
+void ModRegistry::move(size_t from, size_t to) {
+    if (from == to) {
+        return;
+    } else if (from + 1 == to || to + 1 == from) {
+        swap(from, to);
+        return;
+    }
+
+    size_t lo = MIN(from, to);
+    size_t hi = MAX(from, to);
+
+    // look up the slots before rotating since they're located via the old positions
+    std::vector<size_t> slots;
+    slots.reserve(hi - lo + 1);
+    for (size_t pos = lo; pos <= hi; pos++) {
+        slots.insert(slots.end(), findSlotForPos(pos));
+    }
+
+    if (from < to) {
+        std::rotate(mods.begin() + from, mods.begin() + from + 1, mods.begin() + to + 1);
+    } else {
+        std::rotate(mods.begin() + to, mods.begin() + from, mods.begin() + from + 1);
+    }
+
+    for (size_t i = 0; i < slots.size(); i++) {
+        size_t old_pos = lo + i;
+        size_t new_pos;
+        if (old_pos == from) {
+            new_pos = to;
+        } else if (from < to) {
+            new_pos = old_pos - 1;
+        } else {
+            new_pos = old_pos + 1;
+        }
+        index[slots[i]].pos = new_pos;
+    }
+}
+
+void ModRegistry::reorder(std::vector<ModId> const &order) {
+    if (order.size() != mods.size()) {
+        PANIC();
+        return;
+    }
+
+    std::vector<bool> listed(store->size(), false);
+    for (ModId id : mods) {
+        listed[id] = true;
+    }
+    for (ModId id : order) {
+        if (id >= listed.size() || !listed[id]) {
+            PANIC();
+            return;
+        }
+        // each mod may only be taken once
+        listed[id] = false;
+    }
+
+    mods = order;
+    rehash(index.size());
+}
+
+void ModRegistry::clear(void) {
+    mods.clear();
+    index.clear();
+}
+
+ModStore &getGlobalModStore(void) {
+    static ModStore s_mod_store;
+    return s_mod_store;
+}
+
+ModRegistry &getGlobalModList(void) {
+    static ModRegistry s_mod_list(getGlobalModStore());
+    return s_mod_list;
+}
@@ -0,0 +1,171 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "mod_journal.hpp"
+
+#include "error_defs.hpp"
+#include "mod.hpp"
+
+#include <algorithm>
+#include <vector>
+
+void ModJournal::append(JournalEntry const &entry) {
+    if (position < entries.size()) {
+        // the undone entries can't be redone past a new edit; their extras and
+        // orders are at the ends of the side buffers, starting with the first one's
+        bool extras_dropped = false;
+        bool orders_dropped = false;
+        for (size_t i = position; i < entries.size() && !(extras_dropped && orders_dropped); i++) {
+            JournalEntry const &entry = entries[i];
+            if (entry.op == JournalOp::REORDER) {
+                if (!orders_dropped) {
+                    orders.resize(entry.target);
+                    orders_dropped = true;
+                }
+            } else if (entry.op != JournalOp::MOVE && entry.arg != JOURNAL_NO_EXTRAS && !extras_dropped) {
+                extra_counts.resize(entry.arg);
+                extras_dropped = true;
+            }
+        }
+        entries.resize(position);
+    }
+
+    entries.insert(entries.end(), entry);
+    position++;
+}
+
+// Puts the list in the order a reorder entry holds, keeping the order it had in
+// its place, so the same call both undoes and redoes the entry.
+void ModJournal::swapOrder(JournalEntry const &entry) {
+    std::vector<ModId> order(orders.begin() + entry.target, orders.begin() + entry.target + entry.arg);
+    std::vector<ModId> const &current = mod_list.getIds();
+    std::copy(current.begin(), current.end(), orders.begin() + entry.target);
+    mod_list.reorder(order);
+}
+
+void ModJournal::apply(JournalEntry const &entry) {
+    switch (entry.op) {
+        case JournalOp::ENABLE:
+            SkyrimMod(&mod_list.getStore(), entry.target).enable();
+            break;
+        case JournalOp::DISABLE:
+            SkyrimMod(&mod_list.getStore(), entry.target).disable();
+            break;
+        case JournalOp::MOVE:
+            mod_list.move(entry.target, entry.arg);
+            break;
+        case JournalOp::REORDER:
+            swapOrder(entry);
+            break;
+        default:
+            PANIC();
+    }
+}
+
+JournalOp ModJournal::toggle(SkyrimMod const &mod) {
+    BsaState const &bsas = mod.getBsaState();
+    JournalEntry entry = {
+        mod.getStatus() == ModStatus::ENABLED ? JournalOp::DISABLE : JournalOp::ENABLE,
+        mod.isEspEnabled(),
+        bsas.enabled,
+        bsas.animations,
+        mod.getId(),
+        JOURNAL_NO_EXTRAS
+    };
+
+    // truncate first so the extras land where the entry says they are
+    append(entry);
+
+    std::vector<ExtraBsa> const *extras = mod.getExtraBsas();
+    if (extras) {
+        entries.back().arg = extra_counts.size();
+        for (ExtraBsa const &extra : *extras) {
+            extra_counts.insert(extra_counts.end(), extra.enabled_count);
+        }
+    }
+
+    apply(entries.back());
+    return entry.op;
+}
+
+void ModJournal::recordMove(size_t from, size_t to) {
+    if (from == to) {
+        return;
+    }
+
+    append({JournalOp::MOVE, false, 0, 0, (uint32_t) from, (uint32_t) to});
+}
+
+void ModJournal::recordReorder(std::vector<ModId> const &previous) {
+    append({JournalOp::REORDER, false, 0, 0, (uint32_t) orders.size(), (uint32_t) previous.size()});
+    orders.insert(orders.end(), previous.begin(), previous.end());
+}
+
+JournalEntry const *ModJournal::undo(void) {
+    if (!canUndo()) {
+        return NULL;
+    }
+
+    JournalEntry const &entry = entries[--position];
+    if (entry.op == JournalOp::MOVE) {
+        mod_list.move(entry.arg, entry.target);
+        return &entry;
+    } else if (entry.op == JournalOp::REORDER) {
+        swapOrder(entry);
+        return &entry;
+    }
+
+    SkyrimMod mod(&mod_list.getStore(), entry.target);
+    mod.setEspEnabled(entry.esp_enabled);
+    BsaState &bsas = mod.editBsaState();
+    bsas.enabled = entry.bsas_enabled;
+    bsas.animations = entry.bsas_animations;
+
+    std::vector<ExtraBsa> *extras = mod.editExtraBsas();
+    if (extras && entry.arg != JOURNAL_NO_EXTRAS) {
+        for (size_t i = 0; i < extras->size() && entry.arg + i < extra_counts.size(); i++) {
+            (*extras)[i].enabled_count = extra_counts[entry.arg + i];
+        }
+    }
+
+    return &entry;
+}
+
+JournalEntry const *ModJournal::redo(void) {
+    if (!canRedo()) {
+        return NULL;
+    }
+
+    JournalEntry const &entry = entries[position++];
+    apply(entry);
+    return &entry;
+}
+
+void ModJournal::clear(void) {
+    entries.clear();
+    extra_counts.clear();
+    orders.clear();
+    position = 0;
+}
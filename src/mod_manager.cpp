@@ -0,0 +1,580 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "mod_manager.hpp"
+
+#include "asset_index.hpp"
+#include "data_scanner.hpp"
+#include "error_defs.hpp"
+#include "file_helper.hpp"
+#include "ini_helper.hpp"
+#include "master_graph.hpp"
+#include "mod.hpp"
+#include "path_helper.hpp"
+#include "phase_timer.hpp"
+#include "plugins_helper.hpp"
+#include "scan_cache.hpp"
+#include "string_helper.hpp"
+#include "task_pool.hpp"
+
+#include <switch.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cstdio>
+
+static ModRegistry g_mod_list_tmp;
+
+// A copy of the load order taken when a save was queued, which the save worker
+// writes while the UI carries on changing the original.
+struct SaveSnapshot {
+    ModStore store;
+    ModRegistry mod_list;
+    std::string plugins_path;
+    std::string cache_path;
+
+    SaveSnapshot(void):
+            store(),
+            mod_list(store),
+            plugins_path(),
+            cache_path() {
+    }
+};
+
+static std::mutex g_save_mutex;
+static std::condition_variable g_save_idle;
+// the latest snapshot queued for saving which the worker hasn't taken yet
+static std::unique_ptr<SaveSnapshot> g_save_pending;
+// snapshots replaced by a newer one before they were written
+static size_t g_save_superseded = 0;
+// set while the worker has a save queued or running
+static bool g_save_running = false;
+// finished saves, oldest first, waiting to be reported on the main thread
+static std::vector<SaveResult> g_save_results;
+static std::atomic<SaveStage> g_save_stage(SaveStage::IDLE);
+
+static MasterGraph g_master_graph;
+static MasterGraphStats g_master_stats;
+static uint64_t g_master_ns = 0;
+static uint64_t g_master_allocs = 0;
+// master graph loads queued so far and the last one to finish, so a load which is
+// overtaken by a newer one isn't taken for the result
+static size_t g_master_queued = 0;
+static std::atomic<size_t> g_master_built(0);
+static size_t g_master_reported = 0;
+
+static AssetIndex g_asset_index;
+static AssetIndexStats g_asset_stats;
+static uint64_t g_asset_ns = 0;
+static uint64_t g_asset_allocs = 0;
+// likewise for asset index loads
+static size_t g_asset_queued = 0;
+static std::atomic<size_t> g_asset_built(0);
+static size_t g_asset_reported = 0;
+
+static std::string g_plugins_header;
+// hash of the Plugins file content as of the last load or save
+static uint64_t g_plugins_hash = 0;
+
+static int finishDiscovery(int scan_rc, size_t file_count) {
+    if (RC_FAILURE(scan_rc)) {
+        FATAL("No Skyrim data folder found!\nSearched in %s", getBaseRomfsPath());
+        return -1;
+    }
+
+    phaseAddFiles(file_count);
+    printf("Found %lu mod files\n", file_count);
+
+    return 0;
+}
+
+int discoverMods(void) {
+    PhaseTimer timer("scan");
+
+    size_t file_count = 0;
+    int rc = scanDataDir(getRomfsPath(SKYRIM_DATA_DIR).c_str(), g_mod_list_tmp, &file_count);
+    return finishDiscovery(rc, file_count);
+}
+
+static int finishPluginsFile(int read_rc, std::string const &plugins) {
+    if (RC_FAILURE(read_rc)) {
+        FATAL("Failed to open Plugins file");
+        return -1;
+    }
+
+    parsePlugins(plugins, getGlobalModList(), g_mod_list_tmp, g_plugins_header);
+
+    return 0;
+}
+
+int processPluginsFile(void) {
+    PhaseTimer timer("plugins");
+
+    std::string plugins;
+    int rc = readFile(getRomfsPath(SKYRIM_PLUGINS_FILE).c_str(), plugins);
+    return finishPluginsFile(rc, plugins);
+}
+
+int processInis(void) {
+    PhaseTimer timer("inis");
+
+    return parseInis(getGlobalModList(), g_mod_list_tmp);
+}
+
+void mergePendingMods(void) {
+    PhaseTimer timer("merge");
+
+    for (SkyrimMod mod : g_mod_list_tmp) {
+        if (getGlobalModList().indexOf(mod.getBaseName()) < 0) {
+            getGlobalModList().append(mod);
+        }
+    }
+}
+
+// Writes the Plugins file for mod_list if it differs from what was last loaded or
+// saved. Like saveIniChanges(), this is safe to run on a worker thread.
+static int savePluginsFile(ModRegistry const &mod_list, std::string const &path, size_t *bytes_written,
+        bool *written, FileError *error) {
+    *bytes_written = 0;
+    *written = false;
+
+    std::string plugins = serializePlugins(g_plugins_header, mod_list);
+    uint64_t plugins_hash = hashBytes(plugins);
+    if (plugins_hash == g_plugins_hash) {
+        return 0;
+    }
+
+    if (RC_FAILURE(writeFileAtomicUntracked(path.c_str(), plugins))) {
+        *error = {"write", path};
+        return -1;
+    }
+
+    g_plugins_hash = plugins_hash;
+    *bytes_written = plugins.size();
+    *written = true;
+    return 0;
+}
+
+int writePluginsFile(size_t *bytes_written, bool *written) {
+    FileError error;
+    if (RC_FAILURE(savePluginsFile(getGlobalModList(), getRomfsPath(SKYRIM_PLUGINS_FILE), bytes_written, written,
+            &error))) {
+        FATAL("Failed to write Plugins file");
+        return -1;
+    }
+
+    if (*written) {
+        phaseAddFiles(1);
+        phaseAddBytes(*bytes_written);
+    }
+    return 0;
+}
+
+int loadSourcesSequential(void) {
+    int rc;
+    if (RC_FAILURE(rc = discoverMods())) {
+        return rc;
+    }
+
+    if (RC_FAILURE(rc = processPluginsFile())) {
+        return rc;
+    }
+
+    if (RC_FAILURE(rc = processInis())) {
+        return rc;
+    }
+
+    mergePendingMods();
+    return 0;
+}
+
+int loadSourcesParallel(void) {
+    int rc;
+
+    // the scan fills the pending list from a worker, which is safe since nothing
+    // else touches the mod store until the pool is idle again
+    std::string data_dir = getRomfsPath(SKYRIM_DATA_DIR);
+    std::string plugins_path = getRomfsPath(SKYRIM_PLUGINS_FILE);
+    int scan_rc = 0;
+    size_t file_count = 0;
+    int plugins_rc = 0;
+    std::string plugins;
+    {
+        PhaseTimer timer("read");
+        TaskPool pool(LOAD_WORKERS);
+        if (RC_FAILURE(prefetchInis(pool))) {
+            return -1;
+        }
+        pool.submit([&]() {
+            scan_rc = scanDataDir(data_dir.c_str(), g_mod_list_tmp, &file_count);
+        });
+        pool.submit([&]() {
+            plugins_rc = readFileUntracked(plugins_path.c_str(), plugins);
+        });
+        pool.wait();
+    }
+
+    // everything below runs on this thread in the same order as loadSourcesSequential()
+    {
+        PhaseTimer timer("scan");
+        if (RC_FAILURE(rc = finishDiscovery(scan_rc, file_count))) {
+            return rc;
+        }
+    }
+
+    {
+        PhaseTimer timer("plugins");
+        if (RC_SUCCESS(plugins_rc)) {
+            phaseAddFiles(1);
+            phaseAddBytes(plugins.size());
+        }
+        if (RC_FAILURE(rc = finishPluginsFile(plugins_rc, plugins))) {
+            return rc;
+        }
+    }
+
+    if (RC_FAILURE(rc = processInis())) {
+        return rc;
+    }
+
+    mergePendingMods();
+    return 0;
+}
+
+static int getScanCacheInputs(std::vector<std::string> &inputs) {
+    std::string lang_ini_path;
+    if (RC_FAILURE(getLangIniPath(lang_ini_path))) {
+        return -1;
+    }
+
+    inputs = {
+        getRomfsPath(SKYRIM_DATA_DIR),
+        getRomfsPath(SKYRIM_PLUGINS_FILE),
+        getRomfsPath(SKYRIM_INI_FILE),
+        lang_ini_path
+    };
+    return 0;
+}
+
+int loadModList(void) {
+    PhaseTimer timer("load");
+    int rc;
+
+    std::vector<std::string> cache_inputs;
+    if (RC_FAILURE(getScanCacheInputs(cache_inputs))) {
+        return -1;
+    }
+
+    std::string cache_path = getTitlePath(SCAN_CACHE_FILE);
+    bool cached;
+    {
+        PhaseTimer cache_timer("cache_load");
+        cached = RC_SUCCESS(loadScanCache(cache_path.c_str(), cache_inputs, getGlobalModList(), g_plugins_header));
+    }
+
+    if (cached) {
+        printf("Nothing has changed since the last scan, using cached mod list\n");
+    } else {
+        if (RC_FAILURE(rc = loadSourcesParallel())) {
+            return rc;
+        }
+
+        PhaseTimer cache_timer("cache_save");
+        saveScanCache(cache_path.c_str(), cache_inputs, getGlobalModList(), g_plugins_header);
+    }
+
+    {
+        // remember what the outputs look like as loaded so unchanged files can be skipped on save
+        PhaseTimer baseline_timer("baseline");
+        g_plugins_hash = hashBytes(serializePlugins(g_plugins_header, getGlobalModList()));
+        captureIniBaseline();
+    }
+
+    printf("Identified %lu mods\n", getGlobalModList().size());
+
+    return 0;
+}
+
+void resetModList(void) {
+    getGlobalModList().clear();
+    g_mod_list_tmp.clear();
+    getGlobalModStore().clear();
+    g_plugins_header.clear();
+    g_plugins_hash = 0;
+    resetInis();
+}
+
+// Writes every output of mod_list which changed. This is the part of a save
+// which may run on the save worker, so it only reports through result.
+static void saveModList(ModRegistry const &mod_list, std::string const &plugins_path,
+        std::string const &cache_path, SaveResult *result) {
+    *result = SaveResult();
+
+    uint64_t start_tick = armGetSystemTick();
+    uint64_t start_allocs = getAllocationCount();
+
+    g_save_stage = SaveStage::PLUGINS;
+    result->rc = savePluginsFile(mod_list, plugins_path, &result->plugins_bytes, &result->wrote_plugins,
+            &result->error);
+    uint64_t plugins_tick = armGetSystemTick();
+    uint64_t plugins_allocs = getAllocationCount();
+    result->plugins_ns = armTicksToNs(plugins_tick - start_tick);
+    result->plugins_allocs = plugins_allocs - start_allocs;
+
+    if (RC_SUCCESS(result->rc)) {
+        g_save_stage = SaveStage::INIS;
+        result->rc = saveIniChanges(mod_list, &result->inis_bytes, &result->wrote_inis, &result->error);
+        result->inis_ns = armTicksToNs(armGetSystemTick() - plugins_tick);
+        result->inis_allocs = getAllocationCount() - plugins_allocs;
+    }
+
+    if (result->wrote_plugins || result->wrote_inis) {
+        // the snapshot reflects the files as they were loaded, so it's stale now
+        invalidateScanCache(cache_path.c_str());
+    }
+
+    result->total_ns = armTicksToNs(armGetSystemTick() - start_tick);
+    g_save_stage = SaveStage::IDLE;
+}
+
+// Records a save's timings and reports its failure, if any, on the main thread.
+static int finishSave(SaveResult const &result) {
+    uint64_t plugins_files = result.wrote_plugins;
+    uint64_t inis_files = ((result.wrote_inis & INI_WROTE_SKYRIM) != 0)
+            + ((result.wrote_inis & INI_WROTE_SKYRIM_LANG) != 0);
+    addPhaseRecord({"save", 0, false, result.total_ns, plugins_files + inis_files,
+            result.plugins_bytes + result.inis_bytes, result.plugins_allocs + result.inis_allocs});
+    addPhaseRecord({"write_plugins", 1, false, result.plugins_ns, plugins_files, result.plugins_bytes,
+            result.plugins_allocs});
+    addPhaseRecord({"write_inis", 1, false, result.inis_ns, inis_files, result.inis_bytes, result.inis_allocs});
+
+    if (RC_FAILURE(result.rc)) {
+        FATAL("Failed to %s %s", result.error.action, result.error.path.c_str());
+        return result.rc;
+    }
+
+    return 0;
+}
+
+int writeChanges(size_t *bytes_written, bool *wrote_plugins, int *wrote_inis) {
+    int rc;
+    if (RC_FAILURE(rc = prepareIniSave())) {
+        return rc;
+    }
+
+    SaveResult result;
+    saveModList(getGlobalModList(), getRomfsPath(SKYRIM_PLUGINS_FILE), getTitlePath(SCAN_CACHE_FILE), &result);
+
+    *bytes_written = result.plugins_bytes + result.inis_bytes;
+    *wrote_plugins = result.wrote_plugins;
+    *wrote_inis = result.wrote_inis;
+    return finishSave(result);
+}
+
+// The save worker is started on the first save and lives until exit.
+static TaskPool &getSavePool(void) {
+    static TaskPool s_pool(1);
+    return s_pool;
+}
+
+// Runs on the save worker until no snapshot is left waiting.
+static void runSaves(void) {
+    std::unique_lock<std::mutex> lock(g_save_mutex);
+    while (g_save_pending) {
+        std::unique_ptr<SaveSnapshot> snapshot = std::move(g_save_pending);
+        size_t superseded = g_save_superseded;
+        g_save_superseded = 0;
+        lock.unlock();
+
+        SaveResult result;
+        saveModList(snapshot->mod_list, snapshot->plugins_path, snapshot->cache_path, &result);
+        result.superseded = superseded;
+        snapshot.reset();
+
+        lock.lock();
+        g_save_results.insert(g_save_results.end(), std::move(result));
+    }
+
+    g_save_running = false;
+    g_save_idle.notify_all();
+}
+
+int queueSave(void) {
+    int rc;
+    if (RC_FAILURE(rc = prepareIniSave())) {
+        return rc;
+    }
+
+    std::unique_ptr<SaveSnapshot> snapshot(new SaveSnapshot());
+    snapshot->store.copyFrom(getGlobalModStore());
+    snapshot->mod_list.copyFrom(getGlobalModList());
+    snapshot->plugins_path = getRomfsPath(SKYRIM_PLUGINS_FILE);
+    snapshot->cache_path = getTitlePath(SCAN_CACHE_FILE);
+
+    std::lock_guard<std::mutex> lock(g_save_mutex);
+    if (g_save_pending) {
+        // the queued snapshot hasn't been started on, so this one can take its place
+        g_save_superseded++;
+    }
+    g_save_pending = std::move(snapshot);
+
+    if (!g_save_running) {
+        g_save_running = true;
+        getSavePool().submit(runSaves);
+    }
+    return 0;
+}
+
+SaveStage getSaveStage(void) {
+    return g_save_stage;
+}
+
+bool isSaveQueued(void) {
+    std::lock_guard<std::mutex> lock(g_save_mutex);
+    return g_save_running;
+}
+
+bool pollSave(SaveResult *result) {
+    {
+        std::lock_guard<std::mutex> lock(g_save_mutex);
+        if (g_save_results.empty()) {
+            return false;
+        }
+        *result = std::move(g_save_results.front());
+        g_save_results.erase(g_save_results.begin());
+    }
+
+    finishSave(*result);
+    return true;
+}
+
+void waitForSaves(void) {
+    std::unique_lock<std::mutex> lock(g_save_mutex);
+    g_save_idle.wait(lock, [] { return !g_save_running; });
+}
+
+// Master graph loads run one after another on a worker of their own, which in
+// turn spreads the header reads over a pool.
+static TaskPool &getMasterPool(void) {
+    static TaskPool s_pool(1);
+    return s_pool;
+}
+
+void queueMasterGraphLoad(void) {
+    std::vector<std::string> file_names;
+    for (SkyrimMod mod : getGlobalModList()) {
+        if (mod.hasEsp()) {
+            file_names.insert(file_names.end(), mod.getPluginFileName());
+        }
+    }
+
+    std::string data_dir = getRomfsPath(SKYRIM_DATA_DIR);
+    std::string cache_path = getTitlePath(PLUGIN_CACHE_FILE);
+    size_t generation = ++g_master_queued;
+    getMasterPool().submit([file_names = std::move(file_names), data_dir, cache_path, generation]() {
+        uint64_t start_tick = armGetSystemTick();
+        uint64_t start_allocs = getAllocationCount();
+
+        // a cache which can't be written only costs the next load a full read
+        g_master_graph.load(data_dir, file_names, cache_path, LOAD_WORKERS, &g_master_stats);
+
+        g_master_ns = armTicksToNs(armGetSystemTick() - start_tick);
+        g_master_allocs = getAllocationCount() - start_allocs;
+        g_master_built = generation;
+    });
+}
+
+bool pollMasterGraph(void) {
+    if (g_master_built != g_master_queued) {
+        return false;
+    }
+
+    if (g_master_reported != g_master_queued) {
+        g_master_reported = g_master_queued;
+        addPhaseRecord({"masters", 0, false, g_master_ns, g_master_stats.read,
+                g_master_stats.bytes_read + g_master_stats.bytes_written, g_master_allocs});
+    }
+    return true;
+}
+
+MasterGraph const &waitForMasterGraph(void) {
+    getMasterPool().wait();
+    pollMasterGraph();
+    return g_master_graph;
+}
+
+// Asset index loads get a worker of their own too, so sorting by masters never
+// waits on archives being read.
+static TaskPool &getAssetPool(void) {
+    static TaskPool s_pool(1);
+    return s_pool;
+}
+
+void queueAssetIndexLoad(void) {
+    std::vector<std::string> file_names;
+    for (SkyrimMod mod : getGlobalModList()) {
+        mod.getArchiveFileNames(file_names);
+    }
+
+    std::string data_dir = getRomfsPath(SKYRIM_DATA_DIR);
+    std::string cache_path = getTitlePath(ASSET_CACHE_FILE);
+    size_t generation = ++g_asset_queued;
+    getAssetPool().submit([file_names = std::move(file_names), data_dir, cache_path, generation]() {
+        uint64_t start_tick = armGetSystemTick();
+        uint64_t start_allocs = getAllocationCount();
+
+        // a cache which can't be written only costs the next launch a full read
+        g_asset_index.load(data_dir, file_names, cache_path, LOAD_WORKERS, &g_asset_stats);
+
+        g_asset_ns = armTicksToNs(armGetSystemTick() - start_tick);
+        g_asset_allocs = getAllocationCount() - start_allocs;
+        g_asset_built = generation;
+    });
+}
+
+bool pollAssetIndex(void) {
+    if (g_asset_built != g_asset_queued) {
+        return false;
+    }
+
+    if (g_asset_reported != g_asset_queued) {
+        g_asset_reported = g_asset_queued;
+        addPhaseRecord({"assets", 0, false, g_asset_ns, g_asset_stats.read,
+                g_asset_stats.bytes_read + g_asset_stats.bytes_written, g_asset_allocs});
+    }
+    return true;
+}
+
+AssetIndex const &waitForAssetIndex(void) {
+    getAssetPool().wait();
+    pollAssetIndex();
+    return g_asset_index;
+}
@@ -9,6 +9,7 @@
 
 static bool initted = false;
 static bool newRomfsPath = false;
+static std::string g_romfs_override;
 
 static void _init(void) {
     splInitialize();
@@ -18,7 +19,6 @@ static void _init(void) {
 
     u32 exoMajor = (ver >> 56) & 0xFF;
     u32 exoMinor = (ver >> 48) & 0xFF;
-    u32 exoMicro = (ver >> 40) & 0xFF;
 
     // AMS 0.10.0 changed the RomFS directory
     if (exoMajor > 0 || (exoMinor >= 10)) {
@@ -26,9 +26,19 @@ static void _init(void) {
     } else {
         newRomfsPath = false;
     }
+
+    initted = true;
+}
+
+void setBaseRomfsPath(const char *path) {
+    g_romfs_override = path != NULL ? path : "";
 }
 
 const char *getBaseRomfsPath(void) {
+    if (!g_romfs_override.empty()) {
+        return g_romfs_override.c_str();
+    }
+
     if (!initted) {
         _init();
     }
@@ -45,13 +55,11 @@ std::string getRomfsPath(std::string &partial) {
 }
 
 std::string getRomfsPath(const char *partial) {
-    if (!initted) {
-        _init();
-    }
+    return std::string(getBaseRomfsPath()) + "/" + partial;
+}
 
-    if (newRomfsPath) {
-        return std::string(SKYRIM_ROMFS_DIR) + "/" + partial;
-    } else {
-        return std::string(SKYRIM_ROMFS_DIR_OLD) + "/" + partial;
-    }
+// Resolves a path in the title directory containing the romfs directory.
+std::string getTitlePath(const char *partial) {
+    std::string romfs_path = getBaseRomfsPath();
+    return romfs_path.substr(0, romfs_path.find_last_of('/')) + "/" + partial;
 }
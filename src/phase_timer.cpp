@@ -0,0 +1,191 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "phase_timer.hpp"
+
+#include <switch.h>
+
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+static std::atomic<uint64_t> g_alloc_count(0);
+
+static std::vector<PhaseRecord> g_phase_records;
+// indices into g_phase_records of the phases currently open, innermost last
+static std::vector<size_t> g_open_phases;
+
+// Counting every allocation is what lets phases report allocation counts; the
+// cost is one relaxed atomic increment per allocation.
+void *operator new(size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = malloc(size != 0 ? size : 1);
+    if (ptr == NULL) {
+        abort();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+uint64_t getAllocationCount(void) {
+    return g_alloc_count.load(std::memory_order_relaxed);
+}
+
+// Drops the records of the last top-level phase with the given name, along
+// with the phases nested in it.
+static void dropPhaseRun(const char *name) {
+    for (size_t i = 0; i < g_phase_records.size(); i++) {
+        if (g_phase_records[i].depth != 0 || strcmp(g_phase_records[i].name, name) != 0) {
+            continue;
+        }
+
+        size_t end = i + 1;
+        while (end < g_phase_records.size() && g_phase_records[end].depth != 0) {
+            end++;
+        }
+        g_phase_records.erase(g_phase_records.begin() + i, g_phase_records.begin() + end);
+        return;
+    }
+}
+
+PhaseTimer::PhaseTimer(const char *name) {
+    if (g_open_phases.empty()) {
+        dropPhaseRun(name);
+    }
+
+    record = g_phase_records.size();
+    g_phase_records.push_back({ name, (unsigned) g_open_phases.size(), true, 0, 0, 0, 0 });
+    g_open_phases.push_back(record);
+
+    start_allocs = getAllocationCount();
+    start_tick = armGetSystemTick();
+}
+
+PhaseTimer::~PhaseTimer() {
+    uint64_t end_tick = armGetSystemTick();
+
+    PhaseRecord &phase = g_phase_records[record];
+    phase.duration_ns = armTicksToNs(end_tick - start_tick);
+    phase.allocs = getAllocationCount() - start_allocs;
+    phase.open = false;
+
+    g_open_phases.pop_back();
+    if (!g_open_phases.empty()) {
+        PhaseRecord &parent = g_phase_records[g_open_phases.back()];
+        parent.files += phase.files;
+        parent.bytes += phase.bytes;
+    }
+}
+
+void addPhaseRecord(PhaseRecord const &record) {
+    if (g_open_phases.empty() && record.depth == 0) {
+        dropPhaseRun(record.name);
+    }
+
+    PhaseRecord added = record;
+    added.depth += g_open_phases.size();
+    added.open = false;
+    g_phase_records.push_back(added);
+
+    // records nested in an added run were already counted toward it
+    if (!g_open_phases.empty() && record.depth == 0) {
+        PhaseRecord &parent = g_phase_records[g_open_phases.back()];
+        parent.files += record.files;
+        parent.bytes += record.bytes;
+    }
+}
+
+void phaseAddFiles(uint64_t count) {
+    if (!g_open_phases.empty()) {
+        g_phase_records[g_open_phases.back()].files += count;
+    }
+}
+
+void phaseAddBytes(uint64_t count) {
+    if (!g_open_phases.empty()) {
+        g_phase_records[g_open_phases.back()].bytes += count;
+    }
+}
+
+std::vector<PhaseRecord> const &getPhaseRecords(void) {
+    return g_phase_records;
+}
+
+void formatPhaseRecord(PhaseRecord const *record, char *buf, size_t len) {
+    if (record == NULL) {
+        snprintf(buf, len, "%-24s %13s %8s %11s %9s", "Phase", "Time", "Files", "Bytes", "Allocs");
+        return;
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "%*s%s", record->depth * 2, "", record->name);
+    if (record->open) {
+        snprintf(buf, len, "%-24s %13s", name, "running");
+        return;
+    }
+
+    snprintf(buf, len, "%-24s %10.3f ms %8lu %11lu %9lu", name, record->duration_ns / 1000000.0,
+            record->files, record->bytes, record->allocs);
+}
+
+int appendPhaseLog(const char *path) {
+    FILE *log = fopen(path, "a");
+    if (!log) {
+        return -1;
+    }
+
+    char timestamp[32];
+    time_t now = time(NULL);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
+    fprintf(log, "# %s\n", timestamp);
+
+    char row[PHASE_ROW_LEN + 1];
+    formatPhaseRecord(NULL, row, sizeof(row));
+    fprintf(log, "%s\n", row);
+    for (PhaseRecord const &record : g_phase_records) {
+        formatPhaseRecord(&record, row, sizeof(row));
+        fprintf(log, "%s\n", row);
+    }
+    fprintf(log, "\n");
+
+    bool failed = ferror(log) != 0;
+    if (fclose(log) != 0 || failed) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "plugin_header.hpp"
+
+#include "file_helper.hpp"
+
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Plugins are little-endian, as is everything this runs on, so fields are copied
+// out as they are.
+template<typename T>
+static inline T readField(std::string_view data, size_t off) {
+    T val;
+    memcpy(&val, data.data() + off, sizeof(T));
+    return val;
+}
+
+// Record layout (Skyrim):
+//
+//   char[4] "TES4", u32 data size, u32 flags, u32 form ID, u32 version control,
+//   u16 form version, u16 unknown
+//
+// followed by data size bytes of subrecords, each a char[4] type and a u16 size
+// ahead of its data. An XXXX subrecord holds the u32 size of the one after it,
+// for data too large for the u16.
+int parsePluginHeader(std::string_view data, PluginHeader *header) {
+    if (data.size() < TES4_RECORD_HEADER_SIZE || data.substr(0, 4) != "TES4") {
+        return -1;
+    }
+
+    uint32_t data_size = readField<uint32_t>(data, 4);
+    if (data_size > PLUGIN_HEADER_MAX_SIZE || data.size() - TES4_RECORD_HEADER_SIZE < data_size) {
+        return -1;
+    }
+
+    header->flags = readField<uint32_t>(data, 8);
+    header->masters.clear();
+
+    size_t off = TES4_RECORD_HEADER_SIZE;
+    size_t end = TES4_RECORD_HEADER_SIZE + data_size;
+    uint32_t size_override = 0;
+    while (off < end) {
+        if (end - off < TES4_SUBRECORD_HEADER_SIZE) {
+            return -1;
+        }
+
+        std::string_view type = data.substr(off, 4);
+        size_t size = readField<uint16_t>(data, off + 4);
+        off += TES4_SUBRECORD_HEADER_SIZE;
+
+        if (size_override != 0) {
+            size = size_override;
+            size_override = 0;
+        }
+        if (end - off < size) {
+            return -1;
+        }
+
+        if (type == "XXXX") {
+            if (size != sizeof(uint32_t)) {
+                return -1;
+            }
+            size_override = readField<uint32_t>(data, off);
+        } else if (type == "MAST") {
+            // a zstring, though some tools leave off the terminator
+            std::string_view master = data.substr(off, size);
+            master = master.substr(0, master.find('\0'));
+            if (master.empty()) {
+                return -1;
+            }
+            header->masters.insert(header->masters.end(), std::string(master));
+        }
+
+        off += size;
+    }
+
+    return 0;
+}
+
+int readPluginHeader(const char *path, PluginHeader *header, size_t *bytes_read) {
+    *bytes_read = 0;
+
+    std::string data;
+    if (readFileRangeUntracked(path, 0, PLUGIN_HEADER_READ_SIZE, data) != 0) {
+        return -1;
+    }
+
+    if (data.size() == PLUGIN_HEADER_READ_SIZE && data.substr(0, 4) == "TES4") {
+        size_t record_size = TES4_RECORD_HEADER_SIZE + readField<uint32_t>(data, 4);
+        if (record_size > data.size() && record_size <= TES4_RECORD_HEADER_SIZE + PLUGIN_HEADER_MAX_SIZE) {
+            std::string rest;
+            if (readFileRangeUntracked(path, data.size(), record_size - data.size(), rest) != 0) {
+                return -1;
+            }
+            data += rest;
+        }
+    }
+
+    *bytes_read = data.size();
+    return parsePluginHeader(data, header);
+}
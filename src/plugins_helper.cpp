@@ -0,0 +1,102 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "mod.hpp"
+#include "plugins_helper.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Parses the contents of a Plugins file, moving each listed mod from
+// temp_mod_list into final_mod_list in file order and applying its enabled
+// state. The comment block at the top of the file is returned in header.
+void parsePlugins(std::string_view data, ModRegistry &final_mod_list, ModRegistry &temp_mod_list,
+        std::string &header) {
+    size_t header_end = std::string_view::npos;
+
+    size_t line_start = 0;
+    while (line_start < data.size()) {
+        size_t line_end = data.find('\n', line_start);
+        if (line_end == std::string_view::npos) {
+            line_end = data.size();
+        }
+
+        std::string_view line = data.substr(line_start, line_end - line_start);
+        size_t next_start = line_end + 1;
+
+        if (line.empty() || line[0] == '#') {
+            line_start = next_start;
+            continue;
+        }
+
+        if (header_end == std::string_view::npos) {
+            header_end = line_start;
+        }
+        line_start = next_start;
+
+        bool enable = line[0] == '*';
+
+        ModFileView file_def = ModFileView::classify(line.substr(enable ? 1 : 0));
+        if (file_def.type != ModFileType::ESP && file_def.type != ModFileType::ESM) {
+            continue;
+        }
+
+        SkyrimMod mod = final_mod_list.find(file_def.base_name);
+        if (!mod) {
+            mod = temp_mod_list.find(file_def.base_name);
+            if (mod) {
+                final_mod_list.append(mod);
+            } else {
+                continue;
+            }
+        }
+
+        mod.setEspEnabled(enable);
+    }
+
+    // the header is everything before the first entry, taken as a single slice
+    header = std::string(data.substr(0, header_end));
+    if (!header.empty() && header.back() != '\n') {
+        header += '\n';
+    }
+}
+
+std::string serializePlugins(std::string const &header, ModRegistry const &mod_list) {
+    std::string plugins = header;
+
+    for (SkyrimMod mod : mod_list) {
+        if (mod.hasEsp()) {
+            if (mod.isEspEnabled()) {
+                plugins += '*';
+            }
+            plugins += mod.getBaseName();
+            plugins += mod.isMaster() ? ".esm" : ".esp";
+            plugins += '\n';
+        }
+    }
+
+    return plugins;
+}
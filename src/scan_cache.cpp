@@ -0,0 +1,215 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "file_helper.hpp"
+#include "mod.hpp"
+#include "scan_cache.hpp"
+#include "snapshot_io.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define MOD_FLAG_HAS_ESP 1
+#define MOD_FLAG_IS_MASTER 2
+#define MOD_FLAG_ESP_ENABLED 4
+
+// Snapshot layout (native byte order):
+//
+//   u32 magic, u32 version
+//   u32 input count, then per input: i64 mtime, i64 size
+//   str plugins header
+//   u32 mod count, then per mod in load order:
+//     str name, u8 flags
+//     u8 present BSAs, u8 enabled BSAs, u8 Animations count (see BsaState)
+//     u8 extra BSA count, then per extra BSA: str suffix, u8 present, u8 enabled count
+//
+// where str is a u32 length followed by that many bytes (see SnapshotWriter).
+
+static bool stampInputs(std::vector<std::string> const &inputs, std::vector<FileStamp> &stamps) {
+    stamps.resize(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (statFile(inputs[i].c_str(), &stamps[i]) != 0) {
+            return false;
+        }
+        // some filesystems don't report timestamps, and without one we can't detect changes
+        if (stamps[i].mtime == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reads the mod entries of a snapshot into an empty list.
+static int readMods(SnapshotReader &reader, ModRegistry &loaded) {
+    uint32_t mod_count = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < mod_count && reader.good(); i++) {
+        std::string_view name = reader.getString();
+        uint8_t flags = reader.get<uint8_t>();
+        if (!reader.good() || name.empty() || loaded.indexOf(name) >= 0) {
+            return -1;
+        }
+
+        SkyrimMod mod = loaded.create(name);
+        mod.setHasEsp(flags & MOD_FLAG_HAS_ESP);
+        mod.setMaster(flags & MOD_FLAG_IS_MASTER);
+        mod.setEspEnabled(flags & MOD_FLAG_ESP_ENABLED);
+
+        BsaState &bsas = mod.editBsaState();
+        bsas.present = reader.get<uint8_t>();
+        bsas.enabled = reader.get<uint8_t>();
+        bsas.animations = reader.get<uint8_t>();
+
+        uint8_t extra_count = reader.get<uint8_t>();
+        for (uint8_t j = 0; j < extra_count && reader.good(); j++) {
+            std::string_view suffix = reader.getString();
+            uint8_t present = reader.get<uint8_t>();
+            uint8_t enabled_count = reader.get<uint8_t>();
+            if (!reader.good() || parseBsaSuffix(suffix) != BsaSuffix::OTHER) {
+                return -1;
+            }
+
+            ExtraBsa &extra = mod.getExtraBsa(suffix);
+            extra.present = present;
+            extra.enabled_count = enabled_count;
+        }
+    }
+
+    return reader.good() && reader.atEnd() ? 0 : -1;
+}
+
+int loadScanCache(const char *path, std::vector<std::string> const &inputs, ModRegistry &mod_list,
+        std::string &plugins_header) {
+    std::vector<FileStamp> stamps;
+    if (!stampInputs(inputs, stamps)) {
+        return -1;
+    }
+
+    std::string data;
+    if (readFile(path, data) != 0) {
+        return -1;
+    }
+
+    SnapshotReader reader(data);
+    if (reader.get<uint32_t>() != SCAN_CACHE_MAGIC || reader.get<uint32_t>() != SCAN_CACHE_VERSION) {
+        return -1;
+    }
+
+    if (reader.get<uint32_t>() != stamps.size()) {
+        return -1;
+    }
+    for (FileStamp const &stamp : stamps) {
+        int64_t mtime = reader.get<int64_t>();
+        int64_t size = reader.get<int64_t>();
+        if (!reader.good() || mtime != stamp.mtime || size != stamp.size) {
+            return -1;
+        }
+    }
+
+    std::string_view header = reader.getString();
+
+    // build into a scratch list so a truncated snapshot can't leave a partial result behind
+    ModStore &store = mod_list.getStore();
+    size_t store_mark = store.size();
+    ModRegistry loaded(store);
+    if (readMods(reader, loaded) != 0) {
+        store.truncate(store_mark);
+        return -1;
+    }
+
+    for (SkyrimMod mod : loaded) {
+        mod_list.append(mod);
+    }
+    plugins_header = std::string(header);
+
+    return 0;
+}
+
+int saveScanCache(const char *path, std::vector<std::string> const &inputs, ModRegistry const &mod_list,
+        std::string const &plugins_header) {
+    std::vector<FileStamp> stamps;
+    if (!stampInputs(inputs, stamps)) {
+        // nothing we write could ever be validated, so make sure no stale snapshot lingers
+        invalidateScanCache(path);
+        return -1;
+    }
+
+    std::string data;
+    SnapshotWriter writer(data);
+
+    writer.put<uint32_t>(SCAN_CACHE_MAGIC);
+    writer.put<uint32_t>(SCAN_CACHE_VERSION);
+
+    writer.put<uint32_t>(stamps.size());
+    for (FileStamp const &stamp : stamps) {
+        writer.put<int64_t>(stamp.mtime);
+        writer.put<int64_t>(stamp.size);
+    }
+
+    writer.putString(plugins_header);
+
+    writer.put<uint32_t>(mod_list.size());
+    for (SkyrimMod mod : mod_list) {
+        std::vector<ExtraBsa> const *extras = mod.getExtraBsas();
+        if (extras && extras->size() > UINT8_MAX) {
+            invalidateScanCache(path);
+            return -1;
+        }
+
+        writer.putString(mod.getBaseName());
+        writer.put<uint8_t>((mod.hasEsp() ? MOD_FLAG_HAS_ESP : 0)
+                | (mod.isMaster() ? MOD_FLAG_IS_MASTER : 0)
+                | (mod.isEspEnabled() ? MOD_FLAG_ESP_ENABLED : 0));
+
+        BsaState const &bsas = mod.getBsaState();
+        writer.put<uint8_t>(bsas.present);
+        writer.put<uint8_t>(bsas.enabled);
+        writer.put<uint8_t>(bsas.animations);
+
+        writer.put<uint8_t>(extras ? extras->size() : 0);
+        if (extras) {
+            for (ExtraBsa const &extra : *extras) {
+                writer.putString(extra.suffix);
+                writer.put<uint8_t>(extra.present);
+                writer.put<uint8_t>(extra.enabled_count);
+            }
+        }
+    }
+
+    if (writeFileAtomic(path, data) != 0) {
+        // whatever cache is left describes an older state of the inputs
+        invalidateScanCache(path);
+        return -1;
+    }
+
+    return 0;
+}
+
+void invalidateScanCache(const char *path) {
+    remove(path);
+}
@@ -0,0 +1,90 @@
+/*
+ * This file is a part of SkyMM-NX.
+ * Copyright (c) 2019, Max Roncace <mproncace@gmail.com>
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "task_pool.hpp"
+
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+TaskPool::TaskPool(size_t worker_count):
+        mutex(),
+        has_work(),
+        idle(),
+        tasks(),
+        workers(),
+        pending(0),
+        closed(false) {
+    workers.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; i++) {
+        workers.insert(workers.end(), std::thread(&TaskPool::runWorker, this));
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        has_work.notify_all();
+    }
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void TaskPool::runWorker(void) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        has_work.wait(lock, [this] { return closed || !tasks.empty(); });
+        if (tasks.empty()) {
+            return;
+        }
+
+        std::function<void(void)> task = std::move(tasks.front());
+        tasks.pop_front();
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        if (--pending == 0) {
+            idle.notify_all();
+        }
+    }
+}
+
+void TaskPool::submit(std::function<void(void)> &&task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+    pending++;
+    has_work.notify_one();
+}
+
+void TaskPool::wait(void) {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return pending == 0; });
+}